@@ -0,0 +1,99 @@
+/*
+ * allocount.c
+ *
+ * Preloaded into a tool under measurement (LD_PRELOAD) so that the tool does
+ * not need to be changed. Counts every heap allocation made through the C
+ * library, which includes operator new, and on exit appends the seconds
+ * since the tool was loaded, the number of allocations and the peak resident
+ * set size in KB to the file named by BENCH_REPORT, if it is set
+ *
+ * Kuei (Jack) Sun
+ * kuei.sun@mail.utoronto.ca
+ *
+ * University of Toronto
+ * 2018
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_realloc(void * ptr, size_t size);
+extern void * __libc_memalign(size_t alignment, size_t size);
+
+static unsigned long long num_allocs;
+static struct timespec start;
+
+void * malloc(size_t size)
+{
+        __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+        return __libc_malloc(size);
+}
+
+void * calloc(size_t nmemb, size_t size)
+{
+        __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+        return __libc_calloc(nmemb, size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+        __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+        return __libc_realloc(ptr, size);
+}
+
+void * memalign(size_t alignment, size_t size)
+{
+        __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+        return __libc_memalign(alignment, size);
+}
+
+void * aligned_alloc(size_t alignment, size_t size)
+{
+        return memalign(alignment, size);
+}
+
+int posix_memalign(void ** ptr, size_t alignment, size_t size)
+{
+        if ((*ptr = memalign(alignment, size)) == NULL)
+                return ENOMEM;
+        return 0;
+}
+
+/* lets a tool that is preloaded read the count, e.g. between its phases */
+unsigned long long allocount_get(void)
+{
+        return __atomic_load_n(&num_allocs, __ATOMIC_RELAXED);
+}
+
+__attribute__((constructor))
+static void allocount_start(void)
+{
+        clock_gettime(CLOCK_MONOTONIC, &start);
+}
+
+__attribute__((destructor))
+static void allocount_report(void)
+{
+        const char * path = getenv("BENCH_REPORT");
+        unsigned long long allocs = num_allocs;
+        struct timespec end;
+        struct rusage ru;
+        FILE * f;
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (path == NULL || getrusage(RUSAGE_SELF, &ru) < 0)
+                return;
+
+        /* the report itself allocates, which is not counted */
+        if ((f = fopen(path, "a")) == NULL)
+                return;
+
+        fprintf(f, "%.6f %llu %ld\n", (end.tv_sec - start.tv_sec) +
+                (end.tv_nsec - start.tv_nsec) / 1e9, allocs, ru.ru_maxrss);
+        fclose(f);
+}
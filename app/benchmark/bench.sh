@@ -0,0 +1,203 @@
+#!/bin/bash
+#
+# bench.sh
+#
+# generates images of increasing size and runs the walk, xmldump, corruptor
+# and freespace tools over each of them with allocount preloaded. prints one
+# json object per tool and image on stdout, e.g.
+#
+# {"fs": "testfs", "files": 64, "image_bytes": 329728, "tool": "walk",
+#  "status": 0, "seconds": 0.004, "containers": 201, "containers_per_sec":
+#  50250.0, "mb_per_sec": 12.3, "peak_rss_kb": 3456, "allocs": 1234,
+#  "allocs_per_container": 6.14}
+# {"fs": "testfs", "files": 64, "image_bytes": 329728, "tool": "freespace",
+#  "status": 0, "seconds": 0.002, "peak_rss_kb": 3012, "allocs": 310}
+#
+# containers and bytes are those of the metadata found by the walk, so that
+# the tools can be compared on the same image. the rates per container and
+# per byte are only given for the tools that traverse all of it (walk and
+# xmldump). the others (corrupt and freespace) only get their wall time and
+# memory use. testfs images are always made, ext4, f2fs and btrfs ones only
+# if their mkfs is installed
+#
+# usage: ./bench.sh [CONF=debug]
+#
+# BENCH_SIZES: number of files in each image (default "0 16 64 256")
+# BENCH_DIR:   where the images are made (default build/benchmark/images)
+#
+# Kuei (Jack) Sun
+# kuei.sun@mail.utoronto.ca
+#
+# University of Toronto
+# 2018
+
+CONF=${1:-debug}
+ROOT=$(cd ../.. && pwd)
+BUILD=$ROOT/build
+BENCH_DIR=${BENCH_DIR:-$BUILD/benchmark/images}
+BENCH_SIZES=${BENCH_SIZES:-"0 16 64 256"}
+ALLOCOUNT=$BUILD/benchmark/$CONF/allocount.so
+
+# containers and bytes found by the walk of the current image
+CONTAINERS=0
+BYTES=0
+
+# runs: fs image files tool command [args...]
+measure()
+{
+    local fs=$1 image=$2 files=$3 tool=$4
+    local report=$BENCH_DIR/report.txt
+    local status secs allocs rss traverse
+    shift 4
+
+    if [ ! -x "$1" ]; then
+        echo "bench.sh: $1 not built, skipped" >&2
+        return
+    fi
+
+    rm -f $report
+    BENCH_REPORT=$report LD_PRELOAD=$ALLOCOUNT "$@" > $BENCH_DIR/out.txt \
+        2>&1 < /dev/null
+    status=$?
+    read secs allocs rss < $report 2>/dev/null || {
+        secs=0; allocs=0; rss=0; }
+
+    if [ $tool = walk ]; then
+        CONTAINERS=$(sed -n 's/.*"containers": \([0-9]*\).*/\1/p' \
+            $BENCH_DIR/out.txt)
+        BYTES=$(sed -n 's/.*"bytes": \([0-9]*\).*/\1/p' $BENCH_DIR/out.txt)
+        CONTAINERS=${CONTAINERS:-0}
+        BYTES=${BYTES:-0}
+    fi
+
+    case $tool in
+    walk|xmldump) traverse=1 ;;
+    *)            traverse=0 ;;
+    esac
+
+    awk -v fs=$fs -v files=$files -v size=$(stat -c %s $image) \
+        -v tool=$tool -v status=$status -v secs=$secs -v allocs=$allocs \
+        -v rss=$rss -v n=$CONTAINERS -v bytes=$BYTES -v traverse=$traverse \
+        'BEGIN {
+        printf "{\"fs\": \"%s\", \"files\": %d, \"image_bytes\": %d, ",
+            fs, files, size
+        printf "\"tool\": \"%s\", \"status\": %d, \"seconds\": %.6f, ",
+            tool, status, secs
+        if (traverse) {
+            printf "\"containers\": %d, \"containers_per_sec\": %.1f, ",
+                n, (secs > 0) ? n / secs : 0
+            printf "\"mb_per_sec\": %.3f, ",
+                (secs > 0) ? bytes / 1048576 / secs : 0
+        }
+        printf "\"peak_rss_kb\": %d, \"allocs\": %d", rss, allocs
+        if (traverse)
+            printf ", \"allocs_per_container\": %.2f", (n > 0) ? allocs / n : 0
+        printf "}\n"
+    }'
+}
+
+# runs: fs image files field
+run_tools()
+{
+    local fs=$1 image=$2 files=$3 field=$4
+
+    measure $fs $image $files walk $BUILD/benchmark/$CONF/bn$fs $image
+    measure $fs $image $files xmldump $BUILD/xmldump/$CONF/xd$fs $image
+
+    # the corruption is made on a copy, which is not part of the measure
+    cp $image $image.corrupt
+    measure $fs $image $files corrupt $BUILD/corruptor/$CONF/cr$fs \
+        -n $field -t add -v 1 $image.corrupt
+    rm -f $image.corrupt
+
+    if [ -x $BUILD/freespace/$CONF/fsp$fs ]; then
+        measure $fs $image $files freespace $BUILD/freespace/$CONF/fsp$fs \
+            $image
+    fi
+}
+
+# populates a directory with files, 16 to a subdirectory
+make_tree()
+{
+    local dir=$1 files=$2 i
+
+    rm -rf $dir
+    mkdir -p $dir
+    for ((i = 0; i < files; i++)); do
+        mkdir -p $dir/d$((i / 16))
+        head -c $((i * 1000 % 65536 + 1)) /dev/zero > $dir/d$((i / 16))/f$i
+    done
+}
+
+# testfs has a fixed geometry, so it only grows by its contents
+bench_testfs()
+{
+    local files=$1 image=$BENCH_DIR/testfs-$1.img i
+
+    $ROOT/testfs/mktestfs $image > /dev/null || return
+    for ((i = 0; i < files; i++)); do
+        if ((i % 16 == 0)); then
+            ((i > 0)) && echo "cd .."
+            echo "mkdir d$((i / 16))"
+            echo "cd d$((i / 16))"
+        fi
+        echo "create f$i"
+        echo "write -o $((i % 16 * 1000)) f$i data$i"
+    done | $ROOT/testfs/testfs -n $image > /dev/null 2>&1
+
+    run_tools testfs $image $files used_inode_count
+}
+
+bench_ext4()
+{
+    local files=$1 image=$BENCH_DIR/ext4-$1.img
+
+    make_tree $BENCH_DIR/tree $files
+    rm -f $image
+    mkfs.ext4 -q -F -d $BENCH_DIR/tree $image $((8192 + files * 128))k \
+        > /dev/null || return
+    run_tools ext3 $image $files s_free_blocks_count
+}
+
+# mkfs.f2fs cannot populate an image, so it only grows in size
+bench_f2fs()
+{
+    local files=$1 image=$BENCH_DIR/f2fs-$1.img
+
+    rm -f $image
+    truncate -s $((64 + files))M $image
+    mkfs.f2fs -q $image > /dev/null || return
+    run_tools f2fs $image $files free_segment_count
+}
+
+bench_btrfs()
+{
+    local files=$1 image=$BENCH_DIR/btrfs-$1.img
+
+    make_tree $BENCH_DIR/tree $files
+    rm -f $image
+    truncate -s $((128 + files))M $image
+    mkfs.btrfs -q -f --rootdir $BENCH_DIR/tree $image > /dev/null || return
+    run_tools btrfs $image $files bytes_used
+}
+
+if [ ! -f $ALLOCOUNT ]; then
+    echo "bench.sh: $ALLOCOUNT not built" >&2
+    exit 1
+fi
+
+if [ ! -x $ROOT/testfs/mktestfs ] || [ ! -x $ROOT/testfs/testfs ]; then
+    (cd $ROOT/testfs && make TARGET=base CONF=$CONF mktestfs testfs) \
+        > /dev/null || exit 1
+fi
+
+mkdir -p $BENCH_DIR
+for files in $BENCH_SIZES; do
+    bench_testfs $files
+    command -v mkfs.ext4  > /dev/null && bench_ext4 $files
+    command -v mkfs.f2fs  > /dev/null && bench_f2fs $files
+    command -v mkfs.btrfs > /dev/null && bench_btrfs $files
+done
+
+rm -rf $BENCH_DIR/tree $BENCH_DIR/out.txt $BENCH_DIR/report.txt
+exit 0
@@ -0,0 +1,326 @@
+/*
+ * benchmark.cpp
+ *
+ * The fetch-super-and-walk benchmark: the cost of a traversal with nothing
+ * but the library in it, which the other tools are measured against, and the
+ * per-type microbenchmarks of the operations that make up a traversal
+ *
+ * Kuei (Jack) Sun
+ * kuei.sun@mail.utoronto.ca
+ *
+ * University of Toronto
+ * 2018
+ */
+
+#include <libfs.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "benchmark.h"
+
+using namespace std;
+
+/* defined by allocount.so when it is preloaded */
+extern "C" unsigned long long allocount_get(void) __attribute__((weak));
+
+/* measures each type on the first container of it that the walk finds */
+class TypeBench;
+
+class Walker : public FS::Visitor
+{
+    TypeBench * bench;
+    unsigned long num_containers;
+    unsigned long long num_bytes;
+    unsigned long num_errors;
+
+    int visit_container(FS::Container * ctn)
+    {
+        int ret;
+
+        num_containers++;
+        num_bytes += ctn->get_size();
+
+        /* the elements of an extent are visited as its fields */
+        if (ctn->is_extent() && (ret = ctn->accept_fields(*this)) < 0)
+            return ret;
+
+        /* an element's pointers are visited by its extent */
+        if (ctn->is_element())
+            return 0;
+
+        return ctn->accept_pointers(*this);
+    }
+
+    /* a bad subtree (e.g. the unused tail of a journal) is counted, and
+     * the walk goes on with its siblings */
+    int visit_pointer(FS::Pointer * ptr)
+    {
+        FS::Container * ctn;
+
+        /* pointer does not point to anything valid */
+        if (ptr->pointer_type() == FS::INVALID_TYPE_ID)
+            return 0;
+
+        if ((ctn = ptr->fetch()) == nullptr) {
+            if (ptr->to_integer() > 0)
+                num_errors++;
+            return 0;
+        }
+
+        walk(ctn, ptr->pointer_type(), ptr->get_path());
+        ctn->destroy();
+        return 0;
+    }
+
+public:
+    Walker(TypeBench * tb=nullptr) : bench(tb), num_containers(0), 
+        num_bytes(0), num_errors(0) {}
+
+    void walk(FS::Container * ctn, int type, FS::Path * path);
+
+    virtual int visit(FS::Entity & ent) override
+    {
+        if (ent.to_pointer() != nullptr)
+            return visit_pointer(ent.to_pointer());
+        if (ent.to_container() != nullptr)
+            return visit_container(ent.to_container());
+        return 0;
+    }
+
+    unsigned long get_num_containers() const { return num_containers; }
+    unsigned long long get_num_bytes() const { return num_bytes; }
+    unsigned long get_num_errors() const { return num_errors; }
+};
+
+int bn_parse_args(int argc, const char * argv[], unsigned & iterations,
+    const char * & filename)
+{
+    int i;
+
+    for (i = 1; i < argc - 1; i++) {
+        if (!strcmp(argv[i], "-m") && i + 2 < argc)
+            iterations = strtoul(argv[++i], nullptr, 0);
+        else
+            break;
+    }
+
+    if (i != argc - 1) {
+        cout << "usage: " << argv[0] << " [-m iterations] device" << endl;
+        return -EINVAL;
+    }
+
+    filename = argv[i];
+    return 0;
+}
+
+long bn_walk_filesystem(FS::FileSystem & fs)
+{
+    FS::Container * super;
+    Walker walker;
+
+    if ((super = fs.fetch_super()) == nullptr)
+        return FS::ERR_CORRUPT;
+
+    walker.walk(super, fs.super_type_id(), super->get_path());
+    super->destroy();
+
+    cout << "{\"containers\": " << walker.get_num_containers()
+         << ", \"bytes\": " << walker.get_num_bytes()
+         << ", \"errors\": " << walker.get_num_errors() << "}" << endl;
+
+    return walker.get_num_containers();
+}
+
+class NullVisitor : public FS::Visitor
+{
+public:
+    virtual int visit(FS::Entity & ent) override { return 0; }
+};
+
+class TypeBench
+{
+    enum { FACTORY, SERIALIZE, ACCEPT, DESTROY, NUM_OPS };
+
+    struct Result
+    {
+        double ns;
+        double allocs;
+        bool unimp;     /* e.g. serialize() of a type that cannot be saved */
+    };
+
+    FS::FileSystem & fs;
+    unsigned iterations;
+    map<int, const BNType *> pending;
+    long num_measured;
+
+    static unsigned long long allocs()
+    {
+        return (allocount_get != nullptr) ? allocount_get() : 0;
+    }
+
+    void print(int type, unsigned len, const Result * res, const char * err);
+
+public:
+    TypeBench(FS::FileSystem & fs, unsigned n) : fs(fs), iterations(n),
+        num_measured(0)
+    {
+        for (unsigned i = 0; i < bn_num_types; i++)
+            pending[bn_types[i].type] = &bn_types[i];
+    }
+
+    void sample(FS::Container * ctn, int type, FS::Path * path);
+    long get_num_measured() const { return num_measured; }
+};
+
+void Walker::walk(FS::Container * ctn, int type, FS::Path * path)
+{
+    /* measured before the walk, whose fetches would be counted otherwise */
+    if (bench != nullptr)
+        bench->sample(ctn, type, path);
+
+    if (visit_container(ctn) < 0)
+        num_errors++;
+}
+
+void TypeBench::print(int type, unsigned len, const Result * res, 
+    const char * err)
+{
+    static const char * const names[NUM_OPS] = {
+        "factory", "serialize", "accept_fields", "destroy",
+    };
+
+    cout << "{\"type\": \"" << fs.type_to_name(type) << "\", \"bytes\": " 
+         << len << ", \"iterations\": " << iterations;
+
+    if (err != nullptr) {
+        cout << ", \"error\": \"" << err << "\"}" << endl;
+        return;
+    }
+
+    for (int op = 0; op < NUM_OPS; op++) {
+        cout << ", \"" << names[op] << "_ns\": ";
+        if (res[op].unimp)
+            cout << "null";
+        else
+            cout << res[op].ns;
+
+        cout << ", \"" << names[op] << "_allocs\": ";
+        if (res[op].unimp || allocount_get == nullptr)
+            cout << "null";
+        else
+            cout << res[op].allocs;
+    }
+
+    cout << "}" << endl;
+}
+
+/* the canned buffer is read from where the container was fetched, and is
+ * parsed with the same location and path as the fetch */
+void TypeBench::sample(FS::Container * ctn, int type, FS::Path * path)
+{
+    map<int, const BNType *>::iterator it = pending.find(type);
+    const FS::Location & loc = ctn->get_location();
+    chrono::steady_clock::time_point start;
+    unsigned long long count;
+    Result res[NUM_OPS];
+    char * canned = nullptr;
+    char * buffer;
+    unsigned i, length;
+    int op, ret;
+
+    if (it == pending.end() || path == nullptr)
+        return;
+
+    const BNType * bt = it->second;
+    pending.erase(it);
+
+    ret = fs.io.read(loc, canned);
+    if (canned == nullptr || ret < (int)loc.size) {
+        print(type, loc.size, nullptr, "read failed");
+        delete [] canned;
+        return;
+    }
+
+    vector<FS::Container *> objs(iterations, nullptr);
+    vector<char> out(canned, canned + loc.size);
+
+    /* serialize works over the original bytes, as it does in save() */
+    buffer = path->buffer;
+    length = path->length;
+    path->buffer = out.data();
+    path->length = loc.size;
+    
+    for (op = 0; op < NUM_OPS; op++) {
+        NullVisitor nv;
+
+        res[op].unimp = false;
+        count = allocs();
+        start = chrono::steady_clock::now();
+
+        for (i = 0; i < iterations; i++) {
+            switch (op) {
+            case FACTORY:
+                objs[i] = bt->factory(loc, path, canned, ret);
+                break;
+            case SERIALIZE:
+                if (objs[i]->serialize(out.data(), loc.size) == FS::ERR_UNIMP)
+                    res[op].unimp = true;
+                break;
+            case ACCEPT:
+                objs[i]->accept_fields(nv);
+                break;
+            case DESTROY:
+                objs[i]->destroy();
+                break;
+            }
+
+            if (objs[i] == nullptr || res[op].unimp)
+                break;
+        }
+
+        res[op].ns = chrono::duration<double, nano>(
+            chrono::steady_clock::now() - start).count() / iterations;
+        res[op].allocs = (double)(allocs() - count) / iterations;
+
+        /* the parsed containers are released before the error is reported */
+        if (op == FACTORY && i < iterations) {
+            while (i > 0)
+                objs[--i]->destroy();
+            break;
+        }
+    }
+
+    path->buffer = buffer;
+    path->length = length;
+    delete [] canned;
+
+    if (op < NUM_OPS) {
+        print(type, loc.size, nullptr, "factory failed");
+        return;
+    }
+
+    print(type, loc.size, res, nullptr);
+    num_measured++;
+}
+
+long bn_bench_types(FS::FileSystem & fs, unsigned iterations)
+{
+    FS::Container * super;
+    TypeBench bench(fs, iterations);
+    Walker walker(&bench);
+
+    if (iterations == 0)
+        return -EINVAL;
+
+    if ((super = fs.fetch_super()) == nullptr)
+        return FS::ERR_CORRUPT;
+
+    walker.walk(super, fs.super_type_id(), super->get_path());
+    super->destroy();
+
+    return bench.get_num_measured();
+}
@@ -0,0 +1,62 @@
+/*
+ * benchmark.h
+ *
+ * Copyright (C) 2018
+ * University of Toronto
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@utoronto.ca
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <libfs.h>
+#include "blockio.h"
+
+// parses "[-m iterations] device". iterations is left at 0 unless -m is
+// given, in which case the per-type microbenchmarks are run instead of the
+// walk. returns 0 on success, or negative value (after printing the usage)
+//
+int bn_parse_args(int argc, const char * argv[], unsigned & iterations,
+    const char * & filename);
+
+// fs: the file system to walk, whose io must be opened and have its block
+// size set before this function is called.
+//
+// fetches the super block and every container reachable from it, the same
+// way as xmldump but without formatting anything, then prints the number of
+// containers and of their bytes as a json object
+//
+// returns number of containers walked, or negative value on fatal error
+//
+long bn_walk_filesystem(FS::FileSystem & fs);
+
+// a container type of the file system and how to parse it from a buffer.
+// the table of them is generated by jdc into mb<fs>.cpp, and leaves out the
+// types that cannot be parsed on their own (e.g. extents)
+struct BNType
+{
+    int type;
+    FS::Container * (*factory)(const FS::Location & loc, const FS::Path * path,
+                               const char * buf, unsigned len);
+};
+
+extern const BNType bn_types[];
+extern const unsigned bn_num_types;
+
+// fs: same as bn_walk_filesystem
+// iterations: number of times each operation is run per type
+//
+// walks the file system until it has found an instance of each type in
+// bn_types, whose bytes on disk become the canned buffer of that type. times
+// factory(), serialize(), accept_fields() with a visitor that does nothing
+// and destroy() over the buffer, then prints one json object per type with
+// the ns/op and, if allocount is preloaded, the allocations/op of each
+//
+// returns number of types measured, or negative value on fatal error
+//
+long bn_bench_types(FS::FileSystem & fs, unsigned iterations);
+
+#endif /* BENCHMARK_H */
+
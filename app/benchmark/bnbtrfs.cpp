@@ -0,0 +1,55 @@
+/*
+ * bnbtrfs.cpp
+ *
+ * contains main() for bootstraping to libbtrfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libbtrfs.h>
+#include <iostream>
+#include "benchmark.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    BlockIO io;
+    Btrfs btrfs(io);
+    const char * filename;
+    Btrfs::BtrfsSuperBlock * super;
+    unsigned iterations = 0;
+    long ret;
+
+    if (bn_parse_args(argc, argv, iterations, filename) < 0)
+        return EXIT_FAILURE;
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if ((super = (Btrfs::BtrfsSuperBlock *)btrfs.fetch_super())) {
+        io.set_block_size(super->sectorsize);
+        super->destroy();
+    }
+    else {
+        cout << argv[0] << ": io error or super block is corrupted" << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (iterations > 0)
+        ret = bn_bench_types(btrfs, iterations);
+    else
+        ret = bn_walk_filesystem(btrfs);
+
+    if (ret < 0) {
+        cout << filename << ": could not walk the file system" << endl;
+        return EXIT_FAILURE;
+    }
+     
+    return EXIT_SUCCESS;
+}
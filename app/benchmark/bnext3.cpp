@@ -0,0 +1,55 @@
+/*
+ * bnext3.cpp
+ *
+ * contains main() for bootstraping to libext3
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libext3.h>
+#include <iostream>
+#include "benchmark.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    BlockIO io;
+    Ext3 ext3(io);
+    const char * filename;
+    Ext3::Ext3SuperBlock * super;
+    unsigned iterations = 0;
+    long ret;
+
+    if (bn_parse_args(argc, argv, iterations, filename) < 0)
+        return EXIT_FAILURE;
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if ((super = (Ext3::Ext3SuperBlock *)ext3.fetch_super())) {
+        io.set_block_size(1024 << super->s_log_block_size);
+        super->destroy();
+    }
+    else {
+        cout << argv[0] << ": io error or super block is corrupted" << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (iterations > 0)
+        ret = bn_bench_types(ext3, iterations);
+    else
+        ret = bn_walk_filesystem(ext3);
+
+    if (ret < 0) {
+        cout << filename << ": could not walk the file system" << endl;
+        return EXIT_FAILURE;
+    }
+     
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+/*
+ * bnf2fs.cpp
+ *
+ * contains main() for bootstraping to libf2fs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libf2fs.h>
+#include <iostream>
+#include "benchmark.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    BlockIO io;
+    F2FS f2fs(io);
+    const char * filename;
+    unsigned iterations = 0;
+    long ret;
+
+    if (bn_parse_args(argc, argv, iterations, filename) < 0)
+        return EXIT_FAILURE;
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    /* f2fs always uses this block size */
+    io.set_block_size(F2FS_BLKSIZE);
+
+    if (iterations > 0)
+        ret = bn_bench_types(f2fs, iterations);
+    else
+        ret = bn_walk_filesystem(f2fs);
+
+    if (ret < 0) {
+        cout << filename << ": could not walk the file system" << endl;
+        return EXIT_FAILURE;
+    }
+     
+    return EXIT_SUCCESS;
+}
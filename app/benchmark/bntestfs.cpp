@@ -0,0 +1,47 @@
+/*
+ * bntestfs.cpp
+ *
+ * contains main() for bootstraping to libtestfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libtestfs.h>
+#include <iostream>
+#include "benchmark.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    BlockIO io;
+    TestFS testfs(io);
+    const char * filename;
+    unsigned iterations = 0;
+    long ret;
+
+    if (bn_parse_args(argc, argv, iterations, filename) < 0)
+        return EXIT_FAILURE;
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    io.set_block_size(BLOCK_SIZE);
+
+    if (iterations > 0)
+        ret = bn_bench_types(testfs, iterations);
+    else
+        ret = bn_walk_filesystem(testfs);
+
+    if (ret < 0) {
+        cout << filename << ": could not walk the file system" << endl;
+        return EXIT_FAILURE;
+    }
+     
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,389 @@
+/*
+ * blockmap.cpp
+ *
+ * Classifies every block of an image without traversing it from the super
+ * block, so that it works on images whose pointers cannot be trusted. Each
+ * block is first checked against a few cheap signatures (magic numbers,
+ * copies of the super block's uuid, node footers), and only the candidate
+ * types of a matching signature are validated on the raw buffer. The image
+ * is split in chunks that are classified by all cores in parallel
+ *
+ * Kuei (Jack) Sun
+ * kuei.sun@mail.utoronto.ca
+ *
+ * University of Toronto
+ * 2018
+ */
+
+#include <libfs.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include "blockmap.h"
+
+using namespace std;
+
+/* each worker claims about this many bytes of the image at a time */
+#define BM_CHUNK_SIZE (1 << 20)
+
+int bm_parse_args(int argc, const char * argv[], BMOptions & opt,
+    const char * & filename)
+{
+    int i;
+
+    for (i = 1; i < argc - 1; i++) {
+        if (!strcmp(argv[i], "-q"))
+            opt.quiet = true;
+        else if (!strcmp(argv[i], "-j") && i + 2 < argc)
+            opt.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 2 < argc)
+            opt.output = argv[++i];
+        else
+            break;
+    }
+
+    if (i != argc - 1) {
+        cout << "usage: " << argv[0] << " [-q] [-j threads] [-o mapfile] "
+             << "device" << endl;
+        return -EINVAL;
+    }
+
+    filename = argv[i];
+    return 0;
+}
+
+static u64 load(const char * buf, unsigned width)
+{
+    u8 v8;
+    u16 v16;
+    u32 v32;
+    u64 v64;
+
+    switch (width)
+    {
+    case 1:
+        memcpy(&v8, buf, sizeof(v8));
+        return v8;
+    case 2:
+        memcpy(&v16, buf, sizeof(v16));
+        return v16;
+    case 4:
+        memcpy(&v32, buf, sizeof(v32));
+        return v32;
+    default:
+        memcpy(&v64, buf, sizeof(v64));
+        return v64;
+    }
+}
+
+/* one bad test would otherwise read past the end of every block */
+static bool check_signature(const BMSignature & sig, unsigned block_size)
+{
+    if (sig.start >= block_size || sig.types.empty())
+        return false;
+
+    for (const BMTest & test : sig.tests) {
+        if (test.width != 1 && test.width != 2 && test.width != 4 &&
+            test.width != 8)
+            return false;
+
+        if (test.offset + test.width > block_size)
+            return false;
+
+        if (test.op == BMTest::SAME && test.value + test.width > block_size)
+            return false;
+    }
+
+    return true;
+}
+
+class BlockMapper
+{
+    struct Worker
+    {
+        std::map<int, unsigned long> counts;
+        int error;
+
+        Worker() : error(0) {}
+    };
+
+    FS::FileSystem & fs;
+    const FS::Path * path;
+    const std::vector<BMSignature> & sigs;
+    unsigned block_size;
+    int fd;
+
+    u64 num_blocks;
+    u64 chunk_blocks;
+    std::vector<u16> types;
+
+    std::atomic<u64> next_chunk;
+    std::atomic<bool> failed;
+
+    static bool match(const BMSignature & sig, const char * buf)
+    {
+        for (const BMTest & test : sig.tests) {
+            u64 val = load(buf + test.offset, test.width);
+            bool ok;
+
+            switch (test.op)
+            {
+            case BMTest::EQ:
+                ok = (val == test.value);
+                break;
+            case BMTest::NE:
+                ok = (val != test.value);
+                break;
+            default:
+                ok = (val == load(buf + test.value, test.width));
+                break;
+            }
+
+            if (!ok)
+                return false;
+        }
+
+        return true;
+    }
+
+    int classify(const char * buf, u64 pos) const
+    {
+        for (const BMSignature & sig : sigs) {
+            if (!match(sig, buf))
+                continue;
+
+            unsigned len = block_size - sig.start;
+            FS::Location loc(FS::AS_BYTE, len, 0, pos + sig.start);
+
+            for (int type : sig.types) {
+                if (fs.validate_by_type(type, loc, path, buf + sig.start,
+                        len) == 0)
+                    return type;
+            }
+        }
+
+        return FS::INVALID_TYPE_ID;
+    }
+
+    static int read_full(int fd, char * buf, size_t size, off_t pos)
+    {
+        while (size > 0) {
+            ssize_t ret = pread(fd, buf, size, pos);
+
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret < 0)
+                return -errno;
+            if (ret == 0)
+                return -EIO;
+
+            buf += ret;
+            size -= ret;
+            pos += ret;
+        }
+
+        return 0;
+    }
+
+    void work(Worker & w)
+    {
+        std::vector<char> buf(chunk_blocks * block_size);
+        u64 chunk;
+
+        while (!failed && (chunk = next_chunk++) * chunk_blocks < num_blocks) {
+            u64 first = chunk * chunk_blocks;
+            u64 count = std::min(chunk_blocks, num_blocks - first);
+
+            if ((w.error = read_full(fd, buf.data(), count * block_size,
+                    first * block_size)) < 0) {
+                failed = true;
+                return;
+            }
+
+            for (u64 i = 0; i < count; i++) {
+                u64 blknr = first + i;
+                int type = classify(buf.data() + i * block_size,
+                                    blknr * block_size);
+
+                types[blknr] = type;
+                if (type != FS::INVALID_TYPE_ID)
+                    w.counts[type]++;
+            }
+        }
+    }
+
+public:
+    BlockMapper(FS::FileSystem & f, const FS::Path * p,
+        const std::vector<BMSignature> & s, unsigned bs) : fs(f), path(p),
+        sigs(s), block_size(bs), fd(-1), num_blocks(0), chunk_blocks(0),
+        next_chunk(0), failed(false) {}
+
+    ~BlockMapper() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    int open(const char * filename)
+    {
+        struct stat st;
+
+        if ((fd = ::open(filename, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+            return -errno;
+
+        num_blocks = st.st_size / block_size;
+        chunk_blocks = std::max(1U, BM_CHUNK_SIZE / block_size);
+        types.assign(num_blocks, FS::INVALID_TYPE_ID);
+        return 0;
+    }
+
+    int run(unsigned threads, std::map<int, unsigned long> & counts)
+    {
+        std::vector<std::thread> pool;
+        std::vector<Worker> workers(threads);
+
+        for (unsigned i = 0; i < threads; i++)
+            pool.emplace_back(&BlockMapper::work, this, std::ref(workers[i]));
+
+        for (std::thread & t : pool)
+            t.join();
+
+        for (Worker & w : workers) {
+            if (w.error < 0)
+                return w.error;
+
+            for (auto & c : w.counts)
+                counts[c.first] += c.second;
+        }
+
+        return 0;
+    }
+
+    int save(const char * filename, int max_type) const
+    {
+        BMHeader hdr;
+        FILE * f;
+        bool ok;
+
+        if ((f = fopen(filename, "wb")) == nullptr)
+            return -errno;
+
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, BM_MAGIC, sizeof(hdr.magic));
+        hdr.version = BM_VERSION;
+        hdr.block_size = block_size;
+        hdr.num_blocks = num_blocks;
+        hdr.num_types = max_type + 1;
+        hdr.name_size = BM_NAME_SIZE;
+
+        ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+
+        for (int t = 0; ok && t <= max_type; t++) {
+            const char * name = fs.type_to_name(t);
+            char buf[BM_NAME_SIZE] = { 0 };
+
+            if (name != nullptr)
+                strncpy(buf, name, sizeof(buf) - 1);
+            ok = (fwrite(buf, sizeof(buf), 1, f) == 1);
+        }
+
+        if (ok && num_blocks > 0)
+            ok = (fwrite(types.data(), sizeof(u16), num_blocks, f) ==
+                  num_blocks);
+
+        if (fclose(f) != 0 || !ok)
+            return -EIO;
+
+        return 0;
+    }
+
+    u64 get_num_blocks() const { return num_blocks; }
+};
+
+FS::Container * bm_fetch_super(FS::FileSystem & fs, u64 primary,
+    unsigned size, const std::vector<u64> & copies, u64 & where)
+{
+    FS::Container * super;
+
+    where = primary;
+    if ((super = fs.fetch_super()) != nullptr)
+        return super;
+
+    for (u64 addr : copies) {
+        FS::Location loc(FS::AS_BYTE, size, 0, addr);
+        char * buf = nullptr;
+
+        if (fs.io.read(loc, buf) < 0 || buf == nullptr)
+            continue;
+
+        /* the copy is laid out like the primary, so it is parsed as if buf
+         * had been read from where the primary is */
+        super = fs.parse_super(primary, buf, size);
+        delete [] buf;
+
+        if (super != nullptr) {
+            where = addr;
+            return super;
+        }
+    }
+
+    return nullptr;
+}
+
+long bm_classify_image(FS::FileSystem & fs, FS::Container * super,
+    const char * filename, unsigned block_size,
+    const std::vector<BMSignature> & sigs, BMOptions & opt)
+{
+    BlockMapper mapper(fs, super->get_path(), sigs, block_size);
+    std::map<int, unsigned long> counts;
+    unsigned threads = opt.threads;
+    unsigned long matched = 0;
+    int ret;
+
+    if (block_size == 0)
+        return -EINVAL;
+
+    for (const BMSignature & sig : sigs) {
+        if (!check_signature(sig, block_size))
+            return -EINVAL;
+    }
+
+    if (threads == 0 && (threads = std::thread::hardware_concurrency()) == 0)
+        threads = 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if ((ret = mapper.open(filename)) < 0 ||
+        (ret = mapper.run(threads, counts)) < 0)
+        return ret;
+
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    if (opt.output != nullptr &&
+        (ret = mapper.save(opt.output,
+            counts.empty() ? 0 : counts.rbegin()->first)) < 0)
+        return ret;
+
+    for (auto & c : counts) {
+        matched += c.second;
+        if (!opt.quiet)
+            cout << fs.type_to_name(c.first) << " " << c.second << endl;
+    }
+
+    double mb = (double)mapper.get_num_blocks() * block_size / (1 << 20);
+    cout << "blocks: " << mapper.get_num_blocks() << ", classified: "
+         << matched << ", threads: " << threads << ", time: " << secs.count()
+         << "s, " << ((secs.count() > 0) ? mb / secs.count() : 0)
+         << " MB/s" << endl;
+
+    return matched;
+}
+
@@ -0,0 +1,91 @@
+/*
+ * blockmap.h
+ *
+ * Copyright (C) 2018
+ * University of Toronto
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@utoronto.ca
+ */
+
+#ifndef BLOCKMAP_H
+#define BLOCKMAP_H
+
+#include <libfs.h>
+#include <vector>
+#include "blockio.h"
+
+// a test on one little-endian integer of a raw block, e.g. a magic number.
+// SAME compares it against the integer at offset 'value' of the same block
+struct BMTest
+{
+    enum Op { EQ, NE, SAME };
+
+    Op op;
+    unsigned offset;
+    unsigned width;     /* 1, 2, 4 or 8 bytes */
+    u64 value;
+};
+
+// a block matching every test is tried as each of the types in turn, the
+// first one whose constraints hold on the block is its type
+struct BMSignature
+{
+    unsigned start;     /* where the container starts within the block */
+    std::vector<BMTest> tests;
+    std::vector<int> types;
+};
+
+struct BMOptions
+{
+    bool quiet;             /* only print the summary */
+    unsigned threads;       /* 0 means one per core */
+    const char * output;    /* where to save the block map, if not null */
+
+    BMOptions() : quiet(false), threads(0), output(nullptr) {}
+};
+
+// the map file starts with this header, followed by the name of every type
+// id up to num_types (so that it can be read without the library that made
+// it), then by one u16 type id per block. blocks that match no signature
+// are INVALID_TYPE_ID
+struct BMHeader
+{
+    char magic[8];
+    u32 version;
+    u32 block_size;
+    u64 num_blocks;
+    u32 num_types;
+    u32 name_size;
+};
+
+#define BM_MAGIC "SPFYBMAP"
+#define BM_VERSION 1
+#define BM_NAME_SIZE 32
+
+// parses [-q] [-j threads] [-o mapfile] device, returns 0 on success or
+// prints the usage and returns negative value
+int bm_parse_args(int argc, const char * argv[], BMOptions & opt,
+    const char * & filename);
+
+// fetches the super block of fs. if the primary cannot be read or parsed,
+// tries the copies at the byte addresses in 'copies' in turn. primary is the
+// byte address of the primary, where parse_super expects to find it, and
+// size is the size of the super block. 'where' is set to the address that
+// the returned super block was read from. returns nullptr if no copy parses
+FS::Container * bm_fetch_super(FS::FileSystem & fs, u64 primary,
+    unsigned size, const std::vector<u64> & copies, u64 & where);
+
+// fs: the file system of the image, which has its super block in super
+// filename: the image, read in parallel independently of fs.io
+// block_size: the unit that the image is classified in
+// sigs: the signatures of the types that can be carved, in priority order
+//
+// returns number of blocks classified, or negative value on fatal error
+//
+long bm_classify_image(FS::FileSystem & fs, FS::Container * super,
+    const char * filename, unsigned block_size,
+    const std::vector<BMSignature> & sigs, BMOptions & opt);
+
+#endif /* BLOCKMAP_H */
+
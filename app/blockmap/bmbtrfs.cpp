@@ -0,0 +1,112 @@
+/*
+ * bmbtrfs.cpp
+ *
+ * contains main() for bootstraping to libbtrfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libbtrfs.h>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include "blockmap.h"
+
+using namespace std;
+
+#define BTRFS_SUPER_OFFSET 0x10000
+
+/* the mirrors are at 64MB and 256GB */
+static const vector<u64> btrfs_super_copies{ 0x4000000ULL, 0x4000000000ULL };
+
+static vector<BMSignature> btrfs_signatures(const struct btrfs_super_block & sb)
+{
+    vector<BMSignature> sigs;
+    const unsigned fsid = offsetof(struct btrfs_header, fsid);
+    const unsigned level = offsetof(struct btrfs_header, level);
+    u64 id[2];
+
+    memcpy(id, sb.fsid, sizeof(id));
+
+    /* the super block starts the same way as a tree block */
+    sigs.push_back(BMSignature{ 0, {
+        { BMTest::EQ, offsetof(struct btrfs_super_block, magic), 8,
+          BTRFS_MAGIC } },
+        { Btrfs::BTRFS_SUPER_BLOCK } });
+
+    /* every tree block of this file system has its fsid */
+    sigs.push_back(BMSignature{ 0, {
+        { BMTest::EQ, fsid, 8, id[0] },
+        { BMTest::EQ, fsid + 8, 8, id[1] },
+        { BMTest::EQ, level, 1, 0 } },
+        { Btrfs::BTRFS_LEAF } });
+
+    sigs.push_back(BMSignature{ 0, {
+        { BMTest::EQ, fsid, 8, id[0] },
+        { BMTest::EQ, fsid + 8, 8, id[1] },
+        { BMTest::NE, level, 1, 0 } },
+        { Btrfs::BTRFS_NODE } });
+
+    return sigs;
+}
+
+int main(int argc, const char * argv[])
+{
+    BMOptions opt;
+    BlockIO io;
+    Btrfs btrfs(io);
+    const char * filename;
+    FS::Container * super;
+    struct btrfs_super_block sb;
+    char * buf;
+    long ret;
+    u64 where;
+
+    if (bm_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+
+    if ((super = bm_fetch_super(btrfs, BTRFS_SUPER_OFFSET,
+        sizeof(struct btrfs_super_block), btrfs_super_copies, where)) == 
+        nullptr) {
+        cout << filename << ": CORRUPT, io error or super block and its "
+             << "mirrors are corrupted" << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (where != BTRFS_SUPER_OFFSET)
+        cout << filename << ": using the mirror super block at byte "
+             << where << endl;
+
+    /* the signatures need the raw fsid and node size */
+    FS::Location loc(FS::AS_BYTE, sizeof(struct btrfs_super_block), 0, where);
+    if ((ret = io.read(loc, buf)) < 0) {
+        cout << filename << ": error " << ret << endl;
+        super->destroy();
+        return EXIT_FAILURE;
+    }
+
+    memcpy(&sb, buf, sizeof(sb));
+    delete [] buf;
+    io.set_block_size(sb.sectorsize);
+
+    /* tree blocks are aligned to the node size */
+    ret = bm_classify_image(btrfs, super, filename, sb.nodesize,
+        btrfs_signatures(sb), opt);
+    super->destroy();
+
+    if (ret < 0) {
+        cout << filename << ": error " << ret << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
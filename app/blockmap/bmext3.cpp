@@ -0,0 +1,127 @@
+/*
+ * bmext3.cpp
+ *
+ * contains main() for bootstraping to libext3
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libext3.h>
+#include <iostream>
+#include "blockmap.h"
+
+using namespace std;
+
+#define EXT3_SUPER_MAGIC_OFFSET 56
+#define EXT3_SUPER_MAGIC 0xEF53
+#define EXT3_SUPER_OFFSET 1024
+
+/* the journal is big endian, these are as read on a little endian cpu */
+#define JFS_MAGIC_LE 0x98393bc0ULL
+#define JFS_BLOCKTYPE_LE(t) ((u64)(t) << 24)
+
+static void add_journal_block(vector<BMSignature> & sigs, unsigned blocktype,
+    int type)
+{
+    sigs.push_back(BMSignature{ 0, {
+        { BMTest::EQ, 0, 4, JFS_MAGIC_LE },
+        { BMTest::EQ, 4, 4, JFS_BLOCKTYPE_LE(blocktype) } }, { type } });
+}
+
+static vector<BMSignature> ext3_signatures(unsigned block_size)
+{
+    vector<BMSignature> sigs;
+
+    /* backup super blocks start their group, so they start a block */
+    sigs.push_back(BMSignature{ 0, {
+        { BMTest::EQ, EXT3_SUPER_MAGIC_OFFSET, 2, EXT3_SUPER_MAGIC } },
+        { Ext3::EXT3_SUPER_BLOCK } });
+
+    /* except for the primary, which is 1K into block 0 */
+    if (block_size > 1024) {
+        sigs.push_back(BMSignature{ 1024, {
+            { BMTest::EQ, 1024 + EXT3_SUPER_MAGIC_OFFSET, 2,
+              EXT3_SUPER_MAGIC } },
+            { Ext3::EXT3_SUPER_BLOCK } });
+    }
+
+    add_journal_block(sigs, JFS_DESCRIPTOR_BLOCK, Ext3::JOURNAL_HEADER);
+    add_journal_block(sigs, JFS_COMMIT_BLOCK, Ext3::JOURNAL_COMMIT_BLOCK);
+    add_journal_block(sigs, JFS_SUPERBLOCK_V1, Ext3::JOURNAL_SUPERBLOCK_S);
+    add_journal_block(sigs, JFS_SUPERBLOCK_V2, Ext3::JOURNAL_SUPERBLOCK_S);
+    add_journal_block(sigs, JFS_REVOKE_BLOCK, Ext3::JOURNAL_REVOKE_BLOCK);
+
+    /* the first block of a directory starts with "." and ".." */
+    sigs.push_back(BMSignature{ 0, {
+        { BMTest::EQ, 4, 2, 12 },
+        { BMTest::EQ, 6, 1, 1 },
+        { BMTest::EQ, 8, 1, '.' },
+        { BMTest::EQ, 18, 1, 2 },
+        { BMTest::EQ, 20, 2, ('.' << 8) | '.' } },
+        { Ext3::DIR_BLOCK } });
+
+    return sigs;
+}
+
+/* the backup in group 1, for each block size with the default number of
+ * blocks per group (8 * block size). group 0 starts at block 1 with 1K
+ * blocks, and at block 0 otherwise */
+static vector<u64> ext3_super_copies()
+{
+    vector<u64> copies;
+
+    for (u64 bs = 1024; bs <= 4096; bs <<= 1)
+        copies.push_back((8 * bs + (bs == 1024 ? 1 : 0)) * bs);
+
+    return copies;
+}
+
+int main(int argc, const char * argv[])
+{
+    BMOptions opt;
+    BlockIO io;
+    Ext3 ext3(io);
+    const char * filename;
+    Ext3::Ext3SuperBlock * super;
+    unsigned block_size;
+    u64 where;
+    long ret;
+
+    if (bm_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+
+    if ((super = (Ext3::Ext3SuperBlock *)bm_fetch_super(ext3,
+        EXT3_SUPER_OFFSET, sizeof(struct ext3_super_block),
+        ext3_super_copies(), where)) == nullptr) {
+        cout << filename << ": CORRUPT, io error or super block and its "
+             << "backups are corrupted" << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (where != EXT3_SUPER_OFFSET)
+        cout << filename << ": using the backup super block at byte "
+             << where << endl;
+
+    block_size = 1024 << super->s_log_block_size;
+    io.set_block_size(block_size);
+
+    ret = bm_classify_image(ext3, super, filename, block_size,
+        ext3_signatures(block_size), opt);
+    super->destroy();
+
+    if (ret < 0) {
+        cout << filename << ": error " << ret << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,89 @@
+/*
+ * bmf2fs.cpp
+ *
+ * contains main() for bootstraping to libf2fs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libf2fs.h>
+#include <cstddef>
+#include <iostream>
+#include "blockmap.h"
+
+using namespace std;
+
+#define F2FS_SUPER_MAGIC 0xF2F52010
+
+static vector<BMSignature> f2fs_signatures()
+{
+    vector<BMSignature> sigs;
+    const unsigned nid = F2FS_NODE_NUM_BYTES + offsetof(struct node_footer, nid);
+    const unsigned ino = F2FS_NODE_NUM_BYTES + offsetof(struct node_footer, ino);
+
+    /* both copies of the super block are 1K into their block */
+    sigs.push_back(BMSignature{ F2FS_SUPER_OFFSET, {
+        { BMTest::EQ, F2FS_SUPER_OFFSET +
+          offsetof(struct f2fs_super_block, magic), 4, F2FS_SUPER_MAGIC } },
+        { F2FS::F2FS_SUPER_BLOCK } });
+
+    /* an inode is the node whose id is its inode number. other nodes have
+     * nothing in their footer that tells a direct node from an indirect
+     * one, so they are not carved */
+    sigs.push_back(BMSignature{ 0, {
+        { BMTest::NE, nid, 4, 0 },
+        { BMTest::SAME, nid, 4, ino } },
+        { F2FS::INODE_BLOCK } });
+
+    return sigs;
+}
+
+int main(int argc, const char * argv[])
+{
+    BMOptions opt;
+    BlockIO io;
+    F2FS f2fs(io);
+    const char * filename;
+    FS::Container * super;
+    long ret;
+    u64 where;
+
+    if (bm_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+
+    /* f2fs always uses this block size */
+    io.set_block_size(F2FS_BLKSIZE);
+
+    /* the second copy is in the next block, at the same offset */
+    if ((super = bm_fetch_super(f2fs, F2FS_SUPER_OFFSET,
+        sizeof(struct f2fs_super_block),
+        vector<u64>{ F2FS_BLKSIZE + F2FS_SUPER_OFFSET }, where)) == nullptr) {
+        cout << filename << ": CORRUPT, io error or super block and its "
+             << "copy are corrupted" << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (where != F2FS_SUPER_OFFSET)
+        cout << filename << ": using the second super block at byte "
+             << where << endl;
+
+    ret = bm_classify_image(f2fs, super, filename, F2FS_BLKSIZE,
+        f2fs_signatures(), opt);
+    super->destroy();
+
+    if (ret < 0) {
+        cout << filename << ": error " << ret << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
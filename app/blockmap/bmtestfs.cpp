@@ -0,0 +1,88 @@
+/*
+ * bmtestfs.cpp
+ *
+ * contains main() for bootstraping to libtestfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libtestfs.h>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include "blockmap.h"
+
+using namespace std;
+
+/* the first block of a directory starts with "." and "..", whose names
+ * include their terminating nul */
+static vector<BMSignature> testfs_signatures()
+{
+    const unsigned dot = sizeof(struct dirent) + 2;
+
+    return vector<BMSignature>{ BMSignature{ 0, {
+        { BMTest::EQ, offsetof(struct dirent, d_rec_len), 2, dot },
+        { BMTest::EQ, offsetof(struct dirent, d_name_len), 2, 2 },
+        { BMTest::EQ, sizeof(struct dirent), 2, '.' },
+        { BMTest::EQ, dot + offsetof(struct dirent, d_name_len), 2, 3 },
+        { BMTest::EQ, dot + sizeof(struct dirent), 2, ('.' << 8) | '.' } },
+        { TestFS::DIR_BLOCK } } };
+}
+
+/* testfs keeps no copy of its super block, but every image has the layout
+ * that testfs_make_super_block gives it, so a damaged one is stood in for
+ * by a super block with that layout */
+static FS::Container * testfs_default_super(TestFS & testfs)
+{
+    struct dsuper_block sb;
+
+    memset(&sb, 0, sizeof(sb));
+    sb.inode_freemap_start = SUPER_BLOCK_SIZE;
+    sb.block_freemap_start = sb.inode_freemap_start + INODE_FREEMAP_SIZE;
+    sb.inode_blocks_start = sb.block_freemap_start + BLOCK_FREEMAP_SIZE;
+    sb.data_blocks_start = sb.inode_blocks_start + NR_INODE_BLOCKS;
+
+    return testfs.parse_super(0, (const char *)&sb, sizeof(sb));
+}
+
+int main(int argc, const char * argv[])
+{
+    BMOptions opt;
+    BlockIO io;
+    TestFS testfs(io);
+    const char * filename;
+    FS::Container * super;
+    long ret;
+
+    if (bm_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+
+    io.set_block_size(BLOCK_SIZE);
+
+    if ((super = testfs.fetch_super()) == nullptr) {
+        cout << filename << ": super block is corrupted, assuming the "
+             << "default layout" << endl;
+        if ((super = testfs_default_super(testfs)) == nullptr)
+            return EXIT_FAILURE;
+    }
+
+    ret = bm_classify_image(testfs, super, filename, BLOCK_SIZE,
+        testfs_signatures(), opt);
+    super->destroy();
+
+    if (ret < 0) {
+        cout << filename << ": error " << ret << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
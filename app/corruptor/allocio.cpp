@@ -0,0 +1,126 @@
+/*
+ * allocio.cpp
+ *
+ * implementation of the allocations of AllocIO
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include "allocio.h"
+#include <cerrno>
+#include <cstring>
+
+int AllocIO::load()
+{
+    int ret;
+    
+    if (loaded)
+        return 0;
+    
+    if (block_size == 0)
+        return FS::ERR_UNINIT;
+    
+    if ((ret = load_bitmaps()) < 0) {
+        blocks = FS::BitmapAllocator();
+        inodes = FS::BitmapAllocator();
+        return ret;
+    }
+    
+    loaded = true;
+    return 0;
+}
+
+int AllocIO::read_raw(off_t pos, size_t size, void * out)
+{
+    char * buf;
+    int ret;
+    
+    if ((ret = read_internal(pos, size, buf)) < 0)
+        return ret;
+    
+    memcpy(out, buf, size);
+    delete [] buf;
+    return ret;
+}
+
+int AllocIO::alloc(FS::Location & loc, int type)
+{
+    unsigned long goal = 0;
+    u64 start;
+    int ret;
+    
+    // only blocks are allocated, whose address space is the first one after
+    // the generic ones in both ext3 and testfs
+    if (loc.aspc != FS::NUM_ADDRSPACES || loc.size == 0)
+        return -EINVAL;
+    
+    if ((ret = load()) < 0)
+        return ret;
+    
+    if (loc.dynamic == FS::Location::ADDR_NUMBER)
+        goal = loc.addr;
+    
+    if ((ret = blocks.alloc(goal, (loc.size + block_size - 1) / block_size, 
+            start)) < 0)
+        return ret;
+    
+    loc.set_address((unsigned long)start);
+    loc.offset = 0;
+    return 0;
+}
+
+int AllocIO::alloc_inode(unsigned long goal, unsigned long & ino)
+{
+    u64 start;
+    int ret;
+    
+    if ((ret = load()) < 0)
+        return ret;
+    
+    if ((ret = inodes.alloc(goal, 1, start)) < 0)
+        return ret;
+    
+    ino = start;
+    return 0;
+}
+
+int AllocIO::release(const FS::Location & loc)
+{
+    int ret;
+    
+    if (loc.aspc != FS::NUM_ADDRSPACES || loc.size == 0 || loc.offset != 0 ||
+        loc.dynamic != FS::Location::ADDR_NUMBER)
+        return -EINVAL;
+    
+    if ((ret = load()) < 0)
+        return ret;
+    
+    return blocks.release(loc.addr, (loc.size + block_size - 1) / block_size);
+}
+
+int AllocIO::release_inode(unsigned long ino)
+{
+    int ret;
+    
+    if ((ret = load()) < 0)
+        return ret;
+    
+    return inodes.release(ino, 1);
+}
+
+int AllocIO::flush()
+{
+    FS::WriteBatch batch(*this);
+    int ret;
+    
+    if ((ret = blocks.flush(batch)) < 0 || (ret = inodes.flush(batch)) < 0)
+        return ret;
+    
+    if (batch.size() == 0)
+        return 0;
+    
+    return batch.flush();
+}
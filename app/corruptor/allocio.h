@@ -0,0 +1,49 @@
+/*
+ * allocio.h
+ *
+ * adds block and inode allocation to BlockIO. the bitmaps of the file system
+ * are loaded on the first allocation, which is then served from memory. the
+ * bitmaps that changed are written back by flush().
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#ifndef ALLOCIO_H
+#define ALLOCIO_H
+
+#include <libfs.h>
+#include "blockio.h"
+
+class AllocIO : public BlockIO
+{
+    bool loaded;
+    
+protected:
+    FS::BitmapAllocator blocks;
+    FS::BitmapAllocator inodes;
+    
+    // adds the bitmaps of the file system to blocks and inodes
+    virtual int load_bitmaps() = 0;
+    int load();
+    int read_raw(off_t pos, size_t size, void * out);
+    
+public:
+    AllocIO() : loaded(false) {}
+    
+    // allocates enough blocks for loc.size, near loc.addr if possible, and
+    // moves loc to the first of them
+    virtual int alloc(FS::Location & loc, int type) override;
+    
+    int alloc_inode(unsigned long goal, unsigned long & ino);
+    int release(const FS::Location & loc);
+    int release_inode(unsigned long ino);
+    
+    // writes back the bitmaps that changed, in one batch. returns number of
+    // bytes written, or negative value on error
+    int flush();
+};
+
+#endif /* ALLOCIO_H */
@@ -12,6 +12,9 @@
 #include "blockio.h"
 #include <cstdio>
 #include <cerrno>
+#include <vector>
+#include <sys/uio.h>
+#include <unistd.h>
 
 int BlockIO::read_internal(off_t pos, size_t size, char * & buf)
 {
@@ -145,3 +148,59 @@ int BlockIO::write(const FS::Location & loc, const char * buf)
 }
 
 
+
+long long BlockIO::get_position(const FS::Location & loc)
+{
+    switch (loc.aspc)
+    {
+    case FS::AS_BYTE:
+        return (long long)loc.addr + loc.offset;
+    case FS::NUM_ADDRSPACES:
+        if (block_size == 0)
+            return FS::ERR_UNINIT;
+        return (long long)loc.addr * block_size + loc.offset;
+    default:
+        break;
+    }
+    
+    return -EINVAL;
+}
+
+int BlockIO::write_vector(long long pos, const FS::IOVector * vec, 
+    unsigned cnt)
+{
+    std::vector<struct iovec> iov(cnt);
+    size_t total = 0;
+    ssize_t ret;
+    
+    if (fsimg == nullptr)
+        return FS::ERR_UNINIT;
+    
+    for (unsigned i = 0; i < cnt; i++) {
+        iov[i].iov_base = (void *)vec[i].buf;
+        iov[i].iov_len = vec[i].len;
+        total += vec[i].len;
+    }
+    
+    /* also drops what stdio has read ahead, which the write makes stale */
+    if (fflush(fsimg) != 0)
+        return -errno;
+    
+    if ((ret = pwritev(fileno(fsimg), iov.data(), cnt, pos)) < 0)
+        return -errno;
+    else if ((size_t)ret != total)
+        return -EIO;
+    
+    return ret;
+}
+
+int BlockIO::sync()
+{
+    if (fsimg == nullptr)
+        return FS::ERR_UNINIT;
+    
+    if (fflush(fsimg) != 0 || fsync(fileno(fsimg)) < 0)
+        return -errno;
+    
+    return 0;
+}
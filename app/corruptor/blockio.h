@@ -46,6 +46,11 @@ public:
     virtual int alloc(FS::Location & loc, int type) override {
         return FS::ERR_UNIMP;
     }
+    
+    virtual long long get_position(const FS::Location & loc) override;
+    virtual int write_vector(long long pos, const FS::IOVector * vec, 
+        unsigned cnt) override;
+    virtual int sync() override;
 };
 
 
@@ -144,18 +144,25 @@ int Corruptor::visit_container(FS::Container * ctn)
     /* at least one of the field is marked for corruption */
     if (num_corrupted > 0) {
         const FS::Location & loc = ctn->get_location();
-        ret = ctn->save(FS::SO_NO_ALLOC);
+        unsigned long addr = loc.addr;
+        
+        /* a misdirected write leaves the container as it was, and lands on
+         * a block that is allocated for it near its own */
+        ret = ctn->save(misdirect ? 0 : FS::SO_NO_ALLOC);
         
         if (ret < 0) {
             cout << "error while saving ";
         }
         else {
-            cout << ret << " bytes written to ";
+            cout << ret << " bytes queued for ";
             ret = 0;
         }
         
         cout << ctn->get_type() << " at " << fs.address_space_to_name(loc.aspc)
-             << " address " << loc.addr << endl;
+             << " address " << addr;
+        if (misdirect && ret == 0)
+            cout << " (misdirected to " << loc.addr << ")";
+        cout << endl;
     }
     
     if (victim.size() > 0) {
@@ -240,7 +247,8 @@ int PtrVisitor::visit(FS::Entity & ent)
 }
 
 Corruptor::Corruptor(FS::FileSystem & fs) : 
-        ptr_visitor(new PtrVisitor(this)), fs(fs), num_corrupted(0)
+        ptr_visitor(new PtrVisitor(this)), fs(fs), num_corrupted(0),
+        misdirect(false)
 {
     fs.set_serializer(&this->serializer);
 }
@@ -269,11 +277,29 @@ int Corruptor::run()
     
     /* initialize random */
     srand(time(NULL));
+    
+    /* the corrupted containers are queued during the walk, and written in
+     * order of their position once it is done */
+    if ((ret = fs.begin_batch()) < 0)
+        return ret;
+    
     if ((super = fs.fetch_super()) != nullptr) {
         ret = this->visit(*super);
         super->destroy();
     }
     
+    if (ret < 0) {
+        fs.flush_batch();
+    }
+    else if ((ret = fs.flush_batch()) < 0) {
+        eprintf("error while writing corrupted containers\n");
+        return ret;
+    }
+    else {
+        cout << ret << " bytes written" << endl;
+        ret = 0;
+    }
+    
     if (ret < 0) {
         eprintf("error while attempting type-specific corruption\n");
     }
@@ -290,12 +316,14 @@ int Corruptor::run()
 static void _print_usage(char * argv[]) 
 {
     eprintf("usage: %s -n NAME [-t TYPE=set][-v VAL=0][-s NUM=0][-r NUM=1]"
-            "[-h] DEVICE\n", argv[0]);
+            "[-w][-h] DEVICE\n", argv[0]);
     eprintf("\t-n NAME: corrupt field with NAME\n");
     eprintf("\t-t TYPE: set, add, or random\n");
     eprintf("\t-v VAL:  corrupt field with value (set or add only)\n");
     eprintf("\t-s NUM:  skip NUM number of matches\n");
     eprintf("\t-r NUM:  repeat the corruption NUM times\n");
+    eprintf("\t-w:      misdirect the writes to newly allocated blocks,\n"
+            "\t         leaving the originals intact (ext3 and testfs only)\n");
     eprintf("\t-h:      print this help message\n");
     eprintf("\tDEVICE:  device to corrupt (e.g. /dev/sdb1)\n");
     eprintf("Spiffy's type-specific file system corruption tool (v0.1)\n");
@@ -315,7 +343,7 @@ int Corruptor::process_arguments(int argc, char * argv[])
     int c;
 
     opterr = 0;
-    while ((c = getopt(argc, argv, "n:t:v:s:r:h")) != -1)
+    while ((c = getopt(argc, argv, "n:t:v:s:r:wh")) != -1)
     switch (c)
     {
         case 'n':
@@ -369,6 +397,9 @@ int Corruptor::process_arguments(int argc, char * argv[])
                 print_usage();
             }
             break;                     
+        case 'w':
+            misdirect = true;
+            break;
         case '?':
             if (strchr("ntvsr", optopt) != nullptr)
                 errx("option -%c requires an argument.\n", optopt);
@@ -59,6 +59,7 @@ class Corruptor : public FS::Visitor
     FS::FileSystem & fs;
     std::vector<Victim> victim;
     int num_corrupted;
+    bool misdirect;     /* write corrupted containers to new blocks */
     
     int visit_container(FS::Container * ctn);
     int visit_field(FS::Field * field);
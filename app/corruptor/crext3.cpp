@@ -13,13 +13,13 @@
 #include <libext3.h>
 #include <iostream>
 #include "corruptor.h"
-#include "blockio.h"
+#include "ext3allocio.h"
 
 using namespace std;
 
 int main(int argc, char * argv[]) 
 {
-    BlockIO io;
+    Ext3AllocIO io;
     Ext3 ext3(io);
     Corruptor corruptor(ext3);
     Ext3::Ext3SuperBlock * super;
@@ -41,6 +41,14 @@ int main(int argc, char * argv[])
         return EXIT_FAILURE;
     }
     
-    return corruptor.run();
+    ret = corruptor.run();
+    
+    /* bitmaps of anything that was allocated */
+    if (io.flush() < 0) {
+        cout << argv[0] << ": could not write back bitmaps" << endl;
+        return EXIT_FAILURE;
+    }
+    
+    return ret;
 }
 
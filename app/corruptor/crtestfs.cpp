@@ -13,13 +13,13 @@
 #include <libtestfs.h>
 #include <iostream>
 #include "corruptor.h"
-#include "blockio.h"
+#include "testfsallocio.h"
 
 using namespace std;
 
 int main(int argc, char * argv[]) 
 {
-    BlockIO io;
+    TestFSAllocIO io;
     TestFS testfs(io);
     Corruptor corruptor(testfs);
     int ret;
@@ -32,6 +32,14 @@ int main(int argc, char * argv[])
     }
     
     io.set_block_size(BLOCK_SIZE);
-    return corruptor.run();
+    ret = corruptor.run();
+    
+    /* bitmaps of anything that was allocated */
+    if (io.flush() < 0) {
+        cout << argv[0] << ": could not write back bitmaps" << endl;
+        return EXIT_FAILURE;
+    }
+    
+    return ret;
 }
 
@@ -0,0 +1,91 @@
+/*
+ * ext3allocio.cpp
+ *
+ * loads the bitmaps of every ext3 group from the group descriptor table
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include "ext3allocio.h"
+#include <cerrno>
+#include <vector>
+
+/* ext4 features that change the group descriptors or checksum the bitmaps */
+#define EXT4_FEATURE_INCOMPAT_64BIT         0x0080
+#define EXT4_FEATURE_RO_COMPAT_GDT_CSUM     0x0010
+#define EXT4_FEATURE_RO_COMPAT_METADATA_CSUM 0x0400
+
+int Ext3AllocIO::load_bitmaps()
+{
+    struct ext3_super_block sb;
+    std::vector<struct ext3_group_desc> groups;
+    std::vector<char> bitmap(block_size);
+    unsigned long nr_groups, first, count;
+    int ret;
+    
+    if ((ret = read_raw(1024, sizeof(sb), &sb)) < 0)
+        return ret;
+    
+    if (sb.s_magic != EXT3_SUPER_MAGIC || sb.s_blocks_per_group == 0 ||
+        sb.s_inodes_per_group == 0 || (1024u << sb.s_log_block_size) != 
+        block_size)
+        return FS::ERR_CORRUPT;
+    
+    /* a bitmap is one block */
+    if (sb.s_blocks_per_group > block_size * 8 ||
+        sb.s_inodes_per_group > block_size * 8)
+        return FS::ERR_CORRUPT;
+    
+    if ((sb.s_feature_incompat & (EXT4_FEATURE_INCOMPAT_64BIT | 
+            EXT3_FEATURE_INCOMPAT_META_BG)) ||
+        (sb.s_feature_ro_compat & (EXT4_FEATURE_RO_COMPAT_GDT_CSUM |
+            EXT4_FEATURE_RO_COMPAT_METADATA_CSUM)))
+        return FS::ERR_UNIMP;
+    
+    nr_groups = (sb.s_blocks_count - sb.s_first_data_block +
+        sb.s_blocks_per_group - 1) / sb.s_blocks_per_group;
+    groups.resize(nr_groups);
+    
+    /* the group descriptor table follows the super block */
+    if ((ret = read_raw((sb.s_first_data_block + 1) * (off_t)block_size, 
+            nr_groups * sizeof(struct ext3_group_desc), &groups[0])) < 0)
+        return ret;
+    
+    for (unsigned long g = 0; g < nr_groups; g++) {
+        const struct ext3_group_desc & gd = groups[g];
+        
+        if (!(gd.bg_flags & EXT3_BG_BLOCK_UNINIT)) {
+            FS::Location loc(FS::NUM_ADDRSPACES, block_size, 0, 
+                gd.bg_block_bitmap);
+            
+            first = sb.s_first_data_block + g * sb.s_blocks_per_group;
+            count = sb.s_blocks_count - first;
+            if (count > sb.s_blocks_per_group)
+                count = sb.s_blocks_per_group;
+            
+            if ((ret = read_raw(gd.bg_block_bitmap * (off_t)block_size, 
+                    block_size, &bitmap[0])) < 0 ||
+                (ret = blocks.add_bitmap(loc, first, count, &bitmap[0])) < 0)
+                return ret;
+        }
+        
+        if (!(gd.bg_flags & EXT3_BG_INODE_UNINIT)) {
+            FS::Location loc(FS::NUM_ADDRSPACES, block_size, 0, 
+                gd.bg_inode_bitmap);
+            
+            /* inode numbers start from 1 */
+            first = 1 + g * sb.s_inodes_per_group;
+            
+            if ((ret = read_raw(gd.bg_inode_bitmap * (off_t)block_size, 
+                    block_size, &bitmap[0])) < 0 ||
+                (ret = inodes.add_bitmap(loc, first, sb.s_inodes_per_group, 
+                    &bitmap[0])) < 0)
+                return ret;
+        }
+    }
+    
+    return 0;
+}
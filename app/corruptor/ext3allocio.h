@@ -0,0 +1,25 @@
+/*
+ * ext3allocio.h
+ *
+ * allocates from the block and inode bitmaps of ext3. groups whose bitmaps 
+ * are not initialized are left out.
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#ifndef EXT3ALLOCIO_H
+#define EXT3ALLOCIO_H
+
+#include <libext3.h>
+#include "allocio.h"
+
+class Ext3AllocIO : public AllocIO
+{
+protected:
+    virtual int load_bitmaps() override;
+};
+
+#endif /* EXT3ALLOCIO_H */
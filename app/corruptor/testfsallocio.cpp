@@ -0,0 +1,51 @@
+/*
+ * testfsallocio.cpp
+ *
+ * loads the freemaps of testfs, which are at fixed places given by its super
+ * block. bit n of the block freemap is data block n, and bit n of the inode
+ * freemap is inode number n
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include "testfsallocio.h"
+#include <cerrno>
+
+int TestFSAllocIO::load_bitmaps()
+{
+    struct dsuper_block sb;
+    char bitmap[BLOCK_SIZE];
+    unsigned long nr;
+    int ret;
+    
+    if (block_size != BLOCK_SIZE)
+        return FS::ERR_CORRUPT;
+    
+    if ((ret = read_raw(0, sizeof(sb), &sb)) < 0)
+        return ret;
+    
+    /* the inode freemap is one block, and has more bits than inodes */
+    FS::Location imap(FS::NUM_ADDRSPACES, BLOCK_SIZE, 0, sb.inode_freemap_start);
+    
+    if ((ret = read_raw(sb.inode_freemap_start * BLOCK_SIZE, BLOCK_SIZE, 
+            bitmap)) < 0 ||
+        (ret = inodes.add_bitmap(imap, 0, NR_INODE_BLOCKS * INODES_PER_BLOCK, 
+            bitmap)) < 0)
+        return ret;
+    
+    for (nr = 0; nr < BLOCK_FREEMAP_SIZE; nr++) {
+        FS::Location loc(FS::NUM_ADDRSPACES, BLOCK_SIZE, 0, 
+            sb.block_freemap_start + nr);
+        
+        if ((ret = read_raw((sb.block_freemap_start + nr) * BLOCK_SIZE, 
+                BLOCK_SIZE, bitmap)) < 0 ||
+            (ret = blocks.add_bitmap(loc, sb.data_blocks_start + 
+                nr * BLOCK_SIZE * 8, BLOCK_SIZE * 8, bitmap)) < 0)
+            return ret;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * testfsallocio.h
+ *
+ * allocates from the inode and block freemaps of testfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#ifndef TESTFSALLOCIO_H
+#define TESTFSALLOCIO_H
+
+#include <libtestfs.h>
+#include "allocio.h"
+
+class TestFSAllocIO : public AllocIO
+{
+protected:
+    virtual int load_bitmaps() override;
+};
+
+#endif /* TESTFSALLOCIO_H */
@@ -0,0 +1,850 @@
+/*
+ * btrfsio.cpp
+ *
+ * implementation of the btrfs raid address space. the chunk map is built
+ * once, from the system chunks in the super block and then from the chunk
+ * tree, so translating a logical address is a single ordered map lookup
+ * plus the stripe math of the chunk's profile
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include "btrfsio.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+/* the super block is always at 64K on every member device */
+#define BTRFS_SUPER_OFFSET 0x10000
+
+/* no tree is ever this deep */
+#define BTRFS_MAX_LEVEL 8
+
+#define BTRFS_UNSUPPORTED_PROFILES \
+    (BTRFS_BLOCK_GROUP_RAID5 | BTRFS_BLOCK_GROUP_RAID6)
+
+BtrfsIO::BtrfsIO() : BlockIO(), mounted(false), root_dirid(0) {}
+
+BtrfsIO::~BtrfsIO()
+{
+    for (FILE * img : images)
+        fclose(img);
+}
+
+int BtrfsIO::read_at(FILE * img, off_t pos, size_t size, char * buf)
+{
+    if (fseek(img, pos, SEEK_SET) < 0)
+        return -errno;
+
+    if (fread(buf, size, 1, img) != 1)
+        return -EIO;
+
+    return size;
+}
+
+int BtrfsIO::write_at(FILE * img, off_t pos, size_t size, const char * buf)
+{
+    if (fseek(img, pos, SEEK_SET) < 0)
+        return -errno;
+
+    if (fwrite(buf, size, 1, img) != 1)
+        return -EIO;
+
+    return size;
+}
+
+int BtrfsIO::add_device(const char * filename)
+{
+    FILE * img;
+
+    if (mounted)
+        return -EBUSY;
+
+    if ((img = fopen(filename, "rb+")) == nullptr)
+        return -errno;
+
+    images.push_back(img);
+    return 0;
+}
+
+int BtrfsIO::add_device(FILE * img)
+{
+    struct btrfs_super_block dev_sb;
+    u64 devid;
+    int ret;
+
+    if ((ret = read_at(img, BTRFS_SUPER_OFFSET, sizeof(dev_sb),
+            (char *)&dev_sb)) < 0)
+        return ret;
+
+    /* every member must belong to the file system of the primary device */
+    if (dev_sb.magic != BTRFS_MAGIC ||
+        memcmp(dev_sb.fsid, sb.fsid, sizeof(sb.fsid)) != 0)
+        return FS::ERR_CORRUPT;
+
+    devid = dev_sb.dev_item.devid;
+    if (devices.find(devid) != devices.end())
+        return -EEXIST;
+
+    devices.emplace(devid, img);
+    return 0;
+}
+
+int BtrfsIO::add_chunk(u64 start, const struct btrfs_chunk * chunk,
+    size_t size)
+{
+    unsigned num_stripes = chunk->num_stripes;
+    Chunk c;
+
+    if (size < sizeof(*chunk) ||
+        size < sizeof(*chunk) + num_stripes * sizeof(struct btrfs_stripe))
+        return FS::ERR_CORRUPT;
+
+    c.length = chunk->length;
+    c.stripe_len = chunk->stripe_len;
+    c.type = chunk->type;
+    c.sub_stripes = chunk->sub_stripes;
+
+    if (c.length == 0 || c.stripe_len == 0 || num_stripes == 0)
+        return FS::ERR_CORRUPT;
+
+    if ((c.type & BTRFS_BLOCK_GROUP_RAID10) &&
+        (c.sub_stripes == 0 || num_stripes % c.sub_stripes != 0))
+        return FS::ERR_CORRUPT;
+
+    for (unsigned i = 0; i < num_stripes; i++) {
+        Stripe s = { chunk->stripe[i].devid, chunk->stripe[i].offset };
+        c.stripes.push_back(s);
+    }
+
+    /* system chunks show up again in the chunk tree */
+    chunks[start] = std::move(c);
+    return 0;
+}
+
+int BtrfsIO::load_sys_chunks()
+{
+    const char * array = (const char *)sb.sys_chunk_array;
+    unsigned size = sb.sys_chunk_array_size;
+    unsigned pos = 0;
+    int ret;
+
+    if (size > sizeof(sb.sys_chunk_array))
+        return FS::ERR_CORRUPT;
+
+    /* the array is a packed list of (disk key, chunk) pairs */
+    while (pos + sizeof(struct btrfs_disk_key) < size) {
+        const struct btrfs_disk_key * key =
+            (const struct btrfs_disk_key *)(array + pos);
+        const struct btrfs_chunk * chunk;
+        unsigned len;
+
+        pos += sizeof(*key);
+        chunk = (const struct btrfs_chunk *)(array + pos);
+
+        if (key->type != BTRFS_CHUNK_ITEM_KEY ||
+            pos + sizeof(*chunk) > size)
+            return FS::ERR_CORRUPT;
+
+        len = sizeof(*chunk) + chunk->num_stripes * sizeof(struct btrfs_stripe);
+        if ((ret = add_chunk(key->offset, chunk, size - pos)) < 0)
+            return ret;
+
+        pos += len;
+    }
+
+    return 0;
+}
+
+int BtrfsIO::load_chunk_tree(u64 bytenr, int level)
+{
+    std::vector<char> buf(sb.nodesize);
+    const struct btrfs_header * header;
+    unsigned nritems;
+    int ret;
+
+    if (level < 0 || level >= BTRFS_MAX_LEVEL || buf.size() < sizeof(*header))
+        return FS::ERR_CORRUPT;
+
+    if ((ret = raid_read(bytenr, buf.size(), buf.data())) < 0)
+        return ret;
+
+    header = (const struct btrfs_header *)buf.data();
+    nritems = header->nritems;
+
+    if (header->bytenr != bytenr || header->level != level)
+        return FS::ERR_CORRUPT;
+
+    if (level > 0) {
+        const struct btrfs_node * node = (const struct btrfs_node *)header;
+
+        if (nritems > (buf.size() - sizeof(*header)) /
+                sizeof(struct btrfs_key_ptr))
+            return FS::ERR_CORRUPT;
+
+        for (unsigned i = 0; i < nritems; i++) {
+            if ((ret = load_chunk_tree(node->ptrs[i].blockptr, level - 1)) < 0)
+                return ret;
+        }
+
+        return 0;
+    }
+
+    const struct btrfs_leaf * leaf = (const struct btrfs_leaf *)header;
+    const char * data = buf.data() + sizeof(*header);
+    size_t data_size = buf.size() - sizeof(*header);
+
+    if (nritems > data_size / sizeof(struct btrfs_item))
+        return FS::ERR_CORRUPT;
+
+    for (unsigned i = 0; i < nritems; i++) {
+        const struct btrfs_item * item = &leaf->items[i];
+        unsigned offset = item->offset, size = item->size;
+
+        if (item->key.type != BTRFS_CHUNK_ITEM_KEY)
+            continue;
+
+        if (offset > data_size || size > data_size - offset)
+            return FS::ERR_CORRUPT;
+
+        if ((ret = add_chunk(item->key.offset,
+                (const struct btrfs_chunk *)(data + offset), size)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int BtrfsIO::mount()
+{
+    int ret;
+
+    if (mounted)
+        return 0;
+
+    if (fsimg == nullptr)
+        return FS::ERR_UNINIT;
+
+    if ((ret = read_at(fsimg, BTRFS_SUPER_OFFSET, sizeof(sb),
+            (char *)&sb)) < 0)
+        return ret;
+
+    if (sb.magic != BTRFS_MAGIC)
+        return FS::ERR_CORRUPT;
+
+    devices.clear();
+    chunks.clear();
+
+    if ((ret = add_device(fsimg)) < 0)
+        return ret;
+
+    for (FILE * img : images) {
+        if ((ret = add_device(img)) < 0)
+            return ret;
+    }
+
+    /* the chunk tree itself lives in the system chunks */
+    if ((ret = load_sys_chunks()) < 0 ||
+        (ret = load_chunk_tree(sb.chunk_root, sb.chunk_root_level)) < 0)
+        return ret;
+
+    mounted = true;
+    return 0;
+}
+
+/*
+ * finds where the given copy of a logical address lives. len is set to the
+ * number of bytes that are contiguous on that device from there on.
+ * returns -ENOENT if the chunk has fewer copies than mirror, or -ENODEV if
+ * that copy is on a missing device
+ */
+int BtrfsIO::map_logical(u64 logical, unsigned mirror, FILE * & img,
+    u64 & physical, u64 & len)
+{
+    auto it = chunks.upper_bound(logical);
+    u64 offset, stripe_nr, stripe_offset;
+    unsigned num_stripes, index = 0, copies;
+
+    if (it == chunks.begin())
+        return FS::ERR_CORRUPT;
+
+    --it;
+
+    const Chunk & c = it->second;
+
+    offset = logical - it->first;
+    if (offset >= c.length)
+        return FS::ERR_CORRUPT;
+
+    if (c.type & BTRFS_UNSUPPORTED_PROFILES)
+        return FS::ERR_UNIMP;
+
+    num_stripes = c.stripes.size();
+    stripe_nr = offset / c.stripe_len;
+    stripe_offset = offset % c.stripe_len;
+
+    if (c.type & BTRFS_BLOCK_GROUP_RAID0) {
+        index = stripe_nr % num_stripes;
+        stripe_nr /= num_stripes;
+        copies = 1;
+        len = c.stripe_len - stripe_offset;
+    }
+    else if (c.type & BTRFS_BLOCK_GROUP_RAID10) {
+        unsigned factor = num_stripes / c.sub_stripes;
+        index = (stripe_nr % factor) * c.sub_stripes;
+        stripe_nr /= factor;
+        copies = c.sub_stripes;
+        len = c.stripe_len - stripe_offset;
+    }
+    else {
+        /* single, dup and raid1 keep a whole copy on every stripe */
+        copies = num_stripes;
+        len = c.length - offset;
+    }
+
+    if (mirror >= copies)
+        return -ENOENT;
+
+    const Stripe & s = c.stripes[index + mirror];
+    auto dev = devices.find(s.devid);
+
+    if (dev == devices.end())
+        return -ENODEV;
+
+    img = dev->second;
+    physical = s.offset + stripe_nr * c.stripe_len + stripe_offset;
+    return 0;
+}
+
+int BtrfsIO::raid_read(u64 logical, size_t size, char * buf)
+{
+    size_t pos = 0;
+    int ret;
+
+    while (pos < size) {
+        unsigned mirror = 0;
+        FILE * img;
+        u64 physical, len;
+
+        /* fall back on the other copies of a missing or bad stripe */
+        do {
+            if ((ret = map_logical(logical + pos, mirror++, img, physical,
+                    len)) == -ENODEV)
+                continue;
+
+            /* no copy left to try */
+            if (ret == -ENOENT)
+                return -EIO;
+
+            if (ret < 0)
+                return ret;
+
+            if (len > size - pos)
+                len = size - pos;
+
+            ret = read_at(img, physical, len, buf + pos);
+        } while (ret < 0);
+
+        pos += len;
+    }
+
+    return size;
+}
+
+int BtrfsIO::raid_write(u64 logical, size_t size, const char * buf)
+{
+    size_t pos = 0;
+    int ret;
+
+    while (pos < size) {
+        unsigned mirror = 0, written = 0;
+        FILE * img;
+        u64 physical, len = 0;
+
+        /* every copy that is present must be updated */
+        while ((ret = map_logical(logical + pos, mirror++, img, physical,
+                len)) != -ENOENT) {
+            if (ret == -ENODEV)
+                continue;
+
+            if (ret < 0)
+                return ret;
+
+            if (len > size - pos)
+                len = size - pos;
+
+            if ((ret = write_at(img, physical, len, buf + pos)) < 0)
+                return ret;
+
+            written++;
+        }
+
+        if (written == 0)
+            return -ENODEV;
+
+        pos += len;
+    }
+
+    return size;
+}
+
+static struct btrfs_disk_key make_key(u64 objectid, u8 type, u64 offset)
+{
+    struct btrfs_disk_key key;
+
+    key.objectid = objectid;
+    key.type = type;
+    key.offset = offset;
+    return key;
+}
+
+static int key_compare(const struct btrfs_disk_key & a,
+    const struct btrfs_disk_key & b)
+{
+    if (a.objectid != b.objectid)
+        return (a.objectid < b.objectid) ? -1 : 1;
+
+    if (a.type != b.type)
+        return (a.type < b.type) ? -1 : 1;
+
+    if (a.offset != b.offset)
+        return (a.offset < b.offset) ? -1 : 1;
+
+    return 0;
+}
+
+bool BtrfsIO::Path::valid() const
+{
+    const struct btrfs_header * header;
+
+    if (levels.empty())
+        return false;
+
+    header = (const struct btrfs_header *)levels[0].buf.data();
+    return levels[0].slot < header->nritems;
+}
+
+const struct btrfs_item * BtrfsIO::Path::item() const
+{
+    const struct btrfs_leaf * leaf;
+
+    leaf = (const struct btrfs_leaf *)levels[0].buf.data();
+    return &leaf->items[levels[0].slot];
+}
+
+const struct btrfs_disk_key & BtrfsIO::Path::key() const
+{
+    return item()->key;
+}
+
+const char * BtrfsIO::Path::data() const
+{
+    return levels[0].buf.data() + sizeof(struct btrfs_header) +
+        item()->offset;
+}
+
+unsigned BtrfsIO::Path::size() const
+{
+    return item()->size;
+}
+
+/*
+ * reads a tree block and checks that its key pointers or items are within
+ * the block, so that a path never has to check them again
+ */
+int BtrfsIO::read_tree_block(u64 bytenr, int level, std::vector<char> & buf)
+{
+    const struct btrfs_header * header;
+    const struct btrfs_leaf * leaf;
+    unsigned nritems;
+    size_t size;
+    int ret;
+
+    if (level < 0 || level >= BTRFS_MAX_LEVEL)
+        return FS::ERR_CORRUPT;
+
+    buf.resize(sb.nodesize);
+    if (buf.size() < sizeof(*header))
+        return FS::ERR_CORRUPT;
+
+    if ((ret = raid_read(bytenr, buf.size(), buf.data())) < 0)
+        return ret;
+
+    header = (const struct btrfs_header *)buf.data();
+    if (header->bytenr != bytenr || header->level != level)
+        return FS::ERR_CORRUPT;
+
+    nritems = header->nritems;
+    size = buf.size() - sizeof(*header);
+
+    /* only a leaf can be empty, and only when it is the root */
+    if (level > 0) {
+        if (nritems == 0 || nritems > size / sizeof(struct btrfs_key_ptr))
+            return FS::ERR_CORRUPT;
+        return 0;
+    }
+
+    if (nritems > size / sizeof(struct btrfs_item))
+        return FS::ERR_CORRUPT;
+
+    leaf = (const struct btrfs_leaf *)header;
+    for (unsigned i = 0; i < nritems; i++) {
+        unsigned offset = leaf->items[i].offset;
+
+        if (offset > size || leaf->items[i].size > size - offset)
+            return FS::ERR_CORRUPT;
+    }
+
+    return 0;
+}
+
+/* a tree is at the root item of its objectid with the largest offset */
+int BtrfsIO::read_root_item(u64 root_objectid, Item & item)
+{
+    std::vector<Item> items;
+    int ret;
+
+    if ((ret = find_items(BTRFS_ROOT_TREE_OBJECTID,
+            make_key(root_objectid, BTRFS_ROOT_ITEM_KEY, 0),
+            make_key(root_objectid, BTRFS_ROOT_ITEM_KEY, ~0ULL), items)) < 0)
+        return ret;
+
+    if (items.empty())
+        return -ENOENT;
+
+    /* older root items are shorter, but always have the root block */
+    if (items.back().data.size() < offsetof(struct btrfs_root_item, level) +
+            sizeof(((struct btrfs_root_item *)0)->level))
+        return FS::ERR_CORRUPT;
+
+    item = std::move(items.back());
+    return 0;
+}
+
+int BtrfsIO::find_root(u64 root_objectid, Root & root)
+{
+    const struct btrfs_root_item * ri;
+    Item item;
+    int ret;
+
+    auto it = roots.find(root_objectid);
+    if (it != roots.end()) {
+        root = it->second;
+        return 0;
+    }
+
+    /* the super block has the roots needed to find all other roots */
+    if (root_objectid == BTRFS_ROOT_TREE_OBJECTID) {
+        root.bytenr = sb.root;
+        root.level = sb.root_level;
+    }
+    else if (root_objectid == BTRFS_CHUNK_TREE_OBJECTID) {
+        root.bytenr = sb.chunk_root;
+        root.level = sb.chunk_root_level;
+    }
+    else {
+        if ((ret = read_root_item(root_objectid, item)) < 0)
+            return ret;
+
+        ri = (const struct btrfs_root_item *)item.data.data();
+        root.bytenr = ri->bytenr;
+        root.level = ri->level;
+    }
+
+    if (root.level >= BTRFS_MAX_LEVEL)
+        return FS::ERR_CORRUPT;
+
+    roots[root_objectid] = root;
+    return 0;
+}
+
+/*
+ * moves a path whose leaf slot is past the end of its leaf to the first
+ * item of the next leaf, it stays past the end if there is none
+ */
+int BtrfsIO::next_leaf(Path & path)
+{
+    unsigned level = 1;
+    int ret;
+
+    while (!path.valid()) {
+        const struct btrfs_node * node;
+
+        /* the lowest level that has a block to the right */
+        for (; level < path.levels.size(); level++) {
+            node = (const struct btrfs_node *)path.levels[level].buf.data();
+            if (path.levels[level].slot + 1 < node->header.nritems)
+                break;
+        }
+
+        if (level == path.levels.size())
+            return 0;
+
+        path.levels[level].slot++;
+
+        /* and its leftmost blocks down to the leaf */
+        for (; level > 0; level--) {
+            Path::Level & lower = path.levels[level - 1];
+
+            node = (const struct btrfs_node *)path.levels[level].buf.data();
+            if ((ret = read_tree_block(node->ptrs[path.levels[level].slot].
+                    blockptr, level - 1, lower.buf)) < 0)
+                return ret;
+
+            lower.slot = 0;
+        }
+
+        level = 1;
+    }
+
+    return 0;
+}
+
+int BtrfsIO::search(u64 root_objectid, const struct btrfs_disk_key & key,
+    Path & path)
+{
+    Root root;
+    u64 bytenr;
+    int ret;
+
+    path.levels.clear();
+
+    if ((ret = mount()) < 0 || (ret = find_root(root_objectid, root)) < 0)
+        return ret;
+
+    path.levels.resize(root.level + 1);
+    bytenr = root.bytenr;
+
+    for (int level = root.level; level >= 0; level--) {
+        Path::Level & lv = path.levels[level];
+        const struct btrfs_header * header;
+        unsigned lo = 0, hi;
+
+        if ((ret = read_tree_block(bytenr, level, lv.buf)) < 0) {
+            path.levels.clear();
+            return ret;
+        }
+
+        header = (const struct btrfs_header *)lv.buf.data();
+        hi = header->nritems;
+
+        if (level > 0) {
+            const struct btrfs_node * node = (const struct btrfs_node *)header;
+
+            /* the last block starting at or before the key */
+            while (lo < hi) {
+                unsigned mid = lo + (hi - lo) / 2;
+
+                if (key_compare(node->ptrs[mid].key, key) <= 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            lv.slot = (lo > 0) ? lo - 1 : 0;
+            bytenr = node->ptrs[lv.slot].blockptr;
+        }
+        else {
+            const struct btrfs_leaf * leaf = (const struct btrfs_leaf *)header;
+
+            /* the first item not less than the key */
+            while (lo < hi) {
+                unsigned mid = lo + (hi - lo) / 2;
+
+                if (key_compare(leaf->items[mid].key, key) < 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            lv.slot = lo;
+        }
+    }
+
+    /* every item of the leaf is less than the key */
+    return next_leaf(path);
+}
+
+int BtrfsIO::next(Path & path)
+{
+    if (!path.valid())
+        return 0;
+
+    path.levels[0].slot++;
+    return next_leaf(path);
+}
+
+int BtrfsIO::find_item(u64 root_objectid, const struct btrfs_disk_key & key,
+    Item & item)
+{
+    Path path;
+    int ret;
+
+    if ((ret = search(root_objectid, key, path)) < 0)
+        return ret;
+
+    if (!path.valid() || key_compare(path.key(), key) != 0)
+        return -ENOENT;
+
+    item.key = path.key();
+    item.data.assign(path.data(), path.data() + path.size());
+    return 0;
+}
+
+int BtrfsIO::find_items(u64 root_objectid, const struct btrfs_disk_key & min,
+    const struct btrfs_disk_key & max, std::vector<Item> & items)
+{
+    Path path;
+    int ret;
+
+    if ((ret = search(root_objectid, min, path)) < 0)
+        return ret;
+
+    while (path.valid() && key_compare(path.key(), max) <= 0) {
+        items.emplace_back();
+        items.back().key = path.key();
+        items.back().data.assign(path.data(), path.data() + path.size());
+
+        if ((ret = next(path)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int BtrfsIO::mount_fs_tree()
+{
+    const struct btrfs_root_item * ri;
+    Item item;
+    int ret;
+
+    if (root_dirid != 0)
+        return 0;
+
+    if ((ret = mount()) < 0 ||
+        (ret = read_root_item(BTRFS_FS_TREE_OBJECTID, item)) < 0)
+        return (ret == -ENOENT) ? (int)FS::ERR_CORRUPT : ret;
+
+    ri = (const struct btrfs_root_item *)item.data.data();
+    root_dirid = ri->root_dirid;
+    return 0;
+}
+
+int BtrfsIO::get_root(unsigned long & ino)
+{
+    int ret;
+
+    if ((ret = mount_fs_tree()) < 0)
+        return ret;
+
+    ino = root_dirid;
+    return 0;
+}
+
+int BtrfsIO::read_dir(unsigned long dir, std::vector<FS::Dirent> & ents)
+{
+    std::vector<Item> items;
+    FS::Stat st;
+    int ret;
+
+    if ((ret = read_inode(dir, st)) < 0)
+        return ret;
+
+    if (!st.is_dir())
+        return -ENOTDIR;
+
+    /* dir index items are in the order the names were created */
+    if ((ret = find_items(BTRFS_FS_TREE_OBJECTID,
+            make_key(dir, BTRFS_DIR_INDEX_KEY, 0),
+            make_key(dir, BTRFS_DIR_INDEX_KEY, ~0ULL), items)) < 0)
+        return ret;
+
+    for (const Item & item : items) {
+        const struct btrfs_dir_item * di;
+        unsigned len;
+
+        if (item.data.size() < sizeof(*di))
+            return FS::ERR_CORRUPT;
+
+        di = (const struct btrfs_dir_item *)item.data.data();
+        len = di->name_len;
+
+        if (sizeof(*di) + len > item.data.size())
+            return FS::ERR_CORRUPT;
+
+        /* subvolumes are separate trees, which are not followed */
+        if (di->location.type != BTRFS_INODE_ITEM_KEY)
+            continue;
+
+        ents.emplace_back(di->location.objectid, di->type,
+            (const char *)(di + 1), len);
+    }
+
+    return 0;
+}
+
+int BtrfsIO::read_inode(unsigned long ino, FS::Stat & st)
+{
+    const struct btrfs_inode_item * ii;
+    Item item;
+    int ret;
+
+    if ((ret = mount_fs_tree()) < 0 ||
+        (ret = find_item(BTRFS_FS_TREE_OBJECTID,
+            make_key(ino, BTRFS_INODE_ITEM_KEY, 0), item)) < 0)
+        return ret;
+
+    if (item.data.size() < sizeof(*ii))
+        return FS::ERR_CORRUPT;
+
+    ii = (const struct btrfs_inode_item *)item.data.data();
+
+    st.ino = ino;
+    st.mode = ii->mode;
+    st.nlink = ii->nlink;
+    st.uid = ii->uid;
+    st.gid = ii->gid;
+    st.size = ii->size;
+    st.mtime = ii->mtime.sec;
+    return 0;
+}
+
+int BtrfsIO::read(const FS::Location & loc, char * & buf)
+{
+    int ret;
+
+    if (loc.aspc != Btrfs::AS_RAID)
+        return BlockIO::read(loc, buf);
+
+    buf = nullptr;
+
+    if ((ret = mount()) < 0)
+        return ret;
+
+    if ((buf = new char[loc.size]) == nullptr)
+        return -ENOMEM;
+
+    if ((ret = raid_read(loc.addr + loc.offset, loc.size, buf)) < 0) {
+        delete [] buf;
+        buf = nullptr;
+    }
+
+    return ret;
+}
+
+int BtrfsIO::write(const FS::Location & loc, const char * buf)
+{
+    int ret;
+
+    if (loc.aspc != Btrfs::AS_RAID)
+        return BlockIO::write(loc, buf);
+
+    if ((ret = mount()) < 0)
+        return ret;
+
+    return raid_write(loc.addr + loc.offset, loc.size, buf);
+}
+
@@ -0,0 +1,158 @@
+/*
+ * btrfsio.h
+ *
+ * adds the btrfs raid address space on top of BlockIO. a location in the
+ * raid address space is a logical byte address, which is translated through
+ * the chunk tree to a physical offset on one of the member devices. it is
+ * also the name adapter of btrfs, for the default subvolume.
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#ifndef BTRFSIO_H
+#define BTRFSIO_H
+
+#include <libbtrfs.h>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "blockio.h"
+
+/* well-known trees, by the objectid of their root item */
+#define BTRFS_ROOT_TREE_OBJECTID 1
+#define BTRFS_EXTENT_TREE_OBJECTID 2
+#define BTRFS_CHUNK_TREE_OBJECTID 3
+#define BTRFS_DEV_TREE_OBJECTID 4
+#define BTRFS_FS_TREE_OBJECTID 5
+#define BTRFS_CSUM_TREE_OBJECTID 7
+
+class BtrfsIO : public BlockIO, public FS::NameAdapter
+{
+public:
+    // a position in a tree, with the block and slot of every level from the
+    // leaf (levels[0]) up to the root. it is only valid until the tree is
+    // written to, and is past the end once valid() is false
+    class Path
+    {
+        friend class BtrfsIO;
+
+        struct Level
+        {
+            std::vector<char> buf;
+            unsigned slot;
+        };
+
+        std::vector<Level> levels;
+
+        const struct btrfs_item * item() const;
+
+    public:
+        bool valid() const;
+        const struct btrfs_disk_key & key() const;
+        const char * data() const;
+        unsigned size() const;
+    };
+
+    // a copy of a leaf item
+    struct Item
+    {
+        struct btrfs_disk_key key;
+        std::vector<char> data;
+    };
+
+private:
+    struct Stripe
+    {
+        u64 devid;
+        u64 offset;
+    };
+
+    // logical bytes [start, start + length) of a chunk, keyed by start
+    struct Chunk
+    {
+        u64 length;
+        u64 stripe_len;
+        u64 type;
+        unsigned sub_stripes;
+        std::vector<Stripe> stripes;
+    };
+
+    // root block of a tree
+    struct Root
+    {
+        u64 bytenr;
+        int level;
+    };
+
+    struct btrfs_super_block sb;
+    bool mounted;
+
+    // roots of the trees searched so far, keyed by objectid
+    std::unordered_map<u64, Root> roots;
+    u64 root_dirid;
+
+    // devices opened by add_device, all members (including the primary
+    // image) are keyed by devid once mounted
+    std::vector<FILE *> images;
+    std::unordered_map<u64, FILE *> devices;
+
+    // chunks never overlap, so ordering them by start gives an interval
+    // tree where the owner of an address is the last chunk starting at or
+    // before it
+    std::map<u64, Chunk> chunks;
+
+    static int read_at(FILE * img, off_t pos, size_t size, char * buf);
+    static int write_at(FILE * img, off_t pos, size_t size, const char * buf);
+
+    int add_device(FILE * img);
+    int add_chunk(u64 start, const struct btrfs_chunk * chunk, size_t size);
+    int load_sys_chunks();
+    int load_chunk_tree(u64 bytenr, int level);
+
+    int mount();
+    int map_logical(u64 logical, unsigned mirror, FILE * & img, u64 & physical,
+        u64 & len);
+    int raid_read(u64 logical, size_t size, char * buf);
+    int raid_write(u64 logical, size_t size, const char * buf);
+
+    int read_tree_block(u64 bytenr, int level, std::vector<char> & buf);
+    int read_root_item(u64 root_objectid, Item & item);
+    int find_root(u64 root_objectid, Root & root);
+    int next_leaf(Path & path);
+    int mount_fs_tree();
+
+public:
+    BtrfsIO();
+    virtual ~BtrfsIO() override;
+
+    // opens another member device of a multi-device file system
+    int add_device(const char * filename);
+
+    // positions path at the first item of a tree whose key is not less than
+    // key, reading one block per level of the tree
+    int search(u64 root_objectid, const struct btrfs_disk_key & key,
+        Path & path);
+    // moves path to the item after the current one
+    int next(Path & path);
+
+    // copies the item with exactly this key, -ENOENT if there is none
+    int find_item(u64 root_objectid, const struct btrfs_disk_key & key,
+        Item & item);
+    // copies every item with a key in [min, max]
+    int find_items(u64 root_objectid, const struct btrfs_disk_key & min,
+        const struct btrfs_disk_key & max, std::vector<Item> & items);
+
+    virtual int get_root(unsigned long & ino) override;
+    virtual int read_dir(unsigned long dir,
+        std::vector<FS::Dirent> & ents) override;
+    virtual int read_inode(unsigned long ino, FS::Stat & st) override;
+
+    virtual int read(const FS::Location & loc, char * & buf) override;
+    virtual int write(const FS::Location & loc, const char * buf) override;
+};
+
+#endif /* BTRFSIO_H */
+
@@ -0,0 +1,1332 @@
+/*
+ * ext3io.cpp
+ *
+ * implementation of the ext3 file address space. logical to physical block
+ * mappings are resolved from the indirect blocks or the ext4 extent tree of
+ * the inode, and memoized as extent ranges so that the index blocks are only
+ * read once per file
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include "ext3io.h"
+#include <cerrno>
+#include <cstring>
+#include <endian.h>
+
+/* ee_len above this marks an uninitialized extent */
+#define EXT_INIT_MAX_LEN (1UL << 15)
+
+/* jbd2 features that change the layout of descriptor and revoke blocks */
+#define JBD2_FEATURE_INCOMPAT_64BIT     0x00000002
+#define JBD2_FEATURE_INCOMPAT_CSUM_V2   0x00000008
+#define JBD2_FEATURE_INCOMPAT_CSUM_V3   0x00000010
+
+/* htree directories */
+#define EXT3_SB_FLAGS_OFFSET        0x160
+#define EXT2_FLAGS_UNSIGNED_HASH    0x0002
+#define EXT3_S_IFMT                 0xF000
+#define EXT4_INLINE_DATA_FL         0x10000000
+
+#define DX_HASH_LEGACY              0
+#define DX_HASH_HALF_MD4            1
+#define DX_HASH_TEA                 2
+#define DX_HASH_UNSIGNED_DELTA      3
+
+/* the root holds "." and ".." followed by dx_root_info */
+#define DX_ROOT_INFO_OFFSET         24
+#define DX_MAX_LEVELS               3
+
+/* the top bits of a dx_entry block are reserved */
+#define DX_BLOCK_MASK               0x0fffffff
+
+/* the annotated dx structures are not compiled yet, so these are only the
+ * raw layouts used by lookup */
+struct dx_root_info
+{
+    __le32 reserved_zero;
+    __u8   hash_version;
+    __u8   info_length;
+    __u8   indirect_levels;
+    __u8   unused_flags;
+};
+
+struct dx_countlimit
+{
+    __le16 limit;
+    __le16 count;
+};
+
+struct dx_entry
+{
+    __le32 hash;
+    __le32 block;
+};
+
+/* annotated journal structures only hold the fields they add to their base,
+ * so on disk each one follows the structures it derives from */
+#define JOURNAL_HEADER_SIZE \
+    (sizeof(struct journal_block) + sizeof(struct journal_header))
+
+Ext3IO::Ext3IO() : BlockIO(), mounted(false), unsigned_hash(false) {}
+
+int Ext3IO::raw_read(off_t pos, size_t size, char * buf)
+{
+    if (fsimg == nullptr)
+        return FS::ERR_UNINIT;
+
+    if (fseek(fsimg, pos, SEEK_SET) < 0)
+        return -errno;
+
+    if (fread(buf, size, 1, fsimg) != 1)
+        return -EIO;
+
+    return size;
+}
+
+int Ext3IO::raw_write(off_t pos, size_t size, const char * buf)
+{
+    if (fsimg == nullptr)
+        return FS::ERR_UNINIT;
+
+    if (fseek(fsimg, pos, SEEK_SET) < 0)
+        return -errno;
+
+    if (fwrite(buf, size, 1, fsimg) != 1)
+        return -EIO;
+
+    return size;
+}
+
+int Ext3IO::read_copy(const JournalCopy & copy, char * buf)
+{
+    const __be32 magic = htobe32(JFS_MAGIC_NUMBER);
+    int ret;
+
+    if ((ret = raw_read((off_t)copy.pblk * block_size, block_size, buf)) < 0)
+        return ret;
+
+    if (copy.escaped)
+        memcpy(buf, &magic, sizeof(magic));
+
+    return ret;
+}
+
+/* replaces the parts of buf that have a copy in the journal */
+int Ext3IO::patch(off_t pos, size_t size, char * buf)
+{
+    std::vector<char> copy;
+    int ret;
+
+    if (overlay.empty() || size == 0)
+        return 0;
+
+    for (unsigned long blk = pos / block_size;
+         blk <= (pos + size - 1) / block_size; blk++) {
+        auto it = overlay.find(blk);
+        off_t start = (off_t)blk * block_size, end = start + block_size;
+
+        if (it == overlay.end())
+            continue;
+
+        copy.resize(block_size);
+        if ((ret = read_copy(it->second, &copy[0])) < 0)
+            return ret;
+
+        if (start < pos)
+            start = pos;
+        if (end > pos + (off_t)size)
+            end = pos + size;
+
+        memcpy(buf + (start - pos), &copy[start % block_size], end - start);
+    }
+
+    return 0;
+}
+
+/* writes back the journal copies of blocks that are about to be written */
+int Ext3IO::settle(off_t pos, size_t size)
+{
+    std::vector<char> copy;
+    int ret;
+
+    if (overlay.empty() || size == 0)
+        return 0;
+
+    for (unsigned long blk = pos / block_size;
+         blk <= (pos + size - 1) / block_size; blk++) {
+        auto it = overlay.find(blk);
+
+        if (it == overlay.end())
+            continue;
+
+        copy.resize(block_size);
+        if ((ret = read_copy(it->second, &copy[0])) < 0 ||
+            (ret = raw_write((off_t)blk * block_size, block_size,
+                             &copy[0])) < 0)
+            return ret;
+
+        overlay.erase(it);
+    }
+
+    return 0;
+}
+
+int Ext3IO::read_at(off_t pos, size_t size, char * buf)
+{
+    int ret;
+
+    if ((ret = raw_read(pos, size, buf)) < 0)
+        return ret;
+
+    return (ret = patch(pos, size, buf)) < 0 ? ret : (int)size;
+}
+
+int Ext3IO::write_at(off_t pos, size_t size, const char * buf)
+{
+    int ret;
+
+    if ((ret = settle(pos, size)) < 0)
+        return ret;
+
+    return raw_write(pos, size, buf);
+}
+
+int Ext3IO::read_block(unsigned long blknr, char * buf)
+{
+    if (blknr >= sb.s_blocks_count)
+        return FS::ERR_CORRUPT;
+
+    depends.insert(blknr);
+    return read_at((off_t)blknr * block_size, block_size, buf);
+}
+
+int Ext3IO::mount()
+{
+    unsigned long nr_groups, gdt_start, gdt_blocks;
+    std::vector<char> buf;
+    __le32 flags;
+    int ret;
+
+    if (mounted)
+        return 0;
+
+    if ((ret = read_at(1024, sizeof(sb), (char *)&sb)) < 0)
+        return ret;
+
+    if (sb.s_magic != EXT3_SUPER_MAGIC || sb.s_blocks_per_group == 0 ||
+        sb.s_inodes_per_group == 0 || sb.s_log_block_size > 6)
+        return FS::ERR_CORRUPT;
+
+    /* s_flags is past the end of the annotated super block */
+    if ((ret = read_at(1024 + EXT3_SB_FLAGS_OFFSET, sizeof(flags),
+            (char *)&flags)) < 0)
+        return ret;
+
+    unsigned_hash = (flags & EXT2_FLAGS_UNSIGNED_HASH) != 0;
+
+    if (block_size == 0)
+        set_block_size(1024 << sb.s_log_block_size);
+
+    nr_groups = (sb.s_blocks_count - sb.s_first_data_block +
+        sb.s_blocks_per_group - 1) / sb.s_blocks_per_group;
+    gdt_start = sb.s_first_data_block + 1;
+    gdt_blocks = (nr_groups * sizeof(struct ext3_group_desc) + block_size - 1)
+        / block_size;
+
+    buf.resize(gdt_blocks * block_size);
+    for (unsigned long i = 0; i < gdt_blocks; i++) {
+        if ((ret = read_block(gdt_start + i, &buf[i * block_size])) < 0)
+            return ret;
+    }
+
+    groups.resize(nr_groups);
+    memcpy(&groups[0], &buf[0], nr_groups * sizeof(struct ext3_group_desc));
+    mounted = true;
+    return 0;
+}
+
+void Ext3IO::invalidate_all()
+{
+    files.clear();
+    groups.clear();
+    depends.clear();
+    mounted = false;
+}
+
+void Ext3IO::invalidate(off_t pos, size_t size)
+{
+    if (!mounted || block_size == 0 || size == 0)
+        return;
+
+    for (unsigned long blk = pos / block_size;
+         blk <= (pos + size - 1) / block_size; blk++) {
+        if (depends.count(blk) > 0) {
+            invalidate_all();
+            return;
+        }
+    }
+}
+
+int Ext3IO::get_inode(unsigned long ino, FileMap * & fm)
+{
+    std::vector<char> buf;
+    unsigned long group, index;
+    off_t pos;
+    int ret;
+
+    auto it = files.find(ino);
+    if (it != files.end()) {
+        fm = &it->second;
+        return 0;
+    }
+
+    if (files.size() >= max_files)
+        invalidate_all();
+
+    if ((ret = mount()) < 0)
+        return ret;
+
+    if (ino == 0 || ino > sb.s_inodes_count)
+        return -EINVAL;
+
+    group = (ino - 1) / sb.s_inodes_per_group;
+    index = (ino - 1) % sb.s_inodes_per_group;
+    if (group >= groups.size())
+        return FS::ERR_CORRUPT;
+
+    pos = (off_t)groups[group].bg_inode_table * block_size +
+        (off_t)index * sb.s_inode_size;
+    buf.resize(block_size);
+    if ((ret = read_block(pos / block_size, &buf[0])) < 0)
+        return ret;
+
+    fm = &files[ino];
+    memcpy(&fm->inode, &buf[pos % block_size], sizeof(fm->inode));
+    return 0;
+}
+
+void Ext3IO::add_mapping(FileMap & fm, unsigned long lblk, 
+    unsigned long pblk, unsigned long len)
+{
+    Mapping & m = fm.extents[lblk];
+    m.lblk = lblk;
+    m.pblk = pblk;
+    m.len = len;
+}
+
+/* coalesces an array of block pointers into runs of contiguous blocks */
+void Ext3IO::add_runs(FileMap & fm, unsigned long start, 
+    const __le32 * ptrs, unsigned long n)
+{
+    unsigned long i, j;
+
+    for (i = 0; i < n; i = j) {
+        for (j = i + 1; j < n; j++) {
+            if (ptrs[i] == 0 ? ptrs[j] != 0 : ptrs[j] != ptrs[i] + (j - i))
+                break;
+        }
+        add_mapping(fm, start + i, ptrs[i], j - i);
+    }
+}
+
+int Ext3IO::map_indirect(FileMap & fm, unsigned long lblk)
+{
+    const unsigned long per = block_size / sizeof(__le32);
+    const __le32 * roots[] = { &fm.inode.i.block.ind, &fm.inode.i.block.dind,
+                               &fm.inode.i.block.tind };
+    std::vector<char> buf(block_size);
+    unsigned long start = EXT3_NDIR_BLOCKS, cover = per, off, blk;
+    int level, ret;
+
+    if (lblk < EXT3_NDIR_BLOCKS) {
+        add_runs(fm, 0, fm.inode.i.block.dir, EXT3_NDIR_BLOCKS);
+        return 0;
+    }
+
+    /* find the tree that covers the block */
+    for (level = 0; lblk - start >= cover; level++) {
+        if (level == 2)
+            return -EFBIG;
+        start += cover;
+        cover *= per;
+    }
+
+    off = lblk - start;
+    blk = *roots[level];
+
+    /* the leaf indirect block is memoized whole */
+    for (;;) {
+        const __le32 * ptrs = (const __le32 *)&buf[0];
+
+        if (blk == 0) {
+            add_mapping(fm, start, 0, cover);
+            return 0;
+        }
+
+        if ((ret = read_block(blk, &buf[0])) < 0)
+            return ret;
+
+        if (cover == per) {
+            add_runs(fm, start, ptrs, per);
+            return 0;
+        }
+
+        cover /= per;
+        start += (off / cover) * cover;
+        blk = ptrs[off / cover];
+        off %= cover;
+    }
+}
+
+int Ext3IO::map_extent(FileMap & fm, unsigned long lblk)
+{
+    std::vector<char> buf(block_size);
+    const char * node = (const char *)&fm.inode.i;
+    unsigned long node_size = sizeof(fm.inode.i);
+    unsigned long lo = 0, hi = ~0UL;
+    int ret;
+
+    for (;;) {
+        const struct ext4_extent_header * eh =
+            (const struct ext4_extent_header *)node;
+
+        if (eh->eh_magic != EXT4_EXT_MAGIC || sizeof(*eh) +
+            eh->eh_entries * sizeof(struct ext4_extent) > node_size)
+            return FS::ERR_CORRUPT;
+
+        if (eh->eh_depth == 0) {
+            const struct ext4_extent * ex = (const struct ext4_extent *)(eh + 1);
+            unsigned long prev_end = lo, next = hi;
+            bool covered = false;
+
+            for (unsigned i = 0; i < eh->eh_entries; i++) {
+                unsigned long start = ex[i].ee_block;
+                unsigned long len = ex[i].ee_len;
+                unsigned long pblk = ((unsigned long)ex[i].ee_start_hi << 32)
+                    | ex[i].ee_start;
+
+                /* uninitialized extents read back as zeros */
+                if (len > EXT_INIT_MAX_LEN) {
+                    len -= EXT_INIT_MAX_LEN;
+                    pblk = 0;
+                }
+
+                add_mapping(fm, start, pblk, len);
+
+                if (lblk - start < len)
+                    covered = true;
+                else if (start + len <= lblk && start + len > prev_end)
+                    prev_end = start + len;
+                else if (start > lblk && start < next)
+                    next = start;
+            }
+
+            if (!covered)
+                add_mapping(fm, prev_end, 0, next - prev_end);
+            return 0;
+        }
+        else {
+            const struct ext4_extent_idx * ix =
+                (const struct ext4_extent_idx *)(eh + 1);
+            unsigned long blk;
+            int i;
+
+            /* last index that starts at or before the block */
+            for (i = (int)eh->eh_entries - 1; i >= 0; i--) {
+                if (ix[i].ei_block <= lblk)
+                    break;
+            }
+
+            if (i < 0) {
+                hi = (eh->eh_entries > 0) ? ix[0].ei_block : hi;
+                add_mapping(fm, lo, 0, hi - lo);
+                return 0;
+            }
+
+            lo = ix[i].ei_block;
+            if (i + 1 < (int)eh->eh_entries)
+                hi = ix[i + 1].ei_block;
+
+            blk = ((unsigned long)ix[i].ei_leaf_hi << 32) | ix[i].ei_leaf;
+            if ((ret = read_block(blk, &buf[0])) < 0)
+                return ret;
+
+            node = &buf[0];
+            node_size = block_size;
+        }
+    }
+}
+
+int Ext3IO::map_block(FileMap & fm, unsigned long lblk, Mapping & m)
+{
+    int ret;
+
+    for (int tries = 0; tries < 2; tries++) {
+        auto it = fm.extents.upper_bound(lblk);
+
+        if (it != fm.extents.begin()) {
+            --it;
+            if (lblk - it->first < it->second.len) {
+                m = it->second;
+                return 0;
+            }
+        }
+
+        if (tries > 0)
+            break;
+
+        if (fm.inode.i_flags & EXT4_EXTENTS_FL)
+            ret = map_extent(fm, lblk);
+        else
+            ret = map_indirect(fm, lblk);
+
+        if (ret < 0)
+            return ret;
+    }
+
+    return FS::ERR_CORRUPT;
+}
+
+int Ext3IO::file_read(const FS::Location & loc, char * & buf)
+{
+    FileMap * fm;
+    unsigned long pos = 0;
+    int ret;
+
+    buf = nullptr;
+    if ((ret = get_inode(loc.addr, fm)) < 0)
+        return ret;
+
+    if (loc.offset + loc.size > fm->inode.i_size)
+        return -EINVAL;
+
+    if ((buf = new char[loc.size]) == nullptr)
+        return -ENOMEM;
+
+    /* each contiguous run of physical blocks is read at once */
+    while (pos < loc.size) {
+        unsigned long fpos = loc.offset + pos;
+        unsigned long lblk = fpos / block_size;
+        unsigned long avail, len;
+        Mapping m;
+
+        if ((ret = map_block(*fm, lblk, m)) < 0) {
+            delete [] buf;
+            buf = nullptr;
+            return ret;
+        }
+
+        avail = (m.lblk + m.len - lblk) * block_size - fpos % block_size;
+        len = (loc.size - pos < avail) ? loc.size - pos : avail;
+
+        if (m.pblk == 0) {
+            memset(buf + pos, 0, len);
+        }
+        else if ((ret = read_at((off_t)(m.pblk + lblk - m.lblk) * block_size
+                 + fpos % block_size, len, buf + pos)) < 0) {
+            delete [] buf;
+            buf = nullptr;
+            return ret;
+        }
+
+        pos += len;
+    }
+
+    return loc.size;
+}
+
+int Ext3IO::file_write(const FS::Location & loc, const char * buf)
+{
+    FileMap * fm;
+    unsigned long pos = 0;
+    int ret;
+
+    if ((ret = get_inode(loc.addr, fm)) < 0)
+        return ret;
+
+    if (loc.offset + loc.size > fm->inode.i_size)
+        return -EINVAL;
+
+    while (pos < loc.size) {
+        unsigned long fpos = loc.offset + pos;
+        unsigned long lblk = fpos / block_size;
+        unsigned long avail, len;
+        Mapping m;
+
+        if ((ret = map_block(*fm, lblk, m)) < 0)
+            return ret;
+
+        /* cannot allocate blocks for holes */
+        if (m.pblk == 0)
+            return FS::ERR_UNIMP;
+
+        avail = (m.lblk + m.len - lblk) * block_size - fpos % block_size;
+        len = (loc.size - pos < avail) ? loc.size - pos : avail;
+
+        if ((ret = write_at((off_t)(m.pblk + lblk - m.lblk) * block_size
+                 + fpos % block_size, len, buf + pos)) < 0)
+            return ret;
+
+        pos += len;
+    }
+
+    return loc.size;
+}
+
+/* journals and directories never have holes */
+int Ext3IO::file_block(FileMap & fm, unsigned long lblk, char * buf)
+{
+    Mapping m;
+    int ret;
+
+    if ((ret = map_block(fm, lblk, m)) < 0)
+        return ret;
+
+    if (m.pblk == 0)
+        return FS::ERR_CORRUPT;
+
+    return read_block(m.pblk + lblk - m.lblk, buf);
+}
+
+/*
+ * same as jbd recovery, except that blocks are not written back. a copy is
+ * only used if its transaction has a commit block, and is not revoked by the
+ * same or a later transaction
+ */
+int Ext3IO::replay_journal()
+{
+    struct Tag
+    {
+        unsigned long blocknr;
+        JournalCopy copy;
+        u32 sequence;
+    };
+
+    const struct journal_block * blk;
+    const struct journal_header * hdr;
+    const journal_superblock_t * jsb;
+    std::vector<char> buf;
+    std::vector<Tag> tags;
+    std::unordered_map<unsigned long, u32> revoked;
+    size_t committed_tags = 0;
+    std::vector<std::pair<unsigned long, u32>> revokes;
+    size_t committed_revokes = 0;
+    unsigned long first, maxlen, lblk, tag_bytes, tail = 0, rec_bytes = 4;
+    u32 sequence, incompat = 0;
+    FileMap * jfm;
+    int ret;
+
+    overlay.clear();
+    invalidate_all();
+
+    if ((ret = mount()) < 0)
+        return ret;
+
+    if (!(sb.s_feature_compat & EXT3_FEATURE_COMPAT_HAS_JOURNAL))
+        return 0;
+
+    /* external journals are not supported */
+    if (sb.s_journal_inum == 0)
+        return FS::ERR_UNIMP;
+
+    if ((ret = get_inode(sb.s_journal_inum, jfm)) < 0)
+        return ret;
+
+    buf.resize(block_size);
+    if ((ret = file_block(*jfm, 0, &buf[0])) < 0)
+        return ret;
+
+    blk = (const struct journal_block *)&buf[0];
+    hdr = (const struct journal_header *)(blk + 1);
+    jsb = (const journal_superblock_t *)(hdr + 1);
+
+    if (be32toh(blk->h_magic) != JFS_MAGIC_NUMBER ||
+        be32toh(jsb->s_blocksize) != block_size)
+        return FS::ERR_CORRUPT;
+
+    if (be32toh(hdr->h_blocktype) == JFS_SUPERBLOCK_V2)
+        incompat = be32toh(jsb->s_feature_incompat);
+    else if (be32toh(hdr->h_blocktype) != JFS_SUPERBLOCK_V1)
+        return FS::ERR_CORRUPT;
+
+    first = be32toh(jsb->s_first);
+    maxlen = be32toh(jsb->s_maxlen);
+    lblk = be32toh(jsb->s_start);
+    sequence = be32toh(jsb->s_sequence);
+
+    /* the journal is clean */
+    if (lblk == 0)
+        return 0;
+
+    if (first == 0 || first >= maxlen || lblk < first || lblk >= maxlen)
+        return FS::ERR_CORRUPT;
+
+    if (incompat & JBD2_FEATURE_INCOMPAT_CSUM_V3)
+        tag_bytes = 16;
+    else {
+        tag_bytes = 12;
+        if (incompat & JBD2_FEATURE_INCOMPAT_CSUM_V2)
+            tag_bytes += 2;
+        if (!(incompat & JBD2_FEATURE_INCOMPAT_64BIT))
+            tag_bytes -= 4;
+    }
+
+    if (incompat & (JBD2_FEATURE_INCOMPAT_CSUM_V2 |
+                    JBD2_FEATURE_INCOMPAT_CSUM_V3))
+        tail = 4;
+
+    if (incompat & JBD2_FEATURE_INCOMPAT_64BIT)
+        rec_bytes = 8;
+
+    /* every log block is visited at most once */
+    for (unsigned long steps = 0; steps < maxlen; steps++) {
+        unsigned long off;
+
+        if ((ret = file_block(*jfm, lblk, &buf[0])) < 0)
+            return ret;
+
+        /* end of log */
+        if (be32toh(blk->h_magic) != JFS_MAGIC_NUMBER ||
+            be32toh(hdr->h_sequence) != sequence)
+            break;
+
+        if (++lblk >= maxlen)
+            lblk = first;
+
+        switch (be32toh(hdr->h_blocktype))
+        {
+        case JFS_DESCRIPTOR_BLOCK:
+            for (off = JOURNAL_HEADER_SIZE;
+                 off + tag_bytes <= block_size - tail; steps++) {
+                const char * tag = &buf[off];
+                unsigned long blocknr;
+                u32 flags;
+                Mapping m;
+                Tag t;
+
+                blocknr = be32toh(*(const __be32 *)tag);
+                if (incompat & JBD2_FEATURE_INCOMPAT_CSUM_V3)
+                    flags = be32toh(*(const __be32 *)(tag + 4));
+                else
+                    flags = be16toh(*(const __be16 *)(tag + 6));
+
+                if (incompat & JBD2_FEATURE_INCOMPAT_64BIT)
+                    blocknr |= (unsigned long)
+                        be32toh(*(const __be32 *)(tag + 8)) << 32;
+
+                /* the copy is in the log block after the previous one */
+                if ((ret = map_block(*jfm, lblk, m)) < 0)
+                    return ret;
+
+                if (m.pblk == 0)
+                    return FS::ERR_CORRUPT;
+
+                t.blocknr = blocknr;
+                t.copy.pblk = m.pblk + lblk - m.lblk;
+                t.copy.escaped = (flags & JFS_FLAG_ESCAPE) != 0;
+                t.sequence = sequence;
+                tags.push_back(t);
+
+                if (++lblk >= maxlen)
+                    lblk = first;
+
+                off += tag_bytes;
+                if (!(flags & JFS_FLAG_SAME_UUID))
+                    off += 16;
+
+                if (flags & JFS_FLAG_LAST_TAG)
+                    break;
+            }
+            break;
+        case JFS_REVOKE_BLOCK:
+            off = be32toh(((const struct journal_revoke_block *)(hdr + 1))
+                ->r_count);
+            if (off > block_size)
+                return FS::ERR_CORRUPT;
+
+            for (unsigned long i = JOURNAL_HEADER_SIZE + sizeof(__be32);
+                 i + rec_bytes <= off; i += rec_bytes) {
+                unsigned long blocknr;
+
+                if (rec_bytes == 8)
+                    blocknr = be64toh(*(const __be64 *)&buf[i]);
+                else
+                    blocknr = be32toh(*(const __be32 *)&buf[i]);
+
+                revokes.push_back(std::make_pair(blocknr, sequence));
+            }
+            break;
+        case JFS_COMMIT_BLOCK:
+            committed_tags = tags.size();
+            committed_revokes = revokes.size();
+            sequence++;
+            break;
+        default:
+            steps = maxlen;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < committed_revokes; i++) {
+        auto it = revoked.find(revokes[i].first);
+        if (it == revoked.end() || it->second < revokes[i].second)
+            revoked[revokes[i].first] = revokes[i].second;
+    }
+
+    /* later transactions overwrite the copies of earlier ones */
+    for (size_t i = 0; i < committed_tags; i++) {
+        auto it = revoked.find(tags[i].blocknr);
+        if (it != revoked.end() && it->second >= tags[i].sequence)
+            continue;
+        if (tags[i].blocknr >= sb.s_blocks_count)
+            return FS::ERR_CORRUPT;
+        overlay[tags[i].blocknr] = tags[i].copy;
+    }
+
+    /* cached metadata was read without the overlay */
+    invalidate_all();
+    return overlay.size();
+}
+
+/*
+ * htree name hashes, these must match e2fsprogs and the kernel bit for bit
+ */
+
+#define DX_TEA_DELTA 0x9E3779B9U
+
+static void dx_tea_transform(u32 buf[4], const u32 in[4])
+{
+    u32 sum = 0, b0 = buf[0], b1 = buf[1];
+    u32 a = in[0], b = in[1], c = in[2], d = in[3];
+
+    for (int n = 0; n < 16; n++) {
+        sum += DX_TEA_DELTA;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    }
+
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+#define DX_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define DX_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define DX_H(x, y, z) ((x) ^ (y) ^ (z))
+#define DX_ROUND(f, a, b, c, d, x, s) \
+    (a += f(b, c, d) + (x), a = (a << (s)) | (a >> (32 - (s))))
+#define DX_K2 013240474631U
+#define DX_K3 015666365641U
+
+static void dx_half_md4_transform(u32 buf[4], const u32 in[8])
+{
+    u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+    DX_ROUND(DX_F, a, b, c, d, in[0],  3);
+    DX_ROUND(DX_F, d, a, b, c, in[1],  7);
+    DX_ROUND(DX_F, c, d, a, b, in[2], 11);
+    DX_ROUND(DX_F, b, c, d, a, in[3], 19);
+    DX_ROUND(DX_F, a, b, c, d, in[4],  3);
+    DX_ROUND(DX_F, d, a, b, c, in[5],  7);
+    DX_ROUND(DX_F, c, d, a, b, in[6], 11);
+    DX_ROUND(DX_F, b, c, d, a, in[7], 19);
+
+    DX_ROUND(DX_G, a, b, c, d, in[1] + DX_K2,  3);
+    DX_ROUND(DX_G, d, a, b, c, in[3] + DX_K2,  5);
+    DX_ROUND(DX_G, c, d, a, b, in[5] + DX_K2,  9);
+    DX_ROUND(DX_G, b, c, d, a, in[7] + DX_K2, 13);
+    DX_ROUND(DX_G, a, b, c, d, in[0] + DX_K2,  3);
+    DX_ROUND(DX_G, d, a, b, c, in[2] + DX_K2,  5);
+    DX_ROUND(DX_G, c, d, a, b, in[4] + DX_K2,  9);
+    DX_ROUND(DX_G, b, c, d, a, in[6] + DX_K2, 13);
+
+    DX_ROUND(DX_H, a, b, c, d, in[3] + DX_K3,  3);
+    DX_ROUND(DX_H, d, a, b, c, in[7] + DX_K3,  9);
+    DX_ROUND(DX_H, c, d, a, b, in[2] + DX_K3, 11);
+    DX_ROUND(DX_H, b, c, d, a, in[6] + DX_K3, 15);
+    DX_ROUND(DX_H, a, b, c, d, in[1] + DX_K3,  3);
+    DX_ROUND(DX_H, d, a, b, c, in[5] + DX_K3,  9);
+    DX_ROUND(DX_H, c, d, a, b, in[0] + DX_K3, 11);
+    DX_ROUND(DX_H, b, c, d, a, in[4] + DX_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+/* characters are sign extended unless the file system says otherwise */
+static inline int dx_char(const char * name, unsigned i, bool is_unsigned)
+{
+    return is_unsigned ? (int)(unsigned char)name[i] : (int)(signed char)name[i];
+}
+
+static u32 dx_legacy_hash(const char * name, unsigned len, bool is_unsigned)
+{
+    u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+
+    for (unsigned i = 0; i < len; i++) {
+        hash = hash1 + (hash0 ^ (u32)(dx_char(name, i, is_unsigned) * 7152373));
+        if (hash & 0x80000000)
+            hash -= 0x7fffffff;
+        hash1 = hash0;
+        hash0 = hash;
+    }
+
+    return hash0 << 1;
+}
+
+/* packs up to num words of the name, padded with its length */
+static void dx_str2hashbuf(const char * msg, int len, u32 * buf, int num,
+    bool is_unsigned)
+{
+    u32 pad, val;
+    int i;
+
+    pad = (u32)len | ((u32)len << 8);
+    pad |= pad << 16;
+    val = pad;
+
+    if (len > num * 4)
+        len = num * 4;
+
+    for (i = 0; i < len; i++) {
+        val = (u32)dx_char(msg, i, is_unsigned) + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
+        }
+    }
+
+    if (--num >= 0)
+        *buf++ = val;
+    while (--num >= 0)
+        *buf++ = pad;
+}
+
+static int dx_hash(unsigned version, const char * name, unsigned len,
+    const __le32 * seed, u32 & hash)
+{
+    bool is_unsigned = version >= DX_HASH_UNSIGNED_DELTA;
+    u32 buf[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    u32 in[8];
+    int left = len;
+
+    /* an all zero seed means the default one */
+    if (seed[0] || seed[1] || seed[2] || seed[3]) {
+        for (int i = 0; i < 4; i++)
+            buf[i] = seed[i];
+    }
+
+    if (is_unsigned)
+        version -= DX_HASH_UNSIGNED_DELTA;
+
+    switch (version) {
+    case DX_HASH_LEGACY:
+        hash = dx_legacy_hash(name, len, is_unsigned);
+        break;
+    case DX_HASH_HALF_MD4:
+        for (; left > 0; left -= 32, name += 32) {
+            dx_str2hashbuf(name, left, in, 8, is_unsigned);
+            dx_half_md4_transform(buf, in);
+        }
+        hash = buf[1];
+        break;
+    case DX_HASH_TEA:
+        for (; left > 0; left -= 16, name += 16) {
+            dx_str2hashbuf(name, left, in, 4, is_unsigned);
+            dx_tea_transform(buf, in);
+        }
+        hash = buf[0];
+        break;
+    default:
+        return FS::ERR_UNIMP;
+    }
+
+    /* the lowest bit marks collisions that continue into the next leaf */
+    hash &= ~1U;
+    return 0;
+}
+
+/* an index node is an array of dx_entry headed by its count and limit */
+static int dx_node(const char * blk, unsigned offset, unsigned block_size,
+    const struct dx_entry * & entries, unsigned & count)
+{
+    const struct dx_countlimit * cl;
+
+    if (offset + sizeof(struct dx_entry) > block_size)
+        return FS::ERR_CORRUPT;
+
+    cl = (const struct dx_countlimit *)(blk + offset);
+    count = cl->count;
+
+    if (count == 0 || count > cl->limit ||
+        offset + cl->limit * sizeof(struct dx_entry) > block_size)
+        return FS::ERR_CORRUPT;
+
+    entries = (const struct dx_entry *)cl;
+    return 0;
+}
+
+/* returns 1 and the entry at pos, moving pos past it, or 0 at the end */
+int Ext3IO::next_entry(const char * blk, unsigned long & pos,
+    const struct ext3_dir_entry * & de)
+{
+    unsigned long rec_len;
+
+    if (pos + sizeof(struct ext3_dir_entry) > block_size)
+        return 0;
+
+    de = (const struct ext3_dir_entry *)(blk + pos);
+    rec_len = de->rec_len;
+
+    /* 64K blocks cannot store their own size in rec_len */
+    if (block_size == 65536 && (rec_len == 0 || rec_len == 65535))
+        rec_len = 65536;
+
+    if (rec_len < sizeof(*de) || rec_len % 4 != 0 ||
+        pos + rec_len > block_size || sizeof(*de) + de->name_len > rec_len)
+        return FS::ERR_CORRUPT;
+
+    pos += rec_len;
+    return 1;
+}
+
+int Ext3IO::find_entry(const char * blk, const char * name, unsigned len,
+    unsigned long & ino)
+{
+    const struct ext3_dir_entry * de;
+    unsigned long pos = 0;
+    int ret;
+
+    while ((ret = next_entry(blk, pos, de)) > 0) {
+        if (de->inode != 0 && de->name_len == len &&
+            memcmp(de + 1, name, len) == 0) {
+            ino = de->inode;
+            return 0;
+        }
+    }
+
+    return (ret < 0) ? ret : -ENOENT;
+}
+
+int Ext3IO::linear_lookup(FileMap & dfm, const char * name, unsigned len,
+    unsigned long & ino)
+{
+    std::vector<char> buf(block_size);
+    unsigned long nblocks = (dfm.inode.i_size + block_size - 1) / block_size;
+    int ret;
+
+    for (unsigned long lblk = 0; lblk < nblocks; lblk++) {
+        if ((ret = file_block(dfm, lblk, &buf[0])) < 0 ||
+            (ret = find_entry(&buf[0], name, len, ino)) != -ENOENT)
+            return ret;
+    }
+
+    return -ENOENT;
+}
+
+/*
+ * walks down the htree like dx_probe in the kernel. each level is binary
+ * searched for the last entry whose hash is not greater than that of the
+ * name, so only one block per level and one leaf are read, unless the hash
+ * collides across leaves
+ */
+int Ext3IO::dx_lookup(FileMap & dfm, const char * name, unsigned len,
+    unsigned long & ino)
+{
+    struct Frame
+    {
+        std::vector<char> blk;
+        const struct dx_entry * entries;
+        unsigned count;
+        unsigned at;
+    };
+
+    const struct dx_root_info * info;
+    std::vector<char> leaf(block_size);
+    Frame frames[DX_MAX_LEVELS];
+    unsigned version, levels, offset, level, lo, hi;
+    u32 hash, next;
+    int ret;
+
+    frames[0].blk.resize(block_size);
+    if ((ret = file_block(dfm, 0, &frames[0].blk[0])) < 0)
+        return ret;
+
+    info = (const struct dx_root_info *)&frames[0].blk[DX_ROOT_INFO_OFFSET];
+    version = info->hash_version;
+    levels = info->indirect_levels;
+    offset = DX_ROOT_INFO_OFFSET + info->info_length;
+
+    if (info->reserved_zero != 0 || info->info_length < sizeof(*info) ||
+        levels >= DX_MAX_LEVELS)
+        return FS::ERR_CORRUPT;
+
+    if (version > DX_HASH_TEA)
+        return FS::ERR_UNIMP;
+
+    if (unsigned_hash)
+        version += DX_HASH_UNSIGNED_DELTA;
+
+    if ((ret = dx_hash(version, name, len, sb.s_hash_seed, hash)) < 0)
+        return ret;
+
+    for (level = 0; ; level++) {
+        Frame & f = frames[level];
+
+        if ((ret = dx_node(&f.blk[0], offset, block_size, f.entries,
+                f.count)) < 0)
+            return ret;
+
+        /* the first entry has no hash, it covers all names below the next */
+        for (lo = 1, hi = f.count; lo < hi; ) {
+            unsigned mid = (lo + hi) / 2;
+
+            if (f.entries[mid].hash > hash)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        f.at = lo - 1;
+
+        if (level == levels)
+            break;
+
+        /* index nodes start with an empty dirent spanning the block */
+        frames[level + 1].blk.resize(block_size);
+        if ((ret = file_block(dfm, f.entries[f.at].block & DX_BLOCK_MASK,
+                &frames[level + 1].blk[0])) < 0)
+            return ret;
+
+        offset = sizeof(struct ext3_dir_entry);
+    }
+
+    for (;;) {
+        Frame & f = frames[levels];
+
+        if ((ret = file_block(dfm, f.entries[f.at].block & DX_BLOCK_MASK,
+                &leaf[0])) < 0 ||
+            (ret = find_entry(&leaf[0], name, len, ino)) != -ENOENT)
+            return ret;
+
+        /* find the closest level that has an entry after the current one */
+        for (level = levels; frames[level].at + 1 >= frames[level].count; ) {
+            if (level-- == 0)
+                return -ENOENT;
+        }
+
+        /* a collision continues only if the next hash has its low bit set */
+        next = frames[level].entries[++frames[level].at].hash;
+        if ((next & 1) == 0 || (next & ~1U) != hash)
+            return -ENOENT;
+
+        for (; level < levels; level++) {
+            Frame & p = frames[level];
+            Frame & c = frames[level + 1];
+
+            if ((ret = file_block(dfm, p.entries[p.at].block & DX_BLOCK_MASK,
+                    &c.blk[0])) < 0 ||
+                (ret = dx_node(&c.blk[0], sizeof(struct ext3_dir_entry),
+                    block_size, c.entries, c.count)) < 0)
+                return ret;
+
+            c.at = 0;
+        }
+    }
+}
+
+int Ext3IO::get_dir(unsigned long dir, FileMap * & dfm)
+{
+    int ret;
+
+    if ((ret = get_inode(dir, dfm)) < 0)
+        return ret;
+
+    if ((dfm->inode.i_mode & EXT3_S_IFMT) != EXT3_S_IFDIR)
+        return -ENOTDIR;
+
+    if (dfm->inode.i_flags & EXT4_INLINE_DATA_FL)
+        return FS::ERR_UNIMP;
+
+    return 0;
+}
+
+int Ext3IO::lookup(unsigned long dir, const char * name, unsigned len,
+    unsigned long & ino)
+{
+    FileMap * dfm;
+    bool dot;
+    int ret;
+
+    if (len == 0)
+        return -ENOENT;
+
+    if (len > EXT3_NAME_LEN)
+        return -ENAMETOOLONG;
+
+    if ((ret = get_dir(dir, dfm)) < 0)
+        return ret;
+
+    /* "." and ".." are in the root block, but they are not indexed */
+    dot = name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.'));
+
+    if (!dot && (sb.s_feature_compat & EXT3_FEATURE_COMPAT_DIR_INDEX) &&
+        (dfm->inode.i_flags & EXT3_INDEX_FL)) {
+        ret = dx_lookup(*dfm, name, len, ino);
+
+        /* like the kernel, fall back on a linear scan if the index is bad */
+        if (ret != FS::ERR_CORRUPT && ret != FS::ERR_UNIMP)
+            return ret;
+    }
+
+    return linear_lookup(*dfm, name, len, ino);
+}
+
+int Ext3IO::namei(const char * path, unsigned long & ino)
+{
+    unsigned long cur = EXT3_ROOT_INO;
+    const char * end;
+    int ret;
+
+    if (path[0] != '/')
+        return -EINVAL;
+
+    for (;;) {
+        while (*path == '/')
+            path++;
+
+        if (*path == '\0')
+            break;
+
+        if ((end = strchr(path, '/')) == nullptr)
+            end = path + strlen(path);
+
+        if ((ret = lookup(cur, path, end - path, cur)) < 0)
+            return ret;
+
+        path = end;
+    }
+
+    ino = cur;
+    return 0;
+}
+
+int Ext3IO::get_root(unsigned long & ino)
+{
+    ino = EXT3_ROOT_INO;
+    return 0;
+}
+
+int Ext3IO::read_dir(unsigned long dir, std::vector<FS::Dirent> & ents)
+{
+    const struct ext3_dir_entry * de;
+    std::vector<char> buf;
+    unsigned long nblocks, pos;
+    FileMap * dfm;
+    bool typed;
+    int ret;
+
+    if ((ret = get_dir(dir, dfm)) < 0)
+        return ret;
+
+    typed = sb.s_feature_incompat & EXT3_FEATURE_INCOMPAT_FILETYPE;
+    nblocks = (dfm->inode.i_size + block_size - 1) / block_size;
+    buf.resize(block_size);
+
+    /* index blocks look like a block with one empty entry */
+    for (unsigned long lblk = 0; lblk < nblocks; lblk++) {
+        if ((ret = file_block(*dfm, lblk, &buf[0])) < 0)
+            return ret;
+
+        for (pos = 0; (ret = next_entry(&buf[0], pos, de)) > 0; ) {
+            if (de->inode == 0)
+                continue;
+
+            ents.emplace_back(de->inode, typed ? (int)de->file_type :
+                (int)FS::FT_UNKNOWN, (const char *)(de + 1), de->name_len);
+        }
+
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int Ext3IO::read_inode(unsigned long ino, FS::Stat & st)
+{
+    FileMap * fm;
+    int ret;
+
+    if ((ret = get_inode(ino, fm)) < 0)
+        return ret;
+
+    const struct ext3_inode & inode = fm->inode;
+
+    st.ino = ino;
+    st.mode = inode.i_mode;
+    st.nlink = inode.i_links_count;
+    st.uid = inode.i_uid | (inode.osd2.linux2.l_i_uid_high << 16);
+    st.gid = inode.i_gid | (inode.osd2.linux2.l_i_gid_high << 16);
+    st.size = inode.i_size;
+    st.mtime = inode.i_mtime;
+
+    /* i_dir_acl holds the high bits of the size of a regular file */
+    if ((inode.i_mode & EXT3_S_IFMT) == EXT3_S_IFREG)
+        st.size |= (unsigned long long)inode.i_dir_acl << 32;
+
+    return 0;
+}
+
+int Ext3IO::read(const FS::Location & loc, char * & buf)
+{
+    off_t pos;
+    int ret, err;
+
+    if (loc.aspc == Ext3::AS_FILE)
+        return file_read(loc, buf);
+
+    if ((ret = BlockIO::read(loc, buf)) < 0 || overlay.empty())
+        return ret;
+
+    if (loc.aspc == FS::AS_BYTE)
+        pos = loc.addr + loc.offset;
+    else
+        pos = (off_t)loc.addr * block_size + loc.offset;
+
+    if ((err = patch(pos, loc.size, buf)) < 0) {
+        delete [] buf;
+        buf = nullptr;
+        return err;
+    }
+
+    return ret;
+}
+
+int Ext3IO::write(const FS::Location & loc, const char * buf)
+{
+    off_t pos;
+    int ret;
+
+    if (loc.aspc == Ext3::AS_FILE)
+        return file_write(loc, buf);
+
+    if (loc.aspc == FS::AS_BYTE)
+        pos = loc.addr + loc.offset;
+    else
+        pos = (off_t)loc.addr * block_size + loc.offset;
+
+    if ((ret = settle(pos, loc.size)) < 0 ||
+        (ret = BlockIO::write(loc, buf)) < 0)
+        return ret;
+
+    /* the write may have changed an inode or index block */
+    invalidate(pos, loc.size);
+    return ret;
+}
+
@@ -0,0 +1,132 @@
+/*
+ * ext3io.h
+ *
+ * adds the ext3 file address space on top of BlockIO. a location in the file
+ * address space has the inode number as its address and the byte offset
+ * within the file as its offset. it is also the name adapter of ext3.
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#ifndef EXT3IO_H
+#define EXT3IO_H
+
+#include <libext3.h>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "blockio.h"
+
+class Ext3IO : public BlockIO, public FS::NameAdapter
+{
+    // logical blocks [lblk, lblk + len) are at physical blocks starting
+    // from pblk, or are a hole if pblk is 0
+    struct Mapping
+    {
+        unsigned long lblk;
+        unsigned long pblk;
+        unsigned long len;
+    };
+
+    // mappings are memoized per inode, keyed by first logical block
+    struct FileMap
+    {
+        struct ext3_inode inode;
+        std::map<unsigned long, Mapping> extents;
+    };
+
+    // bound on number of cached inodes, cache is dropped once exceeded
+    static const unsigned max_files = 4096;
+
+    struct ext3_super_block sb;
+    bool mounted;
+    bool unsigned_hash;         // htree names hash as unsigned chars
+    std::vector<struct ext3_group_desc> groups;
+    std::unordered_map<unsigned long, FileMap> files;
+
+    // blocks that the cached mappings were read from (group descriptors,
+    // inode tables and index blocks). writing any of them drops the cache
+    std::unordered_set<unsigned long> depends;
+
+    // where the latest committed copy of a block is in the journal
+    struct JournalCopy
+    {
+        unsigned long pblk;
+        bool escaped;           // first word was the journal magic
+    };
+
+    // overlays reads once the journal is replayed
+    std::unordered_map<unsigned long, JournalCopy> overlay;
+
+    int raw_read(off_t pos, size_t size, char * buf);
+    int raw_write(off_t pos, size_t size, const char * buf);
+    int read_copy(const JournalCopy & copy, char * buf);
+    int patch(off_t pos, size_t size, char * buf);
+    int settle(off_t pos, size_t size);
+
+    int read_at(off_t pos, size_t size, char * buf);
+    int write_at(off_t pos, size_t size, const char * buf);
+    
+    static void add_mapping(FileMap & fm, unsigned long lblk,
+        unsigned long pblk, unsigned long len);
+    static void add_runs(FileMap & fm, unsigned long start,
+        const __le32 * ptrs, unsigned long n);
+
+    int mount();
+    void invalidate(off_t pos, size_t size);
+    int read_block(unsigned long blknr, char * buf);
+    int get_inode(unsigned long ino, FileMap * & fm);
+    int map_indirect(FileMap & fm, unsigned long lblk);
+    int map_extent(FileMap & fm, unsigned long lblk);
+    int map_block(FileMap & fm, unsigned long lblk, Mapping & m);
+
+    int file_read(const FS::Location & loc, char * & buf);
+    int file_write(const FS::Location & loc, const char * buf);
+
+    int file_block(FileMap & fm, unsigned long lblk, char * buf);
+
+    int get_dir(unsigned long dir, FileMap * & dfm);
+    int next_entry(const char * blk, unsigned long & pos,
+        const struct ext3_dir_entry * & de);
+    int find_entry(const char * blk, const char * name, unsigned len,
+        unsigned long & ino);
+    int linear_lookup(FileMap & dfm, const char * name, unsigned len,
+        unsigned long & ino);
+    int dx_lookup(FileMap & dfm, const char * name, unsigned len,
+        unsigned long & ino);
+
+public:
+    Ext3IO();
+    virtual ~Ext3IO() override {}
+
+    // drops all cached inodes and mappings
+    void invalidate_all();
+
+    // scans the journal for committed transactions and overlays their
+    // blocks on all later reads. returns the number of blocks overlaid
+    int replay_journal();
+
+    // finds the inode of a name in a directory. indexed directories only
+    // read the index blocks on the way to the one leaf the name hashes to
+    virtual int lookup(unsigned long dir, const char * name, unsigned len,
+        unsigned long & ino) override;
+
+    // resolves an absolute path, one lookup per component, symbolic links
+    // are not followed
+    int namei(const char * path, unsigned long & ino);
+
+    virtual int get_root(unsigned long & ino) override;
+    virtual int read_dir(unsigned long dir,
+        std::vector<FS::Dirent> & ents) override;
+    virtual int read_inode(unsigned long ino, FS::Stat & st) override;
+
+    virtual int read(const FS::Location & loc, char * & buf) override;
+    virtual int write(const FS::Location & loc, const char * buf) override;
+};
+
+#endif /* EXT3IO_H */
+
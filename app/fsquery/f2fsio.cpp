@@ -0,0 +1,493 @@
+/*
+ * f2fsio.cpp
+ *
+ * implementation of the f2fs node address space. node ids are resolved
+ * through the nat blocks selected by the nat bitmap of the current
+ * checkpoint, overlaid with the nat journal in its hot data summary
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include "f2fsio.h"
+#include <cerrno>
+#include <cstring>
+
+#define F2FS_SUPER_MAGIC 0xF2F52010U
+
+/* block address of a node that was never written */
+#define NULL_ADDR 0x0U
+#define NEW_ADDR  0xFFFFFFFFU
+
+/* inodes with extra attributes shift their block addresses */
+#define F2FS_EXTRA_ATTR 0x20
+
+/* node blocks below an inode: two direct, two indirect, one double */
+#define F2FS_NODE_ROOTS 5
+
+F2FSIO::F2FSIO() : BlockIO(), mounted(false), blocks_per_seg(0)
+{
+    /* f2fs always uses this block size */
+    set_block_size(F2FS_BLKSIZE);
+}
+
+int F2FSIO::read_at(off_t pos, size_t size, char * buf)
+{
+    if (fsimg == nullptr)
+        return FS::ERR_UNINIT;
+
+    if (fseek(fsimg, pos, SEEK_SET) < 0)
+        return -errno;
+
+    if (fread(buf, size, 1, fsimg) != 1)
+        return -EIO;
+
+    return size;
+}
+
+int F2FSIO::read_block(unsigned long blkaddr, char * buf)
+{
+    if (blkaddr >= sb.block_count)
+        return FS::ERR_CORRUPT;
+
+    return read_at((off_t)blkaddr * F2FS_BLKSIZE, F2FS_BLKSIZE, buf);
+}
+
+/*
+ * a checkpoint pack is only valid if its first and last blocks carry the
+ * same version, i.e. the pack was completely written
+ */
+int F2FSIO::read_checkpoint(unsigned long blkaddr, std::vector<char> & cp,
+    u64 & version)
+{
+    const struct f2fs_checkpoint * ckpt;
+    std::vector<char> last(F2FS_BLKSIZE);
+    unsigned long total;
+    int ret;
+
+    cp.resize(F2FS_BLKSIZE);
+    if ((ret = read_block(blkaddr, cp.data())) < 0)
+        return ret;
+
+    ckpt = (const struct f2fs_checkpoint *)cp.data();
+    total = ckpt->cp_pack_total_block_count;
+
+    if (total < 2 || total > blocks_per_seg)
+        return FS::ERR_CORRUPT;
+
+    if ((ret = read_block(blkaddr + total - 1, last.data())) < 0)
+        return ret;
+
+    version = ckpt->checkpoint_ver;
+    if (((const struct f2fs_checkpoint *)last.data())->checkpoint_ver != version)
+        return FS::ERR_CORRUPT;
+
+    return 0;
+}
+
+int F2FSIO::load_nat_journal(unsigned long cp_addr,
+    const struct f2fs_checkpoint * cp)
+{
+    std::vector<char> buf(F2FS_BLKSIZE);
+    const struct f2fs_nat_journal * jrl;
+    unsigned n_nats;
+    int ret;
+
+    /* the hot data summary comes first, and it holds the nat journal */
+    if ((ret = read_block(cp_addr + cp->cp_pack_start_sum, buf.data())) < 0)
+        return ret;
+
+    /* compacted summaries put the journals at the front of the block */
+    if (cp->ckpt_flags & CP_COMPACT_SUM_FLAG)
+        jrl = (const struct f2fs_nat_journal *)buf.data();
+    else
+        jrl = (const struct f2fs_nat_journal *)(buf.data() + SUM_ENTRIES_SIZE);
+
+    n_nats = jrl->n_nats;
+    if (n_nats > NAT_JOURNAL_ENTRIES)
+        return FS::ERR_CORRUPT;
+
+    for (unsigned i = 0; i < n_nats; i++) {
+        const struct nat_journal_entry * e = &jrl->nat_j.entries[i];
+        journal[e->nid] = e->ne.block_addr;
+    }
+
+    return 0;
+}
+
+int F2FSIO::mount()
+{
+    const struct f2fs_checkpoint * ckpt;
+    std::vector<char> cp[2];
+    unsigned long cp_addr[2], bitmap_off, bitmap_size, nat_blocks;
+    u64 version[2];
+    int ret[2], cur;
+
+    if (mounted)
+        return 0;
+
+    if ((ret[0] = read_at(F2FS_SUPER_OFFSET, sizeof(sb), (char *)&sb)) < 0)
+        return ret[0];
+
+    if (sb.magic != F2FS_SUPER_MAGIC || sb.log_blocksize != 12 ||
+        sb.log_blocks_per_seg >= 32)
+        return FS::ERR_CORRUPT;
+
+    blocks_per_seg = 1UL << sb.log_blocks_per_seg;
+
+    /* the two checkpoint packs are a segment apart, use the newer one */
+    for (int i = 0; i < 2; i++) {
+        cp_addr[i] = sb.cp_blkaddr + i * blocks_per_seg;
+        ret[i] = read_checkpoint(cp_addr[i], cp[i], version[i]);
+    }
+
+    if (ret[0] < 0 && ret[1] < 0)
+        return ret[0];
+
+    if (ret[0] < 0)
+        cur = 1;
+    else if (ret[1] < 0)
+        cur = 0;
+    else
+        cur = (version[1] > version[0]) ? 1 : 0;
+
+    ckpt = (const struct f2fs_checkpoint *)cp[cur].data();
+
+    /* the sit bitmap moves out of the checkpoint block if cp_payload > 0 */
+    bitmap_off = sizeof(struct f2fs_checkpoint);
+    if (sb.cp_payload == 0)
+        bitmap_off += ckpt->sit_ver_bitmap_bytesize;
+
+    bitmap_size = ckpt->nat_ver_bitmap_bytesize;
+    nat_blocks = (sb.segment_count_nat / 2) << sb.log_blocks_per_seg;
+
+    if (bitmap_off + bitmap_size > F2FS_BLKSIZE || bitmap_size * 8 < nat_blocks)
+        return FS::ERR_CORRUPT;
+
+    nat_bitmap.assign(cp[cur].data() + bitmap_off,
+        cp[cur].data() + bitmap_off + bitmap_size);
+
+    nat.clear();
+    nat.resize(nat_blocks);
+    journal.clear();
+
+    if ((ret[0] = load_nat_journal(cp_addr[cur], ckpt)) < 0)
+        return ret[0];
+
+    mounted = true;
+    return 0;
+}
+
+int F2FSIO::load_nat_block(unsigned long block_off)
+{
+    const unsigned long seg_off = block_off >> sb.log_blocks_per_seg;
+    const unsigned long first = block_off * NAT_ENTRY_PER_BLOCK;
+    std::vector<char> buf(F2FS_BLKSIZE);
+    const struct f2fs_nat_block * blk;
+    std::vector<u32> & entries = nat[block_off];
+    unsigned long blkaddr;
+    int ret;
+
+    /* each nat block has two copies in alternating segments */
+    blkaddr = sb.nat_blkaddr + (seg_off << sb.log_blocks_per_seg << 1) +
+        (block_off & (blocks_per_seg - 1));
+
+    /* bits are numbered from the most significant bit of each byte */
+    if (nat_bitmap[block_off >> 3] & (0x80 >> (block_off & 7)))
+        blkaddr += blocks_per_seg;
+
+    if ((ret = read_block(blkaddr, buf.data())) < 0)
+        return ret;
+
+    blk = (const struct f2fs_nat_block *)buf.data();
+    entries.resize(NAT_ENTRY_PER_BLOCK);
+
+    for (unsigned i = 0; i < NAT_ENTRY_PER_BLOCK; i++)
+        entries[i] = blk->entries[i].block_addr;
+
+    /* the journal is small, so it is cheaper to walk it than to probe it
+     * for every entry of the block */
+    for (auto & it : journal) {
+        if (it.first >= first && it.first < first + NAT_ENTRY_PER_BLOCK)
+            entries[it.first - first] = it.second;
+    }
+
+    return 0;
+}
+
+int F2FSIO::lookup_nid(u32 nid, u32 & blkaddr)
+{
+    const unsigned long block_off = nid / NAT_ENTRY_PER_BLOCK;
+    int ret;
+
+    if ((ret = mount()) < 0)
+        return ret;
+
+    if (block_off >= nat.size())
+        return FS::ERR_CORRUPT;
+
+    if (nat[block_off].empty() && (ret = load_nat_block(block_off)) < 0)
+        return ret;
+
+    blkaddr = nat[block_off][nid % NAT_ENTRY_PER_BLOCK];
+
+    if (blkaddr == NULL_ADDR || blkaddr == NEW_ADDR ||
+        blkaddr >= sb.block_count)
+        return FS::ERR_CORRUPT;
+
+    return 0;
+}
+
+void F2FSIO::invalidate_all()
+{
+    nat.clear();
+    nat_bitmap.clear();
+    journal.clear();
+    mounted = false;
+}
+
+/* the nat cache depends on the super block, checkpoints and nat blocks */
+bool F2FSIO::is_nat_dependency(off_t pos, size_t size) const
+{
+    const off_t end = pos + size;
+    const off_t cp_start = (off_t)sb.cp_blkaddr * F2FS_BLKSIZE;
+    const off_t nat_start = (off_t)sb.nat_blkaddr * F2FS_BLKSIZE;
+
+    if (pos < F2FS_SUPER_OFFSET + (off_t)sizeof(sb))
+        return true;
+
+    /* the hot data summary lives in the checkpoint area */
+    if (end > cp_start && pos < cp_start +
+            (off_t)(2 * blocks_per_seg * F2FS_BLKSIZE))
+        return true;
+
+    return end > nat_start && pos < nat_start +
+        ((off_t)sb.segment_count_nat << sb.log_blocks_per_seg) * F2FS_BLKSIZE;
+}
+
+/* reads the node block of nid, making sure it belongs to that nid */
+int F2FSIO::read_node(u32 nid, char * buf)
+{
+    const struct node_footer * footer;
+    u32 blkaddr;
+    int ret;
+
+    if ((ret = lookup_nid(nid, blkaddr)) < 0 ||
+        (ret = read_block(blkaddr, buf)) < 0)
+        return ret;
+
+    footer = (const struct node_footer *)(buf + F2FS_NODE_NUM_BYTES);
+    if (footer->nid != nid)
+        return FS::ERR_CORRUPT;
+
+    return 0;
+}
+
+/*
+ * appends the data block addresses under a node, depth 0 being a direct
+ * node. left is the number of blocks still wanted, a missing node stands
+ * for as many holes as it would have addressed
+ */
+int F2FSIO::node_addrs(u32 nid, int depth, unsigned long & left,
+    std::vector<u32> & addrs)
+{
+    std::vector<char> buf;
+    const __le32 * ptrs;
+    int ret;
+
+    if (nid == 0) {
+        unsigned long span = ADDRS_PER_BLOCK;
+
+        for (int i = 0; i < depth; i++)
+            span *= NIDS_PER_BLOCK;
+
+        left -= (span < left) ? span : left;
+        return 0;
+    }
+
+    buf.resize(F2FS_BLKSIZE);
+    if ((ret = read_node(nid, &buf[0])) < 0)
+        return ret;
+
+    ptrs = (const __le32 *)&buf[0];
+
+    /* indirect nodes hold as many nids as direct nodes hold addresses */
+    for (unsigned i = 0; i < ADDRS_PER_BLOCK && left > 0; i++) {
+        if (depth == 0) {
+            addrs.push_back(ptrs[i]);
+            left--;
+        }
+        else if ((ret = node_addrs(ptrs[i], depth - 1, left, addrs)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int F2FSIO::read_dentries(const struct f2fs_dentry_block * blk,
+    std::vector<FS::Dirent> & ents)
+{
+    unsigned i = 0;
+
+    while (i < NR_DENTRY_IN_BLOCK) {
+        const struct f2fs_dir_entry * de = &blk->dentry[i];
+        unsigned len, slots;
+
+        /* the bitmap is little endian */
+        if (!(blk->dentry_bitmap[i / 8] & (1 << (i % 8)))) {
+            i++;
+            continue;
+        }
+
+        len = de->name_len;
+        slots = (len + F2FS_SLOT_LEN - 1) / F2FS_SLOT_LEN;
+
+        /* a long name spills into the slots that follow */
+        if (len == 0 || len > F2FS_NAME_LEN || i + slots > NR_DENTRY_IN_BLOCK)
+            return FS::ERR_CORRUPT;
+
+        ents.emplace_back(de->ino, de->file_type, blk->filename[i], len);
+        i += slots;
+    }
+
+    return 0;
+}
+
+int F2FSIO::get_root(unsigned long & ino)
+{
+    int ret;
+
+    if ((ret = mount()) < 0)
+        return ret;
+
+    ino = sb.root_ino;
+    return 0;
+}
+
+int F2FSIO::read_dir(unsigned long dir, std::vector<FS::Dirent> & ents)
+{
+    const struct f2fs_inode * inode;
+    std::vector<char> buf(F2FS_BLKSIZE);
+    std::vector<u32> addrs;
+    unsigned long left, naddrs;
+    u32 nids[F2FS_NODE_ROOTS];
+    int ret;
+
+    if ((ret = read_node(dir, &buf[0])) < 0)
+        return ret;
+
+    inode = (const struct f2fs_inode *)&buf[0];
+
+    if ((inode->i_mode & 0xF000) != F2FS_S_IFDIR)
+        return -ENOTDIR;
+
+    /* the annotations do not cover these layouts either */
+    if (inode->i_inline & (F2FS_INLINE_DENTRY | F2FS_EXTRA_ATTR))
+        return FS::ERR_UNIMP;
+
+    /* directories are always a whole number of dentry blocks */
+    left = inode->i_size / F2FS_BLKSIZE;
+
+    /* inline xattrs take the last addresses of the inode */
+    naddrs = DEF_ADDRS_PER_INODE;
+    if (inode->i_inline & F2FS_INLINE_XATTR)
+        naddrs -= F2FS_INLINE_XATTR_ADDRS;
+
+    for (unsigned long i = 0; i < naddrs && left > 0; i++, left--)
+        addrs.push_back(inode->i_addr[i]);
+
+    nids[0] = inode->nid_direct[0];
+    nids[1] = inode->nid_direct[1];
+    nids[2] = inode->nid_indirect[0];
+    nids[3] = inode->nid_indirect[1];
+    nids[4] = inode->nid_dindirect;
+
+    for (int i = 0; i < F2FS_NODE_ROOTS && left > 0; i++) {
+        if ((ret = node_addrs(nids[i], i / 2, left, addrs)) < 0)
+            return ret;
+    }
+
+    /* buckets that were never used have no block */
+    for (u32 blkaddr : addrs) {
+        if (blkaddr == NULL_ADDR || blkaddr == NEW_ADDR)
+            continue;
+
+        if ((ret = read_block(blkaddr, &buf[0])) < 0 ||
+            (ret = read_dentries((const struct f2fs_dentry_block *)&buf[0],
+                ents)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int F2FSIO::read_inode(unsigned long ino, FS::Stat & st)
+{
+    const struct f2fs_inode * inode;
+    std::vector<char> buf(F2FS_BLKSIZE);
+    int ret;
+
+    if ((ret = read_node(ino, &buf[0])) < 0)
+        return ret;
+
+    inode = (const struct f2fs_inode *)&buf[0];
+
+    st.ino = ino;
+    st.mode = inode->i_mode;
+    st.nlink = inode->i_links;
+    st.uid = inode->i_uid;
+    st.gid = inode->i_gid;
+    st.size = inode->i_size;
+    st.mtime = inode->i_mtime;
+    return 0;
+}
+
+int F2FSIO::read(const FS::Location & loc, char * & buf)
+{
+    u32 blkaddr;
+    int ret;
+
+    if (loc.aspc != F2FS::AS_NID)
+        return BlockIO::read(loc, buf);
+
+    if ((ret = lookup_nid(loc.addr, blkaddr)) < 0) {
+        buf = nullptr;
+        return ret;
+    }
+
+    FS::Location node(F2FS::AS_BLOCK, loc.size, loc.offset, blkaddr);
+    return BlockIO::read(node, buf);
+}
+
+int F2FSIO::write(const FS::Location & loc, const char * buf)
+{
+    off_t pos;
+    u32 blkaddr;
+    int ret;
+
+    if (loc.aspc == F2FS::AS_NID) {
+        if ((ret = lookup_nid(loc.addr, blkaddr)) < 0)
+            return ret;
+
+        FS::Location node(F2FS::AS_BLOCK, loc.size, loc.offset, blkaddr);
+
+        /* node blocks are never nat dependencies */
+        return BlockIO::write(node, buf);
+    }
+
+    if ((ret = BlockIO::write(loc, buf)) < 0 || !mounted)
+        return ret;
+
+    if (loc.aspc == FS::AS_BYTE)
+        pos = loc.addr + loc.offset;
+    else
+        pos = (off_t)loc.addr * F2FS_BLKSIZE + loc.offset;
+
+    if (is_nat_dependency(pos, loc.size))
+        invalidate_all();
+
+    return ret;
+}
+
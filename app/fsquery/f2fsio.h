@@ -0,0 +1,74 @@
+/*
+ * f2fsio.h
+ *
+ * adds the f2fs node address space on top of BlockIO. a location in the
+ * node address space has the node id as its address, which is translated to
+ * a block address through the node address table (NAT).
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#ifndef F2FSIO_H
+#define F2FSIO_H
+
+#include <libf2fs.h>
+#include <unordered_map>
+#include <vector>
+#include "blockio.h"
+
+class F2FSIO : public BlockIO, public FS::NameAdapter
+{
+    struct f2fs_super_block sb;
+    bool mounted;
+    unsigned long blocks_per_seg;
+
+    // nat bitmap of the current checkpoint, a set bit means the second
+    // copy of that nat block is the valid one
+    std::vector<unsigned char> nat_bitmap;
+
+    // block address of every node id, one vector per nat block. a nat
+    // block is only read the first time one of its node ids is looked up
+    std::vector<std::vector<u32>> nat;
+
+    // nat entries in the journal of the current checkpoint, these are newer
+    // than what is in the nat blocks
+    std::unordered_map<u32, u32> journal;
+
+    int read_at(off_t pos, size_t size, char * buf);
+    int read_block(unsigned long blkaddr, char * buf);
+
+    int read_checkpoint(unsigned long blkaddr, std::vector<char> & cp,
+        u64 & version);
+    int load_nat_journal(unsigned long cp_addr, const struct f2fs_checkpoint * cp);
+    int load_nat_block(unsigned long block_off);
+
+    int mount();
+    bool is_nat_dependency(off_t pos, size_t size) const;
+    int lookup_nid(u32 nid, u32 & blkaddr);
+    int read_node(u32 nid, char * buf);
+    int node_addrs(u32 nid, int depth, unsigned long & left,
+        std::vector<u32> & addrs);
+    int read_dentries(const struct f2fs_dentry_block * blk,
+        std::vector<FS::Dirent> & ents);
+
+public:
+    F2FSIO();
+    virtual ~F2FSIO() override {}
+
+    // drops the nat cache, it is rebuilt on the next lookup
+    void invalidate_all();
+
+    virtual int get_root(unsigned long & ino) override;
+    virtual int read_dir(unsigned long dir,
+        std::vector<FS::Dirent> & ents) override;
+    virtual int read_inode(unsigned long ino, FS::Stat & st) override;
+
+    virtual int read(const FS::Location & loc, char * & buf) override;
+    virtual int write(const FS::Location & loc, const char * buf) override;
+};
+
+#endif /* F2FSIO_H */
+
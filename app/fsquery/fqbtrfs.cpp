@@ -0,0 +1,73 @@
+/*
+ * fqbtrfs.cpp
+ *
+ * contains main() for bootstraping to libbtrfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libbtrfs.h>
+#include <iostream>
+#include "fsquery.h"
+#include "btrfsio.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    BtrfsIO io;
+    Btrfs btrfs(io);
+    const char * filename;
+    Btrfs::BtrfsSuperBlock * super;
+    int last = argc - 1, ret;
+
+    /* a name command takes the last two arguments */
+    if (argc >= 4 && fq_is_name_command(argv[argc - 2]))
+        last = argc - 2;
+
+    if (argc < 3) {
+        cout << "usage: " << argv[0] << " device [device...] 'expression'" 
+             << endl
+             << "       " << argv[0] << " device [device...] ls|lsr|stat path"
+             << endl;
+        return EXIT_FAILURE;
+    }
+    
+    filename = argv[1];
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    /* the other members of a multi-device file system */
+    for (int i = 2; i < last; i++) {
+        if ((ret = io.add_device(argv[i])) < 0) {
+            cout << argv[0] << ": could not open " << argv[i] << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    if ((super = (Btrfs::BtrfsSuperBlock *)btrfs.fetch_super())) {
+        io.set_block_size(super->sectorsize);
+        super->destroy();
+    }
+    else {
+        cout << filename << ": CORRUPT, io error or super block is corrupted" 
+             << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if (last == argc - 2) {
+        if (fq_query_names(io, argv[last], argv[last + 1]) < 0)
+            return EXIT_FAILURE;
+    }
+    else if (fq_query_filesystem(btrfs, argv[last]) <= 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
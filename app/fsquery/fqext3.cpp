@@ -0,0 +1,75 @@
+/*
+ * fqext3.cpp
+ *
+ * contains main() for bootstraping to libext3
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libext3.h>
+#include <iostream>
+#include <cstring>
+#include "fsquery.h"
+#include "ext3io.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    Ext3IO io;
+    Ext3 ext3(io);
+    const char * filename;
+    Ext3::Ext3SuperBlock * super;
+    bool replay = false;
+    int arg = 1, ret;
+
+    /* -j shows the file system as if the journal were replayed */
+    if (argc > 1 && strcmp(argv[1], "-j") == 0) {
+        replay = true;
+        arg++;
+    }
+
+    if (argc - arg != 2 && 
+        !(argc - arg == 3 && fq_is_name_command(argv[arg + 1]))) {
+        cout << "usage: " << argv[0] << " [-j] device 'expression'" << endl
+             << "       " << argv[0] << " [-j] device ls|lsr|stat path" 
+             << endl;
+        return EXIT_FAILURE;
+    }
+    
+    filename = argv[arg];
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if (replay && (ret = io.replay_journal()) < 0) {
+        cout << filename << ": could not replay journal (" << ret << ")" 
+             << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if ((super = (Ext3::Ext3SuperBlock *)ext3.fetch_super())) {
+        io.set_block_size(1024 << super->s_log_block_size);
+        super->destroy();
+    }
+    else {
+        cout << filename << ": CORRUPT, io error or super block is corrupted" 
+             << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if (argc - arg == 3) {
+        if (fq_query_names(io, argv[arg + 1], argv[arg + 2]) < 0)
+            return EXIT_FAILURE;
+    }
+    else if (fq_query_filesystem(ext3, argv[arg + 1]) <= 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,51 @@
+/*
+ * fqf2fs.cpp
+ *
+ * contains main() for bootstraping to libf2fs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libf2fs.h>
+#include <iostream>
+#include "fsquery.h"
+#include "f2fsio.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    F2FSIO io;
+    F2FS f2fs(io);
+    const char * filename;
+    int ret;
+
+    if (argc != 3 && !(argc == 4 && fq_is_name_command(argv[2]))) {
+        cout << "usage: " << argv[0] << " device 'expression'" << endl
+             << "       " << argv[0] << " device ls|lsr|stat path" << endl;
+        return EXIT_FAILURE;
+    }
+    
+    filename = argv[1];
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    /* f2fs always uses this block size */
+    io.set_block_size(F2FS_BLKSIZE);
+    
+    if (argc == 4) {
+        if (fq_query_names(io, argv[2], argv[3]) < 0)
+            return EXIT_FAILURE;
+    }
+    else if (fq_query_filesystem(f2fs, argv[2]) <= 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,45 @@
+/*
+ * fqtestfs.cpp
+ *
+ * contains main() for bootstraping to libtestfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libtestfs.h>
+#include <iostream>
+#include "fsquery.h"
+#include "blockio.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    BlockIO io;
+    TestFS testfs(io);
+    const char * filename;
+    int ret;
+
+    if (argc != 3) {
+        cout << "usage: " << argv[0] << " device 'expression'" << endl;
+        return EXIT_FAILURE;
+    }
+    
+    filename = argv[1];
+    
+    if ((ret = io.open(filename)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    io.set_block_size(BLOCK_SIZE);
+    
+    if (fq_query_filesystem(testfs, argv[2]) <= 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
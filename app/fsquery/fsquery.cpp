@@ -0,0 +1,648 @@
+/*
+ * fsquery.cpp
+ *
+ * Implements path-expression queries over the file system metadata graph,
+ * following only the pointers that are named by the path
+ *
+ * Kuei (Jack) Sun
+ * kuei.sun@mail.utoronto.ca
+ *
+ * University of Toronto
+ * 2018
+ */
+
+#include <libfs.h>
+#include <iostream>
+#include <iomanip>
+#include <cctype>
+#include <cstring>
+#include "fsquery.h"
+
+using namespace std;
+
+static string trim(const string & str)
+{
+    size_t first = str.find_first_not_of(" \t");
+    size_t last = str.find_last_not_of(" \t");
+
+    if (first == string::npos)
+        return "";
+
+    return str.substr(first, last - first + 1);
+}
+
+static bool is_identifier(const string & str)
+{
+    if (str.empty() || !(isalpha(str[0]) || str[0] == '_'))
+        return false;
+
+    for (size_t i = 1; i < str.size(); i++) {
+        if (!(isalnum(str[i]) || str[i] == '_'))
+            return false;
+    }
+
+    return true;
+}
+
+int FSQuery::set_error(const char * msg, const string & arg)
+{
+    error = msg;
+    error += " '" + arg + "'";
+    return -EINVAL;
+}
+
+int FSQuery::compile_operand(const string & str, FQOperand & opnd)
+{
+    char * end;
+
+    if (str.empty())
+        return set_error("missing operand in", str);
+
+    if (is_identifier(str)) {
+        /* annotated constants take precedence over field names */
+        if (fs.name_to_constant(str.c_str(), opnd.value) < 0)
+            opnd.field = str;
+        return 0;
+    }
+
+    opnd.value = strtol(str.c_str(), &end, 0);
+    if (*end != '\0')
+        return set_error("invalid operand", str);
+
+    return 0;
+}
+
+int FSQuery::compile_predicate(const string & str, FQPredicate & pred)
+{
+    /* two-character operators must be searched for first */
+    static const struct {
+        const char * token;
+        FQPredicate::Op op;
+    } ops[] = {
+        { "==", FQPredicate::OP_EQ }, { "!=", FQPredicate::OP_NE },
+        { "<=", FQPredicate::OP_LE }, { ">=", FQPredicate::OP_GE },
+        { "<",  FQPredicate::OP_LT }, { ">",  FQPredicate::OP_GT },
+        { "&",  FQPredicate::OP_AND }, { "|",  FQPredicate::OP_OR },
+    };
+    string expr = trim(str);
+    int ret;
+
+    for (unsigned i = 0; i < sizeof(ops)/sizeof(ops[0]); i++) {
+        size_t pos = expr.find(ops[i].token);
+
+        if (pos == string::npos)
+            continue;
+
+        pred.op = ops[i].op;
+        ret = compile_operand(trim(expr.substr(0, pos)), pred.lhs);
+        if (ret < 0) return ret;
+
+        pos += strlen(ops[i].token);
+        return compile_operand(trim(expr.substr(pos)), pred.rhs);
+    }
+
+    if (!expr.empty() && expr[0] == '!') {
+        pred.negate = true;
+        expr = trim(expr.substr(1));
+    }
+
+    return compile_operand(expr, pred.lhs);
+}
+
+int FSQuery::compile_step(const string & str)
+{
+    size_t pos = str.find('[');
+    FQStep step;
+    int ret;
+
+    step.name = trim(str.substr(0, pos));
+    /* the first step may also be a list of types, see compile_types */
+    if (!is_identifier(step.name) && (!plan.empty() || 
+            step.name.find('|') == string::npos))
+        return set_error("invalid field name", step.name);
+
+    while (pos != string::npos) {
+        size_t end = str.find(']', pos);
+        string sub;
+        char * last;
+
+        if (end == string::npos)
+            return set_error("missing ']' in", str);
+
+        sub = trim(str.substr(pos + 1, end - pos - 1));
+        if (sub == "*") {
+            step.subs.emplace_back(FQSubscript::SUB_ALL);
+        }
+        else if (!sub.empty() && isdigit(sub[0]) &&
+                 (strtol(sub.c_str(), &last, 0), *last == '\0')) {
+            step.subs.emplace_back(FQSubscript::SUB_INDEX);
+            step.subs.back().index = strtol(sub.c_str(), nullptr, 0);
+        }
+        else {
+            step.subs.emplace_back(FQSubscript::SUB_PRED);
+            ret = compile_predicate(sub, step.subs.back().pred);
+            if (ret < 0) return ret;
+        }
+
+        pos = str.find_first_not_of(" \t", end + 1);
+        if (pos != string::npos && str[pos] != '[')
+            return set_error("unexpected text after ']' in", str);
+    }
+
+    plan.push_back(step);
+    return 0;
+}
+
+int FSQuery::compile_types(const string & str)
+{
+    size_t start = 0, pos;
+
+    do {
+        string name;
+        int type;
+
+        pos = str.find('|', start);
+        name = trim(str.substr(start, pos - start));
+        if (!is_identifier(name))
+            return set_error("invalid type name", name);
+
+        if ((type = fs.name_to_type(name.c_str())) < 0)
+            return set_error("no such type", name);
+
+        types.push_back(type);
+        start = pos + 1;
+    } while (pos != string::npos);
+
+    return 0;
+}
+
+/* looks the field up in every scope, adding the scopes it leads to */
+int FSQuery::resolve(const vector<int> & scopes, const string & name,
+    vector<int> * next)
+{
+    vector<int> tmp;
+    int ret = -ENOENT;
+
+    for (unsigned i = 0; i < scopes.size(); i++) {
+        if (fs.lookup_field(scopes[i], name.c_str(), next ? *next : tmp) == 0)
+            ret = 0;
+    }
+
+    return (ret < 0) ? set_error("no such field", name) : 0;
+}
+
+/* checks each step, and the fields its predicates use, against the fields
+ * of the types that the step before it may lead to */
+int FSQuery::resolve(void)
+{
+    vector<int> scopes(types), next;
+    vector<int> probe;
+    int ret;
+
+    /* nothing to check against */
+    if (fs.lookup_field(fs.super_type_id(), "", probe) == FS::ERR_UNIMP)
+        return 0;
+
+    if (scopes.empty())
+        scopes.push_back(fs.super_type_id());
+
+    for (unsigned i = 0; i < plan.size(); i++) {
+        if (i > 0) {
+            next.clear();
+            if ((ret = resolve(scopes, plan[i].name, &next)) < 0)
+                return ret;
+            scopes.swap(next);
+        }
+
+        for (const FQSubscript & sub : plan[i].subs) {
+            if (sub.kind != FQSubscript::SUB_PRED)
+                continue;
+            if (!sub.pred.lhs.field.empty() &&
+                (ret = resolve(scopes, sub.pred.lhs.field)) < 0)
+                return ret;
+            if (!sub.pred.rhs.field.empty() &&
+                (ret = resolve(scopes, sub.pred.rhs.field)) < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+int FSQuery::compile(const char * expr)
+{
+    string str(expr);
+    size_t start = 0, pos;
+    int ret;
+
+    plan.clear();
+    types.clear();
+    error.clear();
+
+    do {
+        pos = str.find('/', start);
+        ret = compile_step(str.substr(start, pos - start));
+        if (ret < 0) return ret;
+        start = pos + 1;
+    } while (pos != string::npos);
+
+    if (plan[0].name != "super" && (ret = compile_types(plan[0].name)) < 0)
+        return ret;
+
+    return resolve();
+}
+
+bool FSQuery::evaluate(FS::Entity & ent, const FQOperand & opnd, long & value)
+{
+    FS::Entity * child;
+    FS::Field * field;
+
+    if (opnd.field.empty()) {
+        value = opnd.value;
+        return true;
+    }
+
+    child = ent.get_field_by_name(opnd.field.c_str());
+    if (child == nullptr || (field = child->to_field()) == nullptr)
+        return false;
+
+    value = (long)field->to_integer();
+    return true;
+}
+
+bool FSQuery::evaluate(FS::Entity & ent, const FQPredicate & pred)
+{
+    long lhs, rhs = 0;
+    bool ret;
+
+    if (!evaluate(ent, pred.lhs, lhs))
+        return false;
+    if (pred.op != FQPredicate::OP_NONE && !evaluate(ent, pred.rhs, rhs))
+        return false;
+
+    switch (pred.op) {
+    case FQPredicate::OP_AND: ret = (lhs & rhs) != 0; break;
+    case FQPredicate::OP_OR:  ret = (lhs | rhs) != 0; break;
+    case FQPredicate::OP_EQ:  ret = (lhs == rhs); break;
+    case FQPredicate::OP_NE:  ret = (lhs != rhs); break;
+    case FQPredicate::OP_LT:  ret = (lhs < rhs); break;
+    case FQPredicate::OP_GT:  ret = (lhs > rhs); break;
+    case FQPredicate::OP_LE:  ret = (lhs <= rhs); break;
+    case FQPredicate::OP_GE:  ret = (lhs >= rhs); break;
+    default:                  ret = (lhs != 0); break;
+    }
+
+    return pred.negate ? !ret : ret;
+}
+
+/* visits all elements of vectors, extents and arrays, flattening any nested
+ * ones, and applies the rest of the step to each (or to the selected one) */
+class FSQuery::ElemVisitor : public FS::Visitor
+{
+    FSQuery & query;
+    unsigned i, k;
+    long index;
+    long selected;
+
+public:
+    ElemVisitor(FSQuery & q, unsigned i, unsigned k, long sel=-1) :
+        query(q), i(i), k(k), index(0), selected(sel) {}
+
+    static bool is_vector(FS::Entity & ent) {
+        return (ent.is_array() || ent.is_extent()) && !ent.is_cstring();
+    }
+
+    virtual int visit(FS::Entity & ent) override {
+        size_t len = query.label.size();
+        int ret;
+
+        if (is_vector(ent))
+            return ent.accept_fields(*this);
+
+        if (selected >= 0 && index != selected) {
+            index++;
+            return 0;
+        }
+
+        query.label += "[" + to_string(index++) + "]";
+        ret = query.apply(ent, i, k);
+        query.label.resize(len);
+
+        /* stop visiting once the selected element is found */
+        return (ret == 0 && selected >= 0) ? 1 : ret;
+    }
+};
+
+int FSQuery::apply(FS::Entity & ent, unsigned i, unsigned k)
+{
+    const FQStep & st = plan[i];
+    FS::Pointer * ptr = ent.to_pointer();
+    int ret;
+
+    /* only follow the pointer if the path goes through it */
+    if (ptr != nullptr && (k < st.subs.size() || i + 1 < plan.size())) {
+        FS::Container * ctn;
+
+        if (ptr->pointer_type() == FS::INVALID_TYPE_ID)
+            return 0;
+        if ((ctn = ptr->fetch()) == nullptr) {
+            cerr << label << ": failed to fetch " << ent.get_type() << endl;
+            return 0;
+        }
+
+        ret = apply(*ctn, i, k);
+        ctn->destroy();
+        return ret;
+    }
+
+    if (k == st.subs.size())
+        return step(ent, i + 1);
+
+    const FQSubscript & sub = st.subs[k];
+    switch (sub.kind) {
+    case FQSubscript::SUB_PRED:
+        /* predicates are applied before descending any further */
+        return evaluate(ent, sub.pred) ? apply(ent, i, k + 1) : 0;
+    case FQSubscript::SUB_ALL:
+    case FQSubscript::SUB_INDEX:
+    default:
+        if (ElemVisitor::is_vector(ent)) {
+            ElemVisitor ev(*this, i, k + 1,
+                (sub.kind == FQSubscript::SUB_INDEX) ? sub.index : -1);
+            ret = ent.accept_fields(ev);
+            return (ret > 0) ? 0 : ret;
+        }
+        /* a single entity is treated as a vector of one */
+        else if (sub.kind == FQSubscript::SUB_ALL || sub.index == 0) {
+            size_t len = label.size();
+            label += "[0]";
+            ret = apply(ent, i, k + 1);
+            label.resize(len);
+            return ret;
+        }
+        break;
+    }
+
+    return 0;
+}
+
+int FSQuery::step(FS::Entity & ent, unsigned i)
+{
+    FS::Entity * child;
+    size_t len = label.size();
+    int ret;
+
+    if (i == plan.size()) {
+        num_matches++;
+        return output->visit(ent);
+    }
+
+    if ((child = ent.get_field_by_name(plan[i].name.c_str())) == nullptr)
+        return 0;
+
+    label += "/" + plan[i].name;
+    ret = apply(*child, i, 0);
+    label.resize(len);
+    return ret;
+}
+
+/* finds the containers of the types named by the first step, fetching only
+ * the ones that can lead to them, and applies the rest of the path to each */
+class FSQuery::TypeVisitor : public FS::Visitor
+{
+    FSQuery & query;
+    long index;
+
+    bool is_selected(int type) const {
+        for (unsigned i = 0; i < query.types.size(); i++) {
+            if (query.types[i] == type)
+                return true;
+        }
+        return false;
+    }
+
+public:
+    TypeVisitor(FSQuery & q) : query(q), index(0) {}
+
+    int select(FS::Entity & ent) {
+        /* the elements of an extent are visited as its fields */
+        if (ent.is_extent())
+            return ent.accept_fields(*this);
+
+        query.label = query.plan[0].name + "[" + to_string(index++) + "]";
+        return query.apply(ent, 0, 0);
+    }
+
+    virtual int visit(FS::Entity & ent) override {
+        FS::Pointer * ptr = ent.to_pointer();
+        FS::Container * ctn;
+        int ret = 0;
+
+        if (ptr == nullptr)
+            return select(ent);
+
+        if ((ctn = ptr->fetch()) == nullptr) {
+            cerr << query.plan[0].name << ": failed to fetch " 
+                 << ent.get_type() << endl;
+            return 0;
+        }
+
+        /* pointers to extents carry the type of their innermost container */
+        if (is_selected(ptr->pointer_type()))
+            ret = select(*ctn);
+        if (ret == 0)
+            ret = ctn->accept_by_type(query.types, *this);
+
+        ctn->destroy();
+        return ret;
+    }
+};
+
+int FSQuery::execute(FS::Visitor & visitor)
+{
+    FS::Container * super;
+    int ret;
+
+    if (plan.empty())
+        return FS::ERR_UNINIT;
+
+    if ((super = fs.fetch_super()) == nullptr)
+        return FS::ERR_CORRUPT;
+
+    output = &visitor;
+    num_matches = 0;
+    label = plan[0].name;
+
+    if (types.empty()) {
+        ret = apply(*super, 0, 0);
+    }
+    else {
+        TypeVisitor tv(*this);
+
+        ret = 0;
+        for (unsigned i = 0; i < types.size() && ret == 0; i++) {
+            if (types[i] == fs.super_type_id())
+                ret = tv.select(*super);
+        }
+        if (ret == 0)
+            ret = super->accept_by_type(types, tv);
+    }
+
+    super->destroy();
+
+    return (ret > 0) ? 0 : ret;
+}
+
+/* prints the value of every match */
+class PrintVisitor : public FS::Visitor
+{
+    FS::FileSystem & fs;
+    FSQuery & query;
+
+public:
+    PrintVisitor(FS::FileSystem & fs, FSQuery & q) : fs(fs), query(q) {}
+
+    virtual int visit(FS::Entity & ent) override
+    {
+        FS::Container * ctn = ent.to_container();
+        FS::Pointer * ptr = ent.to_pointer();
+        FS::Field * field = ent.to_field();
+
+        cout << query.get_label();
+        if (ctn != nullptr) {
+            const FS::Location & loc = ctn->get_location();
+            cout << ": " << ctn->get_type()
+                 << " aspc=" << fs.address_space_to_name(loc.aspc)
+                 << " addr=" << loc.addr;
+            if (loc.offset > 0)
+                cout << " offset=" << loc.offset;
+        }
+        else if (ptr != nullptr) {
+            cout << " = " << ptr->to_integer();
+            if (ptr->pointer_type() != FS::INVALID_TYPE_ID)
+                cout << " -> " << fs.type_to_name(ptr->pointer_type());
+        }
+        else if (field != nullptr && ent.is_enum()) {
+            const char * name = field->to_string();
+            cout << " = ";
+            if (name != nullptr)
+                cout << name << "(" << field->to_integer() << ")";
+            else
+                cout << field->to_integer();
+        }
+        else if (field != nullptr && !ent.is_aggregate()) {
+            cout << " = " << field->to_string();
+        }
+        else if (field != nullptr && ent.is_integral() && !ent.is_array() &&
+                 !ent.is_struct() && !ent.is_union()) {
+            /* bitfields (e.g. i_mode) and offsets still have a value */
+            if (ent.is_bitfield())
+                cout << " = 0x" << hex << field->to_integer() << dec;
+            else
+                cout << " = " << field->to_integer();
+        }
+        else {
+            cout << ": " << ent.get_type();
+        }
+
+        cout << endl;
+        return 0;
+    }
+};
+
+int fq_query_filesystem(FS::FileSystem & fs, const char * expr)
+{
+    FSQuery query(fs);
+    PrintVisitor printer(fs, query);
+    int ret;
+
+    if ((ret = query.compile(expr)) < 0) {
+        cerr << "syntax error: " << query.get_error() << endl;
+        return ret;
+    }
+
+    if ((ret = query.execute(printer)) < 0) {
+        cerr << "error while querying " << fs.io.get_name() << endl;
+        return ret;
+    }
+
+    return (int)query.get_num_matches();
+}
+
+
+bool fq_is_name_command(const char * cmd)
+{
+    return strcmp(cmd, "ls") == 0 || strcmp(cmd, "lsr") == 0 ||
+        strcmp(cmd, "stat") == 0;
+}
+
+static void print_dirent(const string & name, const FS::Dirent & ent)
+{
+    static const char * types[] = { "?", "file", "dir", "chr", "blk", "fifo",
+                                    "sock", "link" };
+    const char * type = (ent.type >= 0 && ent.type <= FS::FT_SYMLINK) ?
+        types[ent.type] : "?";
+
+    cout << setw(10) << ent.ino << " " << setw(4) << type << " " << name
+         << endl;
+}
+
+/* prints every entry under a directory */
+class NamePrinter : public FS::NameVisitor
+{
+public:
+    unsigned long count = 0;
+
+    virtual int visit(const string & path, const FS::Dirent & ent) override
+    {
+        print_dirent(path, ent);
+        count++;
+        return 0;
+    }
+};
+
+int fq_query_names(FS::NameAdapter & adapter, const char * cmd,
+    const char * path)
+{
+    FS::Namespace ns(adapter);
+    int ret;
+
+    if (strcmp(cmd, "stat") == 0) {
+        FS::Stat st;
+
+        if ((ret = ns.stat(path, st)) < 0) {
+            cerr << "cannot stat " << path << " (" << ret << ")" << endl;
+            return ret;
+        }
+
+        cout << path << ": ino=" << st.ino << " mode=0" << oct << st.mode
+             << dec << " nlink=" << st.nlink << " uid=" << st.uid
+             << " gid=" << st.gid << " size=" << st.size
+             << " mtime=" << st.mtime << endl;
+        return 1;
+    }
+
+    if (strcmp(cmd, "lsr") == 0) {
+        NamePrinter printer;
+
+        if ((ret = ns.walk(path, printer)) < 0) {
+            cerr << "cannot list " << path << " (" << ret << ")" << endl;
+            return ret;
+        }
+
+        return (int)printer.count;
+    }
+
+    vector<FS::Dirent> ents;
+    unsigned long dir;
+
+    if ((ret = ns.resolve(path, dir)) < 0 || (ret = ns.list(dir, ents)) < 0) {
+        cerr << "cannot list " << path << " (" << ret << ")" << endl;
+        return ret;
+    }
+
+    for (const FS::Dirent & ent : ents)
+        print_dirent(ent.name, ent);
+
+    return (int)ents.size();
+}
@@ -0,0 +1,147 @@
+/*
+ * fsquery.h
+ *
+ * Copyright (C) 2018
+ * University of Toronto
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@utoronto.ca
+ */
+
+#ifndef FSQUERY_H
+#define FSQUERY_H
+
+#include <libfs.h>
+#include <string>
+#include <vector>
+
+// a path expression is a list of steps separated by '/', starting from the
+// super block, e.g.
+//
+//   super/s_block_group_desc[*]/bg_inode_table[*][i_mode & EXT3_S_IFDIR]/i_size
+//
+// each step names a field of the current entity. pointers are only fetched
+// when they are named by a step that has subscripts or is followed by more
+// steps. subscripts are applied in order:
+//
+//   [*]     all elements, nested vectors and extents are flattened
+//   [n]     the n-th element (of the flattened elements)
+//   [expr]  keep only if expr holds, where expr is 'a', '!a' or 'a op b',
+//           op is one of & | == != < > <= >=, and operands are fields of
+//           the current entity, numbers or annotated constants
+//
+// instead of super, the first step may name one or more container types,
+// separated by '|', e.g.
+//
+//   DIR_BLOCK|DIR_INDIRECT_BLOCK[*]/inode
+//
+// in which case every container of those types is found by a walk from the
+// super block that only follows the pointers that can reach them. extents
+// of those types are replaced by their elements
+//
+struct FQOperand
+{
+    std::string field;  /* empty if constant */
+    long value;
+
+    FQOperand() : value(0) {}
+};
+
+struct FQPredicate
+{
+    enum Op { OP_NONE, OP_AND, OP_OR, OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE };
+
+    bool negate;
+    Op op;
+    FQOperand lhs, rhs;
+
+    FQPredicate() : negate(false), op(OP_NONE) {}
+};
+
+struct FQSubscript
+{
+    enum Kind { SUB_ALL, SUB_INDEX, SUB_PRED };
+
+    Kind kind;
+    long index;
+    FQPredicate pred;
+
+    FQSubscript(Kind k) : kind(k), index(0) {}
+};
+
+struct FQStep
+{
+    std::string name;
+    std::vector<FQSubscript> subs;
+};
+
+class FSQuery
+{
+    class ElemVisitor;
+    class TypeVisitor;
+
+    FS::FileSystem & fs;
+    std::vector<FQStep> plan;
+    std::vector<int> types;     /* empty if the path starts from super */
+    std::string error;
+    std::string label;
+    FS::Visitor * output;
+    unsigned long num_matches;
+
+    int set_error(const char * msg, const std::string & arg);
+    int compile_step(const std::string & str);
+    int compile_types(const std::string & str);
+    int resolve(void);
+    int resolve(const std::vector<int> & scopes, const std::string & name,
+        std::vector<int> * next=nullptr);
+    int compile_predicate(const std::string & str, FQPredicate & pred);
+    int compile_operand(const std::string & str, FQOperand & opnd);
+
+    bool evaluate(FS::Entity & ent, const FQPredicate & pred);
+    bool evaluate(FS::Entity & ent, const FQOperand & opnd, long & value);
+
+    int step(FS::Entity & ent, unsigned i);
+    int apply(FS::Entity & ent, unsigned i, unsigned k);
+
+public:
+    FSQuery(FS::FileSystem & fs) : fs(fs), output(nullptr), num_matches(0) {}
+
+    // turns a path expression into a traversal plan, checking that every
+    // field it names exists in the type graph of the file system
+    // returns 0 on success, negative value on syntax error
+    int compile(const char * expr);
+
+    // walks the file system according to the plan, calling visitor.visit()
+    // on every entity that matches the full path expression
+    // returns 0 on success, negative value on failure
+    int execute(FS::Visitor & visitor);
+
+    // path (with element indices) of the entity being visited
+    const char * get_label() const { return label.c_str(); }
+
+    const char * get_error() const { return error.c_str(); }
+    unsigned long get_num_matches() const { return num_matches; }
+};
+
+// runs the query on fs and prints every match to stdout
+// returns number of matches, or negative value on failure
+//
+int fq_query_filesystem(FS::FileSystem & fs, const char * expr);
+
+// name commands work on paths instead of metadata:
+//
+//   ls path     entries of a directory
+//   lsr path    everything under a directory
+//   stat path   inode of a file
+//
+bool fq_is_name_command(const char * cmd);
+
+// runs a name command through the adapter of the file system and prints
+// the result to stdout. returns number of entries printed, or negative
+// value on failure
+//
+int fq_query_names(FS::NameAdapter & adapter, const char * cmd,
+    const char * path);
+
+#endif /* FSQUERY_H */
+
@@ -0,0 +1,247 @@
+/*
+ * directio.cpp
+ *
+ * implementation of FS::IO over O_DIRECT with a pool of aligned buffers
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include "directio.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* alignment of a regular file, whose logical block size cannot be queried,
+ * which is also enough for any device with 512 byte sectors */
+#define DIRECTIO_FILE_ALIGN 4096
+
+DirectIO::DirectIO() : IO(""), fd(-1), writable(false), block_size(0), 
+    sector_size(0), unit(0), size(0), clock(0) {}
+
+DirectIO::~DirectIO()
+{
+    close();
+}
+
+int DirectIO::open(const char * filename, size_t unit, unsigned nbufs,
+    bool writable)
+{
+    struct stat st;
+    int ssz, ret;
+
+    if (fd >= 0 || unit == 0 || nbufs == 0)
+        return -EINVAL;
+
+    /* read-only unless asked, so that read-only images and write-protected
+     * devices can be scanned */
+    if ((fd = ::open(filename, (writable ? O_RDWR : O_RDONLY) | O_DIRECT)) < 0)
+        return -errno;
+
+    this->writable = writable;
+
+    sector_size = DIRECTIO_FILE_ALIGN;
+    if (fstat(fd, &st) < 0)
+        goto fail;
+
+    if (S_ISBLK(st.st_mode)) {
+        if (ioctl(fd, BLKSSZGET, &ssz) < 0)
+            goto fail;
+        sector_size = ssz;
+    }
+
+    if ((size = lseek(fd, 0, SEEK_END)) < 0)
+        goto fail;
+
+    this->unit = (unit + sector_size - 1) / sector_size * sector_size;
+    pool.resize(nbufs);
+    for (Buffer & b : pool) {
+        b.pos = -1;
+        b.len = 0;
+        b.used = 0;
+        if ((ret = posix_memalign((void **)&b.data, sector_size, 
+                this->unit)) != 0) {
+            b.data = nullptr;
+            close();
+            return -ret;
+        }
+    }
+
+    set_name(filename);
+    return 0;
+fail:
+    ret = -errno;
+    close();
+    return ret;
+}
+
+int DirectIO::close()
+{
+    int ret = -EINVAL;
+
+    for (Buffer & b : pool)
+        free(b.data);
+    pool.clear();
+
+    if (fd >= 0) {
+        ret = (::close(fd) < 0) ? -errno : 0;
+        fd = -1;
+    }
+
+    return ret;
+}
+
+/* the buffer holding the unit that starts at pos, reading it if needed */
+int DirectIO::fill(off_t pos, Buffer * & buf)
+{
+    Buffer * victim = &pool[0];
+    ssize_t len;
+
+    for (Buffer & b : pool) {
+        if (b.pos == pos) {
+            b.used = ++clock;
+            buf = &b;
+            return 0;
+        }
+
+        if (b.used < victim->used)
+            victim = &b;
+    }
+
+    victim->pos = -1;
+    if ((len = pread(fd, victim->data, unit, pos)) < 0)
+        return -errno;
+
+    /* past the end of the device, which a write may extend */
+    memset(victim->data + len, 0, unit - len);
+    victim->pos = pos;
+    victim->len = len;
+    victim->used = ++clock;
+    buf = victim;
+    return 0;
+}
+
+int DirectIO::read_at(off_t pos, size_t len, char * out)
+{
+    size_t done, off, n;
+    Buffer * buf;
+    int ret;
+
+    for (done = 0; done < len; done += n) {
+        off = (pos + done) % unit;
+        if ((ret = fill(pos + done - off, buf)) < 0)
+            return ret;
+
+        if (off >= buf->len)
+            return -EIO;
+
+        n = std::min(len - done, buf->len - off);
+        memcpy(out + done, buf->data + off, n);
+    }
+
+    return len;
+}
+
+/* the sectors that the write covers are written from the buffer, which is
+ * then up to date */
+int DirectIO::write_at(off_t pos, size_t len, const char * in)
+{
+    size_t done, off, n, start, end;
+    Buffer * buf;
+    ssize_t written;
+    int ret;
+
+    if (!writable)
+        return -EBADF;
+
+    for (done = 0; done < len; done += n) {
+        off = (pos + done) % unit;
+        if ((ret = fill(pos + done - off, buf)) < 0)
+            return ret;
+
+        n = std::min(len - done, unit - off);
+        memcpy(buf->data + off, in + done, n);
+
+        start = off / sector_size * sector_size;
+        end = (off + n + sector_size - 1) / sector_size * sector_size;
+        written = pwrite(fd, buf->data + start, end - start, buf->pos + start);
+        if (written != (ssize_t)(end - start)) {
+            buf->pos = -1;
+            return (written < 0) ? -errno : -EIO;
+        }
+
+        if (end > buf->len)
+            buf->len = end;
+        if (buf->pos + (long long)end > size)
+            size = buf->pos + end;
+    }
+
+    return len;
+}
+
+long long DirectIO::get_position(const FS::Location & loc)
+{
+    if (loc.dynamic)
+        return -EINVAL;
+
+    switch (loc.aspc)
+    {
+    case FS::AS_BYTE:
+        return (long long)loc.addr + loc.offset;
+    /* like BlockIO::read, expects the first address space of the file
+     * system to be its blocks, of block_size bytes */
+    case FS::NUM_ADDRSPACES:
+        if (block_size == 0)
+            return FS::ERR_UNINIT;
+        return (long long)loc.addr * block_size + loc.offset;
+    default:
+        break;
+    }
+
+    return -EINVAL;
+}
+
+int DirectIO::read(const FS::Location & loc, char * & buf)
+{
+    long long pos;
+    int ret;
+
+    buf = nullptr;
+    if (fd < 0)
+        return FS::ERR_UNINIT;
+
+    if ((pos = get_position(loc)) < 0)
+        return pos;
+
+    /* the caller owns the buffer, the pool only holds what was read */
+    if ((buf = new char[loc.size]) == nullptr)
+        return -ENOMEM;
+
+    if ((ret = read_at(pos, loc.size, buf)) < 0) {
+        delete [] buf;
+        buf = nullptr;
+    }
+
+    return ret;
+}
+
+int DirectIO::write(const FS::Location & loc, const char * buf)
+{
+    long long pos;
+
+    if (fd < 0)
+        return FS::ERR_UNINIT;
+
+    if ((pos = get_position(loc)) < 0)
+        return pos;
+
+    return write_at(pos, loc.size, buf);
+}
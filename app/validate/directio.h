@@ -0,0 +1,72 @@
+/*
+ * directio.h
+ *
+ * reads and writes the byte and block address spaces with O_DIRECT, so that
+ * a scan of a whole device does not fill the page cache. every request is
+ * served through a small pool of aligned buffers, each holding one read unit
+ * of the device, which is read at once. a scan in order of address therefore
+ * reads the device in large sequential requests.
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#ifndef DIRECTIO_H
+#define DIRECTIO_H
+
+#include <libfs.h>
+#include <sys/types.h>
+#include <vector>
+
+class DirectIO : public FS::IO
+{
+    // unit [pos, pos + len) of the device, len is short at its end
+    struct Buffer
+    {
+        char * data;
+        off_t pos;              // -1 if empty
+        size_t len;
+        unsigned long used;     // for eviction of the least recently used
+    };
+
+    int fd;
+    bool writable;
+    unsigned block_size;
+    unsigned sector_size;       // logical block size, which aligns requests
+    size_t unit;
+    long long size;
+    unsigned long clock;
+    std::vector<Buffer> pool;
+
+    int fill(off_t pos, Buffer * & buf);
+    int read_at(off_t pos, size_t len, char * out);
+    int write_at(off_t pos, size_t len, const char * in);
+
+public:
+    enum { DEFAULT_UNIT = 1 << 20, DEFAULT_BUFFERS = 8 };
+
+    DirectIO();
+    virtual ~DirectIO() override;
+
+    // unit: bytes read at once, rounded up to the logical block size of 
+    // the device. writable: open for writing as well, otherwise the device
+    // is opened read-only and writes fail with -EBADF. returns negative 
+    // value if the device cannot be opened with O_DIRECT (e.g. tmpfs), or 
+    // the pool cannot be allocated
+    int open(const char * filename, size_t unit=DEFAULT_UNIT,
+        unsigned nbufs=DEFAULT_BUFFERS, bool writable=false);
+    int close();
+
+    void set_block_size(unsigned size) { block_size = size; }
+    size_t get_block_size() const { return block_size; }
+    long long get_size() const { return size; }
+    size_t get_unit() const { return unit; }
+
+    virtual int read(const FS::Location & loc, char * & buf) override;
+    virtual int write(const FS::Location & loc, const char * buf) override;
+    virtual long long get_position(const FS::Location & loc) override;
+};
+
+#endif /* DIRECTIO_H */
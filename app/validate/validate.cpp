@@ -0,0 +1,663 @@
+/*
+ * validate.cpp
+ *
+ * Streams through the metadata of a file system image in physical address
+ * order, checking each container against its annotated constraints directly
+ * on the raw buffer before parsing it for pointers to follow. Given the
+ * snapshot of a previous scan, subtrees whose generation has not changed
+ * since are not descended again
+ *
+ * Kuei (Jack) Sun
+ * kuei.sun@mail.utoronto.ca
+ *
+ * University of Toronto
+ * 2018
+ */
+
+#include <libfs.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unistd.h>
+#include "validate.h"
+
+using namespace std;
+
+int ScanIO::open(const char * filename, size_t unit)
+{
+    int ret;
+
+    if (unit > 0) {
+        if ((ret = direct.open(filename, unit)) < 0)
+            return ret;
+
+        set_name(filename);
+        use_direct = true;
+        image_size = direct.get_size();
+        return 0;
+    }
+
+    if ((ret = BlockIO::open(filename)) < 0)
+        return ret;
+
+    if (fseeko(fsimg, 0, SEEK_END) < 0 || (image_size = ftello(fsimg)) < 0) {
+        ret = -errno;
+        close();
+        return ret;
+    }
+
+    return 0;
+}
+
+long long ScanIO::physical(const FS::Location & loc) const
+{
+    if (loc.dynamic)
+        return -1;
+
+    switch (loc.aspc)
+    {
+    case FS::AS_BYTE:
+        return (long long)loc.addr + loc.offset;
+    /* like BlockIO::read, expects the first address space of the file
+     * system to be its blocks, of block_size bytes */
+    case FS::NUM_ADDRSPACES:
+        if (block_size == 0)
+            break;
+        return (long long)loc.addr * block_size + loc.offset;
+    default:
+        break;
+    }
+
+    return -1;
+}
+
+/* where a container was found, as saved in a snapshot */
+struct VDKey
+{
+    u64 addr;
+    u32 offset;
+    u16 aspc;
+    u16 type;
+};
+
+/* the results of the subtree of a container that has a generation. parent
+ * is the closest ancestor that also has one, so that the subtrees nested in
+ * a reused subtree are kept for the scans after the next */
+struct VDRecord
+{
+    VDKey key;
+    VDKey parent;               /* type is INVALID_TYPE_ID if there is none */
+    u64 generation;
+    u64 containers;
+    u64 problems;
+    u64 skipped;
+};
+
+/* a snapshot file is this header followed by num_records records */
+struct VDSnapshotHeader
+{
+    char magic[8];
+    u32 version;
+    u32 block_size;
+    u64 image_size;
+    u64 num_records;
+};
+
+#define VD_SNAPSHOT_MAGIC "SPFYSNAP"
+#define VD_SNAPSHOT_VERSION 1
+
+/* 
+ * a pointer's path may live inside any of its ancestors (e.g. the camino of
+ * the super block), so the whole chain is kept alive while it is pending
+ */
+struct Lineage
+{
+    const FS::Container * ctn;
+    Lineage * parent;
+    VDRecord * rec;             /* only if ctn has a generation */
+    unsigned refs;
+
+    Lineage(const FS::Container * c, Lineage * p, VDRecord * r) : ctn(c), 
+        parent(p), rec(r), refs(1) {
+        ctn->incref();
+        if (parent != nullptr)
+            parent->refs++;
+    }
+
+    /* a subtree is complete once nothing below it is pending */
+    static void release(Lineage * lin, std::vector<VDRecord> * done) {
+        while (lin != nullptr && --lin->refs == 0) {
+            Lineage * parent = lin->parent;
+            if (lin->rec != nullptr && done != nullptr)
+                done->push_back(*lin->rec);
+            lin->ctn->decref();
+            delete lin->rec;
+            delete lin;
+            lin = parent;
+        }
+    }
+};
+
+/* a container that is waiting to be read */
+struct Pending
+{
+    long long pos;                  /* physical byte offset */
+    unsigned long seq;              /* discovery order, breaks ties */
+    FS::Pointer * ptr;
+    Lineage * owner;                /* keeps ptr and its path alive */
+
+    bool operator<(const Pending & rhs) const {
+        return (pos != rhs.pos) ? (pos < rhs.pos) : (seq < rhs.seq);
+    }
+};
+
+class Validator
+{
+    typedef std::tuple<int, unsigned long, unsigned, unsigned> Key;
+
+    FS::FileSystem & fs;
+    ScanIO & io;
+    VDOptions & opt;
+
+    std::set<Pending> pending;
+    std::set<Key> visited;
+
+    /* subtrees of the previous scan by their root, and the ones nested in
+     * each of them by their parent */
+    std::vector<VDRecord> cached;
+    std::map<Key, size_t> roots;
+    std::multimap<Key, size_t> nested;
+    std::vector<VDRecord> records;          /* subtrees of this scan */
+    bool reuse;
+
+    /* records every pointer if a reverse map is wanted */
+    FS::RMapBuilder * rmap;
+    long long head;
+    unsigned long seq;
+
+    /* statistics */
+    unsigned long num_containers;
+    unsigned long num_problems;
+    unsigned long num_skipped;
+    unsigned long num_sweeps;
+    unsigned long num_reused;
+
+    static Key to_key(const VDKey & k) {
+        return Key(k.aspc, k.addr, k.offset, k.type);
+    }
+
+    /* counts towards the totals and the subtree of every ancestor */
+    void account(Lineage * lin, u64 containers, u64 problems, u64 skipped)
+    {
+        num_containers += containers;
+        num_problems += problems;
+        num_skipped += skipped;
+
+        for (; lin != nullptr; lin = lin->parent) {
+            if (lin->rec == nullptr)
+                continue;
+            lin->rec->containers += containers;
+            lin->rec->problems += problems;
+            lin->rec->skipped += skipped;
+        }
+    }
+
+    void report(const char * what, int type, const FS::Location & loc,
+        const char * why, Lineage * lin)
+    {
+        account(lin, 0, 1, 0);
+        if (opt.quiet)
+            return;
+
+        cout << what << " " << fs.type_to_name(type)
+             << " aspc=" << fs.address_space_to_name(loc.aspc)
+             << " addr=" << loc.addr;
+        if (loc.offset > 0)
+            cout << " offset=" << loc.offset;
+        cout << ": " << why << endl;
+    }
+
+    struct PtrCollector : public FS::Visitor
+    {
+        Validator & vd;
+        Lineage * owner;
+        const FS::Container * from;     /* container that has the pointers */
+        int from_type;
+
+        PtrCollector(Validator & v, Lineage * o, int t) :
+            vd(v), owner(o), from(o->ctn), from_type(t) {}
+
+        virtual int visit(FS::Entity & ent) override {
+            FS::Pointer * ptr = ent.to_pointer();
+            if (ptr == nullptr)
+                return 0;
+            if (vd.rmap != nullptr)
+                vd.rmap->add(*from, from_type, *ptr);
+            vd.push(ptr, owner);
+            return 0;
+        }
+    };
+
+    /* pointers inside of an extent are only reachable through its elements */
+    struct ElemCollector : public FS::Visitor
+    {
+        PtrCollector & pc;
+
+        ElemCollector(PtrCollector & p) : pc(p) {}
+
+        virtual int visit(FS::Entity & ent) override {
+            FS::Container * ctn = ent.to_container();
+            if (ctn == nullptr)
+                return 0;
+            if (ctn->is_extent())
+                return ctn->accept_fields(*this);
+
+            pc.vd.account(pc.owner, 1, 0, 0);
+            pc.from = ctn;
+            return ctn->accept_pointers(pc);
+        }
+    };
+
+    void push(FS::Pointer * ptr, Lineage * owner)
+    {
+        const FS::Location & loc = ptr->pointer_location();
+        int type = ptr->pointer_type();
+        long long pos;
+
+        /* pointer does not point to anything valid */
+        if (type == FS::INVALID_TYPE_ID)
+            return;
+
+        if ((pos = io.physical(loc)) < 0) {
+            account(owner, 0, 0, 1);
+            return;
+        }
+
+        if (loc.size == 0 || pos + loc.size > io.get_image_size()) {
+            report("out of range", type, loc, ptr->get_name(), owner);
+            return;
+        }
+
+        if (!visited.emplace(loc.aspc, loc.addr, loc.offset, type).second)
+            return;
+
+        owner->refs++;
+        pending.insert(Pending{ pos, seq++, ptr, owner });
+    }
+
+    /* keeps a reused subtree, and every subtree nested in it, for the next
+     * scan. the snapshot is only trusted this far to not have cycles */
+    void carry(const VDRecord & rec)
+    {
+        std::set<Key> seen;
+        std::vector<size_t> stack;
+
+        records.push_back(rec);
+        seen.insert(to_key(rec.key));
+        stack.push_back(roots[to_key(rec.key)]);
+
+        while (!stack.empty()) {
+            auto range = nested.equal_range(to_key(cached[stack.back()].key));
+            stack.pop_back();
+
+            for (auto it = range.first; it != range.second; ++it) {
+                const VDRecord & child = cached[it->second];
+                if (!seen.insert(to_key(child.key)).second)
+                    continue;
+                records.push_back(child);
+                stack.push_back(it->second);
+            }
+        }
+    }
+
+    /* starts the lineage of a parsed container, or returns nullptr if the
+     * results of its whole subtree are taken from the snapshot instead */
+    Lineage * adopt(FS::Container * ctn, int type, Lineage * parent)
+    {
+        const FS::Location & loc = ctn->get_location();
+        VDKey key = { loc.addr, loc.offset, (u16)loc.aspc, (u16)type };
+        VDKey up = { 0, 0, 0, FS::INVALID_TYPE_ID };
+        VDRecord * rec;
+        Lineage * anc;
+        u64 gen;
+
+        if (opt.snapshot == nullptr || opt.generation == nullptr ||
+            opt.generation(fs, ctn, type, gen) < 0)
+            return new Lineage(ctn, parent, nullptr);
+
+        for (anc = parent; anc != nullptr && anc->rec == nullptr; 
+             anc = anc->parent);
+        if (anc != nullptr)
+            up = anc->rec->key;
+
+        auto it = roots.find(to_key(key));
+        if (reuse && it != roots.end() && 
+            cached[it->second].generation == gen) {
+            VDRecord old = cached[it->second];
+
+            /* the container itself has already been counted */
+            account(parent, old.containers - 1, old.problems, old.skipped);
+            old.parent = up;
+            carry(old);
+            num_reused++;
+
+            if (old.problems > 0 && !opt.quiet)
+                cout << "unchanged " << fs.type_to_name(type)
+                     << " aspc=" << fs.address_space_to_name(loc.aspc)
+                     << " addr=" << loc.addr << ": " << old.problems
+                     << " problem(s) from last scan" << endl;
+            return nullptr;
+        }
+
+        rec = new VDRecord{ key, up, gen, 1, 0, 0 };
+        return new Lineage(ctn, parent, rec);
+    }
+
+    void collect(FS::Container * ctn, int type, Lineage * lin)
+    {
+        PtrCollector pc(*this, lin, type);
+        ElemCollector ec(pc);
+
+        if (ctn->is_extent())
+            ctn->accept_fields(ec);
+        else
+            ctn->accept_pointers(pc);
+        
+        Lineage::release(lin, &records);
+    }
+
+    /* circular scan: always read the closest container ahead of the head */
+    bool next(Pending & item)
+    {
+        std::set<Pending>::iterator it;
+
+        if (pending.empty())
+            return false;
+
+        it = pending.lower_bound(Pending{ head, 0, nullptr, nullptr });
+        if (it == pending.end()) {
+            it = pending.begin();
+            num_sweeps++;
+        }
+
+        item = *it;
+        pending.erase(it);
+        head = item.pos;
+        return true;
+    }
+
+    /* an extent is pointed to by the type of its innermost container, so
+     * a single read may hold many containers that are checked in turn */
+    void process(const Pending & item)
+    {
+        const FS::Location & lc = item.ptr->pointer_location();
+        FS::Location loc(lc);
+        FS::Path * path = item.ptr->get_path();
+        int type = item.ptr->pointer_type();
+        FS::Container * ctn;
+        Lineage * lin;
+        char * buf = nullptr;
+        unsigned off, size;
+        int ret;
+
+        if (fs.validate_by_type(type, loc, path, nullptr, 0) == FS::ERR_UNIMP) {
+            /* no validator for this type (e.g. heterogeneous extent) */
+            account(item.owner, 1, 0, 0);
+            if ((ctn = item.ptr->fetch()) == nullptr) {
+                report("corrupt", type, loc, "fetch failed", item.owner);
+                return;
+            }
+            
+            if ((lin = adopt(ctn, type, item.owner)) != nullptr)
+                collect(ctn, type, lin);
+            ctn->destroy();
+            return;
+        }
+        
+        if ((ret = io.read(loc, buf)) < 0 || buf == nullptr) {
+            report("unreadable", type, loc, strerror(-ret), item.owner);
+            return;
+        }
+
+        for (off = 0; off < loc.size; off += size) {
+            FS::Location el(loc, loc.size - off, loc.offset + off);
+            const char * why = "parse failed";
+            
+            account(item.owner, 1, 0, 0);
+            ret = fs.validate_by_type(type, el, path, buf + off, el.size, &why);
+            ctn = nullptr;
+            if (ret == 0)
+                ctn = fs.parse_by_type(type, el, path, buf + off, el.size);
+            
+            if (ctn == nullptr) {
+                report("corrupt", type, el, why, item.owner);
+                break;
+            }
+            
+            size = ctn->get_size();
+            if ((lin = adopt(ctn, type, item.owner)) != nullptr)
+                collect(ctn, type, lin);
+            ctn->destroy();
+            
+            if (size == 0)
+                break;
+        }
+        
+        delete [] buf;
+    }
+
+public:
+    Validator(FS::FileSystem & fs, ScanIO & io, VDOptions & opt) :
+        fs(fs), io(io), opt(opt), reuse(false), head(0), seq(0), 
+        num_containers(0), num_problems(0), num_skipped(0), num_sweeps(1), 
+        num_reused(0) {
+        /* the same assumption about the block address space as physical */
+        std::vector<unsigned> units(FS::NUM_ADDRSPACES + 1, 0);
+        units[FS::AS_BYTE] = 1;
+        units[FS::NUM_ADDRSPACES] = io.get_block_size();
+        rmap = (opt.rmap != nullptr) ? new FS::RMapBuilder(units) : nullptr;
+    }
+
+    ~Validator()
+    {
+        for (const Pending & item : pending)
+            Lineage::release(item.owner, nullptr);
+        delete rmap;
+    }
+
+    /* a missing snapshot is the first scan. one of another image (as far
+     * as we can tell) or a different version is ignored, like a corrupt 
+     * one, which costs nothing but a full scan */
+    int load(const char * filename)
+    {
+        VDSnapshotHeader hdr;
+        FILE * f;
+        bool ok;
+
+        if ((f = fopen(filename, "rb")) == nullptr)
+            return (errno == ENOENT) ? 0 : -errno;
+
+        ok = (fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              memcmp(hdr.magic, VD_SNAPSHOT_MAGIC, sizeof(hdr.magic)) == 0 &&
+              hdr.version == VD_SNAPSHOT_VERSION &&
+              hdr.block_size == io.get_block_size() &&
+              (long long)hdr.image_size == io.get_image_size());
+
+        if (ok) {
+            cached.resize(hdr.num_records);
+            ok = (hdr.num_records == 0 || fread(cached.data(), 
+                sizeof(VDRecord), hdr.num_records, f) == hdr.num_records);
+        }
+
+        fclose(f);
+        if (!ok) {
+            cout << filename << ": not a snapshot of this image, ignored" 
+                 << endl;
+            cached.clear();
+            return 0;
+        }
+
+        for (size_t i = 0; i < cached.size(); i++) {
+            roots[to_key(cached[i].key)] = i;
+            if (cached[i].parent.type != FS::INVALID_TYPE_ID)
+                nested.emplace(to_key(cached[i].parent), i);
+        }
+
+        /* every pointer has to be seen again for the reverse map */
+        reuse = (rmap == nullptr);
+        return 0;
+    }
+
+    /* written next to the old one, which is only replaced once complete */
+    int save(const char * filename)
+    {
+        std::string tmp = std::string(filename) + ".tmp";
+        VDSnapshotHeader hdr;
+        FILE * f;
+        bool ok;
+
+        if ((f = fopen(tmp.c_str(), "wb")) == nullptr)
+            return -errno;
+
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, VD_SNAPSHOT_MAGIC, sizeof(hdr.magic));
+        hdr.version = VD_SNAPSHOT_VERSION;
+        hdr.block_size = io.get_block_size();
+        hdr.image_size = io.get_image_size();
+        hdr.num_records = records.size();
+
+        ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+        if (ok && !records.empty())
+            ok = (fwrite(records.data(), sizeof(VDRecord), records.size(), 
+                         f) == records.size());
+
+        if (fclose(f) != 0 || !ok || rename(tmp.c_str(), filename) < 0) {
+            unlink(tmp.c_str());
+            return -EIO;
+        }
+
+        return 0;
+    }
+
+    int run()
+    {
+        FS::Container * super;
+        const char * why = "parse failed";
+        char * buf = nullptr;
+        Lineage * lin;
+        Pending item;
+        int ret;
+
+        if (opt.snapshot != nullptr && (ret = load(opt.snapshot)) < 0) {
+            cout << opt.snapshot << ": could not load snapshot" << endl;
+            return ret;
+        }
+
+        if ((super = fs.fetch_super()) == nullptr) {
+            cout << fs.io.get_name() << ": io error or super block is "
+                 << "corrupted" << endl;
+            return FS::ERR_CORRUPT;
+        }
+
+        account(nullptr, 1, 0, 0);
+        if ((lin = adopt(super, fs.super_type_id(), nullptr)) != nullptr) {
+            const FS::Location & loc = super->get_location();
+            if ((ret = io.read(loc, buf)) >= 0 && buf != nullptr) {
+                ret = fs.validate_by_type(fs.super_type_id(), loc,
+                    super->get_path(), buf, loc.size, &why);
+                if (ret < 0 && ret != FS::ERR_UNIMP)
+                    report("corrupt", fs.super_type_id(), loc, why, lin);
+                delete [] buf;
+            }
+
+            collect(super, fs.super_type_id(), lin);
+        }
+        super->destroy();
+
+        while (next(item)) {
+            process(item);
+            Lineage::release(item.owner, &records);
+        }
+
+        cout << fs.io.get_name() << ": "
+             << (num_problems > 0 ? "CORRUPT" : "OK")
+             << ", " << num_containers << " containers"
+             << ", " << io.get_bytes_read() << " bytes"
+             << ", " << num_sweeps << " sweep(s)"
+             << ", " << num_skipped << " pointer(s) skipped"
+             << ", " << num_problems << " problem(s)" << endl;
+
+        /* nothing is visited twice, so one sweep should not read more than
+         * the image (the super block is the only container read twice) */
+        if (num_sweeps == 1 && (long long)io.get_bytes_read() > 
+            io.get_image_size())
+            cout << fs.io.get_name() << ": warning, read " 
+                 << io.get_bytes_read() << " bytes of a " 
+                 << io.get_image_size() << " byte image in one sweep" << endl;
+
+        if (opt.snapshot != nullptr) {
+            if ((ret = save(opt.snapshot)) < 0) {
+                cout << opt.snapshot << ": could not save snapshot" << endl;
+                return ret;
+            }
+
+            if (!opt.quiet)
+                cout << opt.snapshot << ": " << records.size() 
+                     << " subtree(s), " << num_reused << " unchanged" << endl;
+        }
+
+        if (rmap != nullptr) {
+            if ((ret = rmap->save(opt.rmap)) < 0) {
+                cout << opt.rmap << ": could not save reverse map" << endl;
+                return ret;
+            }
+
+            if (!opt.quiet)
+                cout << opt.rmap << ": " << rmap->size() << " pointer(s), "
+                     << rmap->get_skipped() << " skipped" << endl;
+        }
+
+        return (int)num_problems;
+    }
+};
+
+int vd_parse_args(int argc, const char * argv[], VDOptions & opt,
+    const char * & filename)
+{
+    int i;
+
+    for (i = 1; i < argc - 1; i++) {
+        if (!strcmp(argv[i], "-q"))
+            opt.quiet = true;
+        else if (!strcmp(argv[i], "-d") && opt.direct_unit == 0)
+            opt.direct_unit = DirectIO::DEFAULT_UNIT;
+        else if (!strcmp(argv[i], "-u") && i + 2 < argc)
+            opt.direct_unit = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "-r") && i + 2 < argc)
+            opt.rmap = argv[++i];
+        else if (!strcmp(argv[i], "-s") && i + 2 < argc)
+            opt.snapshot = argv[++i];
+        else
+            break;
+    }
+
+    if (i != argc - 1) {
+        cout << "usage: " << argv[0] << " [-q] [-d] [-u unit] [-r rmapfile] "
+             << "[-s snapshot] device" << endl;
+        return -EINVAL;
+    }
+
+    filename = argv[i];
+    return 0;
+}
+
+int vd_validate_filesystem(FS::FileSystem & fs, ScanIO & io, VDOptions & opt)
+{
+    Validator validator(fs, io, opt);
+    return validator.run();
+}
+
@@ -0,0 +1,101 @@
+/*
+ * validate.h
+ *
+ * Copyright (C) 2018
+ * University of Toronto
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@utoronto.ca
+ */
+
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include <libfs.h>
+#include "blockio.h"
+#include "directio.h"
+
+// scan io: a block io that also knows where each location lives on the
+// image, so that the validator can stream in physical address order and
+// range check pointers against the size of the image. it can read through
+// O_DIRECT instead, so that the scan does not evict the page cache
+class ScanIO : public BlockIO
+{
+    long long image_size;
+    DirectIO direct;
+    bool use_direct;
+    unsigned long long bytes_read;
+
+public:
+    ScanIO() : image_size(0), use_direct(false), bytes_read(0) {}
+
+    // unit: bytes read at once with O_DIRECT, or 0 to read through stdio
+    int open(const char * filename, size_t unit=0);
+
+    void set_block_size(unsigned size) {
+        BlockIO::set_block_size(size);
+        direct.set_block_size(size);
+    }
+
+    long long get_image_size() const { return image_size; }
+
+    // every read is counted here, whoever it is made by
+    unsigned long long get_bytes_read() const { return bytes_read; }
+
+    virtual int read(const FS::Location & loc, char * & buf) override {
+        int ret = use_direct ? direct.read(loc, buf) : BlockIO::read(loc, buf);
+        if (ret >= 0 && buf != nullptr)
+            bytes_read += loc.size;
+        return ret;
+    }
+
+    virtual int write(const FS::Location & loc, const char * buf) override {
+        return use_direct ? direct.write(loc, buf) : BlockIO::write(loc, buf);
+    }
+
+    // returns byte offset of location within the image, or negative value
+    // if the location is not in an address space that we know how to read
+    long long physical(const FS::Location & loc) const;
+};
+
+// returns 0 and stores in gen the generation of a container whose entire
+// subtree is unchanged for as long as its generation is (e.g. a copy-on-write
+// tree block), or negative value if the container has no such marker
+typedef int (*VDGeneration)(FS::FileSystem & fs, FS::Container * ctn, 
+    int type, u64 & gen);
+
+struct VDOptions
+{
+    bool quiet;             /* only print the summary */
+    const char * rmap;      /* where to save the reverse map, if not null */
+    const char * snapshot;  /* results of the previous scan, if not null */
+    size_t direct_unit;     /* O_DIRECT read unit, 0 to read through stdio */
+    VDGeneration generation;
+
+    VDOptions() : quiet(false), rmap(nullptr), snapshot(nullptr), 
+        direct_unit(0), generation(nullptr) {}
+};
+
+// parses [-q] [-d] [-u unit] [-r rmapfile] [-s snapshot] device, where -d
+// reads the device with O_DIRECT, and -u does too with a read unit of that
+// many bytes. returns 0 on success or prints the usage and returns negative
+// value
+int vd_parse_args(int argc, const char * argv[], VDOptions & opt,
+    const char * & filename);
+
+// fs: the file system to validate, which must be using io
+// io: the object responsible for reading from the raw image of the file
+// system. The image must be opened and its block size set before this
+// function is called.
+//
+// if opt.snapshot is set, the subtree of every container that has the same
+// generation as in the snapshot is not descended again, and its results are
+// taken from the snapshot instead. the snapshot is then updated to this scan.
+// nothing is skipped if a reverse map is wanted, since it needs every pointer
+//
+// returns number of problems found, or negative value on fatal error
+//
+int vd_validate_filesystem(FS::FileSystem & fs, ScanIO & io, VDOptions & opt);
+
+#endif /* VALIDATE_H */
+
@@ -0,0 +1,75 @@
+/*
+ * vdbtrfs.cpp
+ *
+ * contains main() for bootstraping to libbtrfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libbtrfs.h>
+#include <iostream>
+#include "validate.h"
+
+using namespace std;
+
+/* a tree block is never written in place, so one with the same generation at
+ * the same address has the same subtree. the super block's generation is
+ * that of the last transaction, which covers all of the trees */
+static int btrfs_generation(FS::FileSystem & fs, FS::Container * ctn, 
+    int type, u64 & gen)
+{
+    switch (type)
+    {
+    case Btrfs::BTRFS_SUPER_BLOCK:
+        gen = ((Btrfs::BtrfsSuperBlock *)ctn)->generation;
+        return 0;
+    case Btrfs::BTRFS_NODE:
+        gen = ((Btrfs::BtrfsNode *)ctn)->header.generation;
+        return 0;
+    case Btrfs::BTRFS_LEAF:
+        gen = ((Btrfs::BtrfsLeaf *)ctn)->header.generation;
+        return 0;
+    default:
+        break;
+    }
+
+    return -ENOENT;
+}
+
+int main(int argc, const char * argv[]) 
+{
+    VDOptions opt;
+    ScanIO io;
+    Btrfs btrfs(io);
+    const char * filename;
+    Btrfs::BtrfsSuperBlock * super;
+    int ret;
+
+    if (vd_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+    opt.generation = btrfs_generation;
+    
+    if ((ret = io.open(filename, opt.direct_unit)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if ((super = (Btrfs::BtrfsSuperBlock *)btrfs.fetch_super())) {
+        io.set_block_size(super->sectorsize);
+        super->destroy();
+    }
+    else {
+        cout << filename << ": CORRUPT, io error or super block is corrupted" 
+             << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if (vd_validate_filesystem(btrfs, io, opt) != 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,67 @@
+/*
+ * vdext3.cpp
+ *
+ * contains main() for bootstraping to libext3
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libext3.h>
+#include <iostream>
+#include "validate.h"
+
+using namespace std;
+
+/* the super block is written with a new write time whenever the file system
+ * is unmounted or synced, including by the offline tools. group descriptor
+ * checksums only cover the descriptors, so they cannot vouch for anything
+ * below them */
+static int ext3_generation(FS::FileSystem & fs, FS::Container * ctn, int type,
+    u64 & gen)
+{
+    Ext3::Ext3SuperBlock * super = (Ext3::Ext3SuperBlock *)ctn;
+
+    if (type != Ext3::EXT3_SUPER_BLOCK)
+        return -ENOENT;
+
+    gen = ((u64)super->s_mtime << 32) | super->s_wtime;
+    return 0;
+}
+
+int main(int argc, const char * argv[]) 
+{
+    VDOptions opt;
+    ScanIO io;
+    Ext3 ext3(io);
+    const char * filename;
+    Ext3::Ext3SuperBlock * super;
+    int ret;
+
+    if (vd_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+    opt.generation = ext3_generation;
+    
+    if ((ret = io.open(filename, opt.direct_unit)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if ((super = (Ext3::Ext3SuperBlock *)ext3.fetch_super())) {
+        io.set_block_size(1024 << super->s_log_block_size);
+        super->destroy();
+    }
+    else {
+        cout << filename << ": CORRUPT, io error or super block is corrupted" 
+             << endl;
+        return EXIT_FAILURE;
+    }
+    
+    if (vd_validate_filesystem(ext3, io, opt) != 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,76 @@
+/*
+ * vdf2fs.cpp
+ *
+ * contains main() for bootstraping to libf2fs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libf2fs.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "validate.h"
+
+using namespace std;
+
+/* every update is made durable by writing a checkpoint pack with the next
+ * version, and the super block points to both packs and to everything else
+ * (the nat, sit and ssa). so nothing has changed if the newest version has
+ * not, which makes the nat and sit version bitmaps redundant here */
+static int f2fs_generation(FS::FileSystem & fs, FS::Container * ctn, int type,
+    u64 & gen)
+{
+    F2FS::F2fsSuperBlock * super = (F2FS::F2fsSuperBlock *)ctn;
+    const FS::Pointer * packs[] = { &super->cp_blkaddr, &super->cp_blkaddr2 };
+
+    if (type != F2FS::F2FS_SUPER_BLOCK)
+        return -ENOENT;
+
+    gen = 0;
+    for (const FS::Pointer * ptr : packs) {
+        const FS::Location & loc = ptr->pointer_location();
+        FS::Location head(loc, sizeof(u64), loc.offset);
+        char * buf = nullptr;
+        u64 ver;
+
+        if (fs.io.read(head, buf) < 0 || buf == nullptr)
+            return -EIO;
+
+        memcpy(&ver, buf, sizeof(ver));
+        gen = max(gen, ver);
+        delete [] buf;
+    }
+
+    return 0;
+}
+
+int main(int argc, const char * argv[]) 
+{
+    VDOptions opt;
+    ScanIO io;
+    F2FS f2fs(io);
+    const char * filename;
+    int ret;
+
+    if (vd_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+    opt.generation = f2fs_generation;
+    
+    if ((ret = io.open(filename, opt.direct_unit)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    /* f2fs always uses this block size */
+    io.set_block_size(F2FS_BLKSIZE);
+    
+    if (vd_validate_filesystem(f2fs, io, opt) != 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
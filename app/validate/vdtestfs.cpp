@@ -0,0 +1,41 @@
+/*
+ * vdtestfs.cpp
+ *
+ * contains main() for bootstraping to libtestfs
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * 2018, University of Toronto
+ */
+
+#include <libtestfs.h>
+#include <iostream>
+#include "validate.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) 
+{
+    VDOptions opt;
+    ScanIO io;
+    TestFS testfs(io);
+    const char * filename;
+    int ret;
+
+    if (vd_parse_args(argc, argv, opt, filename) < 0)
+        return EXIT_FAILURE;
+    
+    if ((ret = io.open(filename, opt.direct_unit)) < 0) {
+        cout << argv[0] << ": could not open " << filename << endl;
+        return EXIT_FAILURE;
+    }
+    
+    io.set_block_size(BLOCK_SIZE);
+    
+    if (vd_validate_filesystem(testfs, io, opt) != 0)
+        return EXIT_FAILURE;
+     
+    return EXIT_SUCCESS;
+}
+
@@ -28,16 +28,19 @@ def glob_recursive(folder, pattern):
     return matches
 
 # {1} is lower case, {2} is capitalized
-RULES = """lib{1}.h lib{1}.cpp: {0}.d
+RULES = """lib{1}.h lib{1}.cpp mb{1}.cpp: {0}.d
 {1}: {0}.d
 $(SRCDIR)/lib{1}.cpp: lib{1}.cpp
 \tcp $< $(SRCDIR)
 $(INCDIR)/lib{1}.h: lib{1}.h
 \tcp $< $(INCDIR)
-.PHONY: install-lib{1} remove-lib{1}
-install-lib{1}: $(SRCDIR)/lib{1}.cpp $(INCDIR)/lib{1}.h
+$(BENCHDIR)/mb{1}.cpp: mb{1}.cpp
+\tcp $< $(BENCHDIR)
+.PHONY: install-lib{1} remove-lib{1} install-mb{1}
+install-lib{1}: $(SRCDIR)/lib{1}.cpp $(INCDIR)/lib{1}.h install-mb{1}
+install-mb{1}: $(BENCHDIR)/mb{1}.cpp
 remove-lib{1}:
-\trm -f $(SRCDIR)/lib{1}.cpp $(INCDIR)/lib{1}.h
+\trm -f $(SRCDIR)/lib{1}.cpp $(INCDIR)/lib{1}.h $(BENCHDIR)/mb{1}.cpp
 """
 
 def make_depend(filename):
@@ -45,15 +45,20 @@ class Backend(object):
         self.context = ctxt 
         self.header = self._create_generator(ctxt["libheader"], ctxt, "include")
         self.source = self._create_generator(ctxt["libsrc"], ctxt, "src")
+        self.bench = self._create_generator(ctxt["benchsrc"], ctxt, "bench")
         
     def emit(self):
         """
         Generate library code
         """
         if self.error == False:
+            # the symbol table is emitted at the end of the source, so that
+            # it includes the symbols used by the header
+            self.header.render("header.h")
             self.source.render("source.cc")
             self.source.export()
-            self.header.render("header.h")
             self.header.export()
+            self.bench.render("bench.cc")
+            self.bench.export()
         
 
@@ -190,11 +190,28 @@ class FileSystem(Entity):
         self.root = root
         self.pointer_table = list()
         self.xrefs = list()
+        self.symbols = list()
+        self.symbol_ids = dict()
     
     @property
     def xrefname(self):
         return "%sXRef"%self.name
         
+    def symbol(self, text):
+        """
+        returns the expression for the symbol of a name or a type, which is 
+        added to the symbol table of the file system on first use. text will 
+        be emitted between double quotes
+        """
+        if text == "":
+            return "FS::SYM_EMPTY"
+        num = self.symbol_ids.get(text)
+        if num is None:
+            num = len(self.symbols)
+            self.symbol_ids[text] = num
+            self.symbols.append(text)
+        return "%s::symbol(%d)"%(self.name, num)
+        
     def add_pointer_type(self, pointer):
         """
         This method will add pointer to the list of pointers in the filesystem.
@@ -268,13 +285,123 @@ class FileSystem(Entity):
                             table.appendleft(child)
             self.object_table = list(table)
             self.forward_decl = list(forward)
-                
+
+    reachability_bits = 64
+
+    def _setup_reachability(self):
+        """
+        Computes the transitive closure of the type graph over the object
+        table. An object reaches its children (by pointer or inclusion) and
+        its derived classes, since a pointer to the base class may be parsed
+        as any of them depending on the 'when' guard. Pointers to an extent
+        carry the type id of its innermost container, so that container also
+        reaches the extent. Each row is a bitmap (in words of
+        reachability_bits) indexed by position in the object table.
+        """
+        index = dict((obj, i) for i, obj in enumerate(self.object_table))
+        edges = collections.defaultdict(set)
+        for obj in self.object_table:
+            for child in obj.children:
+                edges[obj].add(child)
+            for derived in getattr(obj, 'derived', []):
+                edges[obj].add(derived)
+            if obj.is_extent() and obj.container is not obj:
+                edges[obj.container].add(obj)
+
+        self.reachability = list()
+        self.reachability_words = \
+            (len(self.object_table) - 1) // FileSystem.reachability_bits + 1
+        for obj in self.object_table:
+            seen = set([ obj ])
+            stack = [ obj ]
+            while len(stack) > 0:
+                for child in edges[stack.pop()]:
+                    if child not in seen and child in index:
+                        seen.add(child)
+                        stack.append(child)
+            words = [ 0 ] * self.reachability_words
+            for child in seen:
+                word, bit = divmod(index[child], FileSystem.reachability_bits)
+                words[word] |= (1 << bit)
+            self.reachability.append((obj, [ "0x%xULL"%w for w in words ]))
+
+    def _setup_field_table(self):
+        """
+        Builds the (scope, field name, next scope) rows that let a path of
+        field names be checked against the type graph without reading the
+        file system. A scope is either an object of the object table (its
+        type id) or a nested struct or union of one (numbered after the last
+        type id). A field leads to its nested scope, to the object that it
+        embeds, or to the types that its pointers may fetch, including their
+        derived types. Leaves lead nowhere (-1). Containers and extents have
+        the fields of their elements, since that is what [*] visits.
+        """
+        # (entities compare by name, so they are told apart by id here)
+        typeids = set(id(obj) for obj in self.object_table)
+        nested = list()
+        nested_ids = dict()
+
+        def scope_of(entity):
+            if isinstance(entity, Nested):
+                if id(entity) not in nested_ids:
+                    nested_ids[id(entity)] = len(nested)
+                    nested.append(entity)
+                return "FS::NUM_GENERIC_IDS + %d"%(len(self.object_table) +
+                    nested_ids[id(entity)])
+            return "%s::%s"%(self.name, entity.typeid)
+
+        def targets(meta):
+            ret = [ meta ] if id(meta) in typeids else []
+            for derived in getattr(meta, 'derived', []):
+                ret.extend(targets(derived))
+            return ret
+
+        def fields_of(entity):
+            ret = list()
+            if getattr(entity, 'base', None) is not None:
+                ret.extend(fields_of(entity.base))
+            ret.extend(getattr(entity, 'fields', []))
+            element = getattr(entity, 'element', None)
+            if isinstance(element, Metadata):
+                ret.extend(fields_of(element))
+            return ret
+
+        def add_rows(scope, fields):
+            for field in fields:
+                if field.is_anonymous_union() or field.is_skip():
+                    continue
+                nexts = list()
+                if isinstance(field, Nested):
+                    nexts.append(scope_of(field))
+                else:
+                    if field.is_object():
+                        nexts.extend(map(scope_of, targets(field.type)))
+                    for ptr in field.pointers:
+                        if isinstance(ptr.target, Metadata):
+                            nexts.extend(map(scope_of, targets(ptr.target)))
+                seen = set()
+                for nxt in nexts or [ "-1" ]:
+                    if nxt not in seen:
+                        seen.add(nxt)
+                        self.field_table.append((scope, field.name, nxt))
+
+        self.field_table = list()
+        for obj in self.object_table:
+            add_rows(scope_of(obj), fields_of(obj))
+        # nested scopes are numbered as they are found, so this grows
+        i = 0
+        while i < len(nested):
+            add_rows(scope_of(nested[i]), nested[i].fields)
+            i += 1
+
     def setup(self):
         """
         calls all the private setup functions
         """
         self._setup_xrefs()
         self._setup_object_table()
+        self._setup_reachability()
+        self._setup_field_table()
 
     @property
     def type_table(self):
@@ -383,7 +510,34 @@ class Object(Metadata):
 
     def is_referenced(self):
         return (self.xref is not None)
-    
+
+    def is_raw_checkable(self):
+        """
+        whether the checks (and size) of this container can be evaluated
+        directly on the on-disk C struct, without parsing it into an object
+        """
+        if not self.is_container() or self.base is not None:
+            return False
+        if any(derived.when for derived in self.derived):
+            return False
+        exprs = [ check.expr for check in self.checks ]
+        if self.size is not None:
+            exprs.append(self.size)
+        fields = dict((field.name, field) for field in self.fields)
+        for expr in exprs:
+            if '$' in expr.raw:
+                return False
+            for name in Object.self_finder.findall(expr.raw):
+                field = fields.get(name)
+                if field is None or field.is_implicit():
+                    return False
+                if isinstance(field, Nested):
+                    continue
+                if not field.is_int() or field.is_big_endian():
+                    return False
+        return True
+    self_finder = re.compile(r"\bself\.([a-zA-Z_]\w*)")
+
     def debug(self):
         print("obj %s%s {"%(self.name, self.args_to_str("size")))
         for field in self.fields:
@@ -426,6 +580,13 @@ class Object(Metadata):
 
         return vars
 
+    @property
+    def external_vars(self):
+        """
+        variables (i.e. cross references) used by this object besides itself
+        """
+        return [ var for var in self.vars if var != 'self' ]
+
 class Super(Object):
     """
     Represents the super block, or the root of the file system tree
@@ -897,11 +1058,22 @@ class Check(object):
     def __init__(self, expr):
         self.expr = expr
     
+    @property
+    def vars(self):
+        return self.expr.vars
+    
+    @property
+    def text(self):
+        """
+        the check as written in the annotation, escaped for a C string
+        """
+        return repr(self.expr).replace('\\', '\\\\').replace('"', '\\"')
+    
     def __str__(self):
-        return self.expr
+        return str(self.expr)
         
     def __repr__(self):
-        return 'Check(%s)'%self.expr
+        return 'Check(%s)'%repr(self.expr)
 
         
 class Category(Entity):
@@ -586,6 +586,8 @@ def update_expression_all(objects, containers, enums, addrspaces, callback):
     for obj in objects:
             update_expression(callback, obj, C_EXPRESSIONS)
             update_expression_fields(callback, obj)
+            for check in obj.checks:
+                update_expression(callback, check, ['expr'])
 
 def convert_to_expression(exprs):
     """
@@ -82,7 +82,8 @@ def main():
     ctxt = dict(headers=headers, 
                 fs=fs, 
                 libheader="lib%s.h"%(options.name.lower()),
-                libsrc="lib%s.cpp"%(options.name.lower()))
+                libsrc="lib%s.cpp"%(options.name.lower()),
+                benchsrc="mb%s.cpp"%(options.name.lower()))
     backend = Backend(ctxt)
     backend.emit()
 
@@ -0,0 +1,38 @@
+/*
+ * @( benchsrc )
+ *
+ * @( fs.name ) microbenchmark types generated by jdc. Do NOT edit this file.
+ *
+ * Author: Kuei (Jack) Sun
+ * E-mail: kuei.sun@mail.utoronto.ca
+ *
+ * University of Toronto
+ * 2018
+ */
+
+#include <@(libheader)>
+#include "benchmark.h"
+
+@[ for obj in fs.object_table ]
+@[ if obj.is_vector_type() and obj.container.is_extent() ]
+// @( obj.typeid ): an extent cannot be parsed on its own
+@[ elif obj.is_vector_type() or obj == fs.root or obj.rank == "container" ]
+static FS::Container * factory_@( obj.typeid )(const FS::Location & loc, 
+    const FS::Path * path, const char * buf, unsigned len)
+{
+    return @( fs.name )::@( obj.container.classname )::factory(loc, path,
+        buf, len);
+}
+
+@[ endif ]
+@[ endfor ]
+const BNType bn_types[] = {
+@[ for obj in fs.object_table ]
+@[ if obj.is_vector_type() and obj.container.is_extent() ]
+@[ elif obj.is_vector_type() or obj == fs.root or obj.rank == "container" ]
+    { @( fs.name )::@( obj.typeid ), factory_@( obj.typeid ) },
+@[ endif ]
+@[ endfor ]
+};
+
+const unsigned bn_num_types = sizeof(bn_types) / sizeof(bn_types[0]);
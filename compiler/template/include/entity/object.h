@@ -1,3 +1,5 @@
+@[ from "macro/alloc.h" import alloc_declare ]
+
 class @(obj.classname) : @[ if obj.base ] public @(obj.base.classname) { 
 @[ elif obj.is_container() ] public FS::Container {
 @[ else ] public FS::Object {
@@ -12,17 +14,20 @@ protected:
     
 public: 
 @[if obj.is_container() ]
-    @(obj.classname)(const FS::Location & lc, const FS::Path * xr, int idx=0, const char * name="");
+    @(obj.classname)(const FS::Location & lc, const FS::Path * xr, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
     @(obj.classname)();
     
     static @(obj.classname) * factory(const FS::Location & lc, const FS::Path * xr, 
-        const char * buf, unsigned size, int idx=0, const char * name="");
+        const char * buf, unsigned size, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
+    static int validate(const FS::Location & lc, const FS::Path * xr, 
+        const char * buf, unsigned size, const char ** why=nullptr);
 @[ else ]
-    @(obj.classname)(FS::Container & p, const FS::Path * xr, int idx=0, const char * name="");
+    @(obj.classname)(FS::Container & p, const FS::Path * xr, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
     @(obj.classname)();
     static @(obj.classname) * factory(FS::Container & p, const FS::Path * xr, const char * buf,
-    unsigned size, int idx=0, const char * name="");
+    unsigned size, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
 @[ endif ]
+    @( alloc_declare() )
     @(obj.classname)(const @(obj.classname) & rhs) = delete;
     @(obj.classname)(@(obj.classname) && rhs) = delete;
     virtual ~@(obj.classname)() override;
@@ -42,6 +47,8 @@ public:
 
     virtual int accept_fields(FS::Visitor & visitor) override;
     virtual int accept_pointers(FS::Visitor & visitor) override;
+    virtual int accept_by_type(const std::vector<int> & types,
+        FS::Visitor & visitor) override;
 
     virtual FS::Entity * get_field_by_name(const char * name) override;
     
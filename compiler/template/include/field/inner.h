@@ -15,6 +15,9 @@ public:
 
     virtual int accept_fields(FS::Visitor & visitor) override;
     virtual int accept_pointers(FS::Visitor & visitor) override;
+    virtual int accept_by_type(const std::vector<int> & types,
+        FS::Visitor & visitor) override;
+    virtual FS::Entity * get_field_by_name(const char * name) override;
 
     /* resolves all pointer types post-parse */
     virtual void resolve(void) override;    
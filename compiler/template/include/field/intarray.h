@@ -3,8 +3,8 @@
 class @(field.classname) : public FS::Entity
 {
     struct Element : public @( integer_class(field) ) {
-        Element(@(field.object.classname) & s, int idx, const char * n="") : 
-        @( integer_class(field) )("@(field.type)", FS::TF_ELEMENT, n, idx)
+        Element(@(field.object.classname) & s, int idx, FS::symbol_t n=FS::SYM_EMPTY) : 
+        @( integer_class(field) )(@(fs.symbol(field.type)), FS::TF_ELEMENT, n, idx)
         { (void)s; }
     };
 
@@ -11,6 +11,8 @@ class @(field.classname) : public FS::Entity
     
     virtual int accept_fields(FS::Visitor & visitor) override;
     virtual int accept_pointers(FS::Visitor & visitor) override;
+    virtual int accept_by_type(const std::vector<int> & types,
+        FS::Visitor & visitor) override;
     
     virtual void resolve(void) override;
 
@@ -3,7 +3,7 @@ class @(field.classname) : public FS::Entity
     class Element : public FS::Buffer
     {
     public:
-        Element(@(field.object.classname) & s, int idx=0, const char * n="");
+        Element(@(field.object.classname) & s, int idx=0, FS::symbol_t n=FS::SYM_EMPTY);
         virtual int parse(const char * buf, unsigned size) override;    
         int serialize(FS::FileSystem * fs, char * buf, unsigned len, int options=0); 
     };
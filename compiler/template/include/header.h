@@ -49,8 +49,16 @@ public:
                                         unsigned len) const override;  
     virtual FS::Container * parse_by_type(int type, FS::Location & loc, 
         FS::Path * path, const char * buf, unsigned len) const override;
+    virtual int validate_by_type(int type, const FS::Location & loc, 
+        const FS::Path * path, const char * buf, unsigned len, 
+        const char ** why=nullptr) const override;
     virtual const char * type_to_name(unsigned type) const override;
     virtual const char * address_space_to_name(int aspc) const override;
+    virtual int name_to_type(const char * name) const override;
+    virtual int lookup_field(int scope, const char * name, 
+        std::vector<int> & next) const override;
+    virtual int name_to_constant(const char * name, long & value) const override;
+    virtual bool is_reachable(int from, int to) const override;
     virtual FS::Container * create_container(int type, FS::Path * path) const override;
 
     virtual int super_type_id() const override
@@ -58,6 +66,17 @@ public:
         return @( fs.root.typeid );
     }
 
+    // names and types of the entities, registered with libfs on first use
+    static const char * const symbols[];
+    static const unsigned num_symbols;
+    
+    static FS::symbol_t symbol(unsigned num)
+    {
+        static const FS::symbol_t base = FS::register_symbols(symbols, 
+            num_symbols);
+        return (FS::symbol_t)(base + num);
+    }
+
     @[ for obj in fs.enums ]
     struct @(obj.classname)
     {
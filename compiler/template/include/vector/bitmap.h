@@ -1,14 +1,17 @@
-class @(obj.classname) : public FS::Bitmap<FS::Container>
-{
-	@(obj.classname)(const FS::Location & lc, const FS::Path * p, int idx=0, 
-	    const char * name="");
-
-public:	
-    @(obj.classname)();
-    virtual ~@(obj.classname)() {}
-
-	static @(obj.classname) *
-    factory(const FS::Location & lc, const FS::Path * p, const char * buf, 
-        unsigned len, int idx=0, const char * name="");
-};
-
+@[ from "macro/alloc.h" import alloc_declare ]
+
+class @(obj.classname) : public FS::Bitmap<FS::Container>
+{
+	@(obj.classname)(const FS::Location & lc, const FS::Path * p, int idx=0, 
+	    FS::symbol_t name=FS::SYM_EMPTY);
+
+public:	
+    @( alloc_declare() )
+    @(obj.classname)();
+    virtual ~@(obj.classname)() {}
+
+	static @(obj.classname) *
+    factory(const FS::Location & lc, const FS::Path * p, const char * buf, 
+        unsigned len, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
+};
+
@@ -1,8 +1,11 @@
+@[ from "macro/alloc.h" import alloc_declare ]
+
 class @(obj.classname) : public FS::Data
 {
 public:
+    @( alloc_declare() )
     using Data::Data;
     static @(obj.classname) * factory(const FS::Location & lc, const FS::Path * p, 
-        const char * buf, unsigned len, int idx=0, const char * name="");
+        const char * buf, unsigned len, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
 };
 
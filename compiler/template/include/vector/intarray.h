@@ -1,20 +1,23 @@
 @[ from "macro/vector.h" import vector_class ]
 @[ from "macro/integer.h" import integer_class ]
+@[ from "macro/alloc.h" import alloc_declare ]
 
 struct @(obj.element.classname) : public @(integer_class(obj.element))
 {
+    @( alloc_declare() )
     @(obj.element.classname)(FS::Container & s, int idx=0) : 
-        @(integer_class(obj.element))("@(obj.element.type)", FS::TF_ELEMENT, 
+        @(integer_class(obj.element))(@(fs.symbol(obj.element.type)), FS::TF_ELEMENT, 
         "", idx) { (void)s; }
 };
     
 class @(obj.classname) : public @(vector_class(obj))
 {
 	@(obj.classname)(const FS::Location & lc, const FS::Path * xr, int idx=0,
-	    const char * name="");
+	    FS::symbol_t name=FS::SYM_EMPTY);
 public:
+    @( alloc_declare() )
 
 	static @(obj.classname) *
     factory(const FS::Location & lc, const FS::Path * xr, const char * buf, 
-        unsigned len, int idx=0, const char * name="");
+        unsigned len, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
 };
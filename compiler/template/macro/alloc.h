@@ -0,0 +1,15 @@
+@[ macro alloc_declare() ]
+    // objects of this class come from their own slab cache in the kernel
+    static FS::TypeCache type_cache;
+    static void * operator new(size_t size) noexcept { 
+        return type_cache.alloc(size); 
+    }
+    static void operator delete(void * ptr, size_t size) { 
+        type_cache.free(ptr, size); 
+    }
+@[ endmacro ]
+
+@[ macro alloc_define(fs, classname) ]
+FS::TypeCache @(fs.name)::@(classname)::type_cache("@(fs.name)_@(classname)", 
+    sizeof(@(fs.name)::@(classname)));
+@[ endmacro ]
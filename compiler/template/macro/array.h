@@ -17,7 +17,7 @@ public:
     virtual bool is_sentinel(@(field.type.classname) & self) const override;
     @[ endif ]
     
-    virtual @(field.type.classname) * create_element(int i, const char * n) override;
+    virtual @(field.type.classname) * create_element(int i, FS::symbol_t n) override;
     @(field.classname)(@(field.object.classname) & s, int idx=0);
 }
 @[ endmacro ]
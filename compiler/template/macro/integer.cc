@@ -2,17 +2,17 @@
 
 @[ macro generic_ctor(fs, field, cls) ]
 @(fs.name)::@(field.namespace)::@(field.classname)(
-    @(field.object.classname) & s, int index) : @(cls)("@(field.type)", 
+    @(field.object.classname) & s, int index) : @(cls)(@(fs.symbol(field.type)), 
     FS::TF_INTEGRAL @[ if flags ] | @(flags) @[ endif ]
     @[ if field.is_big_endian() ]     | FS::TF_BIGENDIAN @[ endif ]
     @[ if field.is_signed() ]         | FS::TF_SIGNED    @[ endif ]
     @[ if field.enum == "timestamp" ] | FS::TF_TIMESTAMP 
     @[ elif field.is_enum() ] @[ if field.category.type == "flag" ] | FS::TF_BITFIELD
     @[ else ] | FS::TF_ENUM @[ endif ] @[ endif ]
-@[ if field.is_implicit() ] | FS::TF_IMPLICIT, "@(field.name)", index)
+@[ if field.is_implicit() ] | FS::TF_IMPLICIT, @(fs.symbol(field.name)), index)
     , self(s) {} 
 @[ else ]
-    , "@(field.name)", index)
+    , @(fs.symbol(field.name)), index)
 {
     (void)s;
 }
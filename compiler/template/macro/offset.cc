@@ -7,7 +7,7 @@
 
 @(fs.name)::@(pointer_namespace(field, _classname))::@(_classname)
 (@(field.object.classname) & s, int idx)
-    : @( offset_class(field) )(s.get_path(), "@(field.type)", FS::TF_OFFSET, "@(field.name)", idx)
+    : @( offset_class(field) )(s.get_path(), @(fs.symbol(field.type)), FS::TF_OFFSET, @(fs.symbol(field.name)), idx)
     , self(s) {}
 
 @[ endmacro ]
@@ -13,9 +13,9 @@
 @[ macro pointer_ctor(fs, field, _classname) ]
 
 @(fs.name)::@(pointer_namespace(field, _classname))::@(_classname)
-(@(field.object.classname) & s, int idx, const char * n)
-    : @( intptr_class(field) )("@(field.type)", 0, 
-    @[ if field.name|length > 0 ]"@(field.name)" @[ else ] n @[ endif ], idx)
+(@(field.object.classname) & s, int idx, FS::symbol_t n)
+    : @( intptr_class(field) )(@(fs.symbol(field.type)), 0, 
+    @[ if field.name|length > 0 ]@(fs.symbol(field.name)) @[ else ] n @[ endif ], idx)
     , self(s)
 { (void)n; }
 
@@ -72,7 +72,7 @@ void @(fs.name)::@(pointer_namespace(field, _classname))::resolve()
         location.aspc = @(pointer.addrspace.enumname);    
           
         /* for type object */
-        set_type("@(pointer.type) *");
+        set_type(@(fs.symbol(pointer.type ~ " *")));
         @[ if field.is_implicit() ]
         set_flags(FS::TF_IMPLICIT);
         @[ endif ]
@@ -2,7 +2,8 @@
     @(field.object.classname) & self;
 
 public:
-    @(_classname)(@(field.object.classname) & s, int idx=0, const char * n="");
+    @(_classname)(@(field.object.classname) & s, int idx=0, FS::symbol_t n=FS::SYM_EMPTY);
+    virtual FS::Path * get_path() const override { return self.get_path(); }
 @[ endmacro ]
 
 @[ macro pointer_resolve(fs, field, _classname) ]
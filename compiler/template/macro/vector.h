@@ -1,3 +1,5 @@
+@[ from "macro/alloc.h" import alloc_declare ]
+
 @[ macro vector_class(obj) ]
 FS::Vector<@(obj.element.classname), @(obj.element.typename)>
 @[ endmacro ]
@@ -11,9 +13,10 @@ public:
     virtual bool is_sentinel(@(obj.element.classname) & self) const override;
     @[ endif ]
     
+    @( alloc_declare() )
     @(obj.classname)();
-    @(obj.classname)(const FS::Location & lc, const FS::Path * xr, int idx=0, const char * name="");
+    @(obj.classname)(const FS::Location & lc, const FS::Path * xr, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
     static @(obj.classname) * factory(const FS::Location & lc, const FS::Path * xr, 
-        const char * buf, unsigned len, int idx=0, const char * name="");
+        const char * buf, unsigned len, int idx=0, FS::symbol_t name=FS::SYM_EMPTY);
 }
 @[ endmacro ]
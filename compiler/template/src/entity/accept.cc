@@ -29,6 +29,28 @@ int @(fs.name)::@(obj.classname)::accept_pointers(FS::Visitor & visitor)
     return ret;
 }
 
+int @(fs.name)::@(obj.classname)::accept_by_type(const std::vector<int> & types,
+    FS::Visitor & visitor)
+{
+    int ret = 0;
+    
+    @[ if obj.base ]
+    if ( (ret = @(obj.base.classname)::accept_by_type(types, visitor) ) != 0 )
+        return ret;
+    @[ endif ]
+    
+    @[ for field in obj.fields ]
+    @[ if field.is_object() or field.is_aggregate() or field.pointers|length > 0 ]
+    /* pointers prune themselves if they cannot reach any of the types */
+    if ( (ret = @(field.name).accept_by_type(types, visitor) ) != 0 )
+        return ret;
+    @[ endif ]
+    @[ endfor ]
+    
+    (void)types; (void)visitor;
+    return ret;
+}
+
 int @(fs.name)::@(obj.classname)::accept_fields(FS::Visitor & visitor)
 {
     int ret = 0;
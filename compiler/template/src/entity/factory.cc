@@ -1,7 +1,7 @@
 @[ if obj.is_extent() ]
 
 @(fs.name)::@(obj.classname) * @(fs.name)::@(obj.classname)::factory(
-    const FS::Location & lc, const FS::Path * xr, int idx, const char * name)
+    const FS::Location & lc, const FS::Path * xr, int idx, FS::symbol_t name)
 {
     @(obj.classname) * inst = new @(obj.classname)(lc, xr, idx, name);
     
@@ -19,7 +19,7 @@
 
 @(fs.name)::@(obj.classname) * @(fs.name)::@(obj.classname)::factory(
     const FS::Location & lc, const FS::Path * xr, const char * buf, unsigned size, 
-    int idx, const char * name)
+    int idx, FS::symbol_t name)
 {
     @(obj.classname) * tmp;
 
@@ -49,7 +49,7 @@
 
 @(fs.name)::@(obj.classname) * @(fs.name)::@(obj.classname)::factory(
     FS::Container & p, const FS::Path * xr, const char * buf, unsigned size, int idx,
-    const char * name)
+    FS::symbol_t name)
 {
     @(obj.classname) * tmp;
 
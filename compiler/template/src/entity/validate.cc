@@ -0,0 +1,51 @@
+@[ from "macro/path_test.cc" import set_path ]
+
+int @(fs.name)::@(obj.classname)::validate(const FS::Location & lc,
+    const FS::Path * xr, const char * buf, unsigned size, const char ** why)
+{
+@[ if obj.is_raw_checkable() ]
+    /* fast path: evaluate checks directly on the on-disk structure */
+    if ( (int)size < (int)sizeof(@(obj.typename)) ) {
+        if (why != nullptr) *why = "buffer too small";
+        return FS::ERR_BUF2SM;
+    }
+
+    const @(obj.typename) & self =
+        *reinterpret_cast<const @(obj.typename) *>(buf);
+    (void)self;
+    (void)lc;
+
+    @[ if obj.external_vars ]
+    @(set_path(fs, "const_cast<FS::Path *>(xr)", "FS::ERR_UNINIT", obj))
+    (void)path;
+    @[ endif ]
+
+    @[ if obj.size ]
+    if ( (unsigned)(@( obj.size )) > size ) {
+        if (why != nullptr) *why = "buffer too small";
+        return FS::ERR_BUF2SM;
+    }
+    @[ endif ]
+
+    @[ for check in obj.checks ]
+    if (!( @(check) )) {
+        if (why != nullptr) *why = "@(check.text)";
+        return FS::ERR_CORRUPT;
+    }
+    @[ endfor ]
+
+    return 0;
+@[ else ]
+    /* checks depend on parsed fields (or on polymorphism), so a full parse
+     * is needed to evaluate them. pointers are not followed */
+    @(obj.classname) * tmp = factory(lc, xr, buf, size);
+
+    if (tmp == nullptr) {
+        if (why != nullptr) *why = "parse failed";
+        return FS::ERR_CORRUPT;
+    }
+
+    tmp->destroy();
+    return 0;
+@[ endif ]
+}
@@ -31,7 +31,7 @@ int @(fs.name)::@(field.namespace)::parse(const char * buf, unsigned len)
 #error "we do not currently support 3-dimensional arrays (or higher)"
 @[ endif ]
         {
-            element.emplace_back(self, i, get_name());
+            element.emplace_back(self, i, get_name_symbol());
             Element & elem = element.back();
             int byte_parsed = elem.parse(buf, len);
             if (byte_parsed <= 0) return byte_parsed;
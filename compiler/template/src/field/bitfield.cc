@@ -9,7 +9,7 @@ int @(fs.name)::@(field.namespace)::accept_fields(FS::Visitor & visitor)
     int ret = 0;
 
     @[ for element in field.category.elements ]
-    bit = FS::Bit(@(element.name) & val, "@(element.name)");
+    bit = FS::Bit(@(element.name) & val, @(fs.symbol(element.name)));
     if( (ret = visitor.visit(bit)) != 0 )
         return ret;
     @[ endfor ]
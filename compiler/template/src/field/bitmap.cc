@@ -1,8 +1,8 @@
 @[ from "macro/path_test.cc" import set_path ]
 
 @(fs.name)::@(field.namespace)::@(field.classname)(@(field.object.classname) & s, 
-    int index, const char * n) : FS::Bitmap<FS::Entity>("bitmap", 
-    FS::TF_ARRAY, "@(field.name)", index), self(s)
+    int index, FS::symbol_t n) : FS::Bitmap<FS::Entity>(@(fs.symbol("bitmap")), 
+    FS::TF_ARRAY, @(fs.symbol(field.name)), index), self(s)
 {
     (void)n;
 }
@@ -1,7 +1,7 @@
 @(fs.name)::@(field.namespace)::@(field.classname)(
     @(field.object.classname) & s, int index) : 
-    Buffer("@(field.type) []", FS::TF_CSTRING
-    , "@(field.name)", index), self(s)
+    Buffer(@(fs.symbol(field.type ~ " []")), FS::TF_CSTRING
+    , @(fs.symbol(field.name)), index), self(s)
 {
 }
 
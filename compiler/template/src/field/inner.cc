@@ -1,6 +1,6 @@
 @(fs.name)::@(field.namespace)::@(field.classname)(
     @(field.object.classname) & s, int index) : 
-    Entity("@(field.type)", FS::TF_STRUCT, "@(field.name)", index)
+    Entity(@(fs.symbol(field.type)), FS::TF_STRUCT, @(fs.symbol(field.name)), index)
     @[ for child in field.fields ]
     , @(child.name)(s)
     @[ endfor ]    
@@ -37,6 +37,47 @@ int @(fs.name)::@(field.namespace)::accept_pointers(FS::Visitor & visitor)
     return ret;         
 }
 
+int @(fs.name)::@(field.namespace)::accept_by_type(const std::vector<int> & types,
+    FS::Visitor & visitor)
+{
+    int ret = 0;
+    (void)types; (void)visitor;
+    @[ for child in field.fields ]
+    @[ if child.is_object() or child.is_aggregate() ]
+    if ( (ret = @(child.name).accept_by_type(types, visitor) ) < 0 )
+        return ret;
+    @[ elif child.pointers|length > 0 ]
+    @[ if child.size > 1 ]
+    if ( (ret = @(child.name).accept_by_type(types, visitor) ) < 0 )
+        return ret;
+    @[ elif child.pointers[0].repr != "offset" ]
+    if ( (ret = @(child.name).accept_by_type(types, visitor)) < 0 )
+        return ret;
+    @[ endif ]
+    @[ endif ]
+    @[ endfor ]
+    return ret;         
+}
+
+FS::Entity * @(fs.name)::@(field.namespace)::get_field_by_name(const char * name)
+{
+    FS::Entity * ret = nullptr;
+
+    @[ for child in field.fields ]
+    @[ if child.is_anonymous_union() or child.is_skip() ]
+    /* TODO: get anonymous union fields (currently not available) */
+    @[ else ]
+    if ( strcmp(name, "@(child.name)") == 0 ) {
+        ret = &this->@(child.name);
+    }
+    else
+    @[ endif ]
+    @[ endfor ]
+    { /* else return nothing */ }
+    
+    return ret;
+}
+
 /* TODO: this is the exact same code as src/obj/parse.cc's resolve() */
 void @(fs.name)::@(field.namespace)::resolve(void)
 {
@@ -1,6 +1,6 @@
 @(fs.name)::@(field.namespace)::@(field.classname)(
     @(field.object.classname) & s, int index) : 
-    Entity("@(field.type) []", FS::TF_ARRAY, "@(field.name)", index), self(s)  
+    Entity(@(fs.symbol(field.type ~ " []")), FS::TF_ARRAY, @(fs.symbol(field.name)), index), self(s)  
 {
 /* TODO: array elements should be filled here IF size is known */
 }
@@ -8,12 +8,12 @@ bool @(fs.name)::@(field.namespace)::is_sentinel(@(field.type.classname) & self)
 @[ endif ]
      
 @(fs.name)::@(field.namespace)::@(field.classname)(@(field.object.classname) & s, int idx) 
-    : @(array_class(field))("@(field.type) []", FS::TF_ARRAY, "@(field.name)", idx)
+    : @(array_class(field))(@(fs.symbol(field.type ~ " []")), FS::TF_ARRAY, @(fs.symbol(field.name)), idx)
     , self(s)   
 {}
 
 @(fs.name)::@(field.type.classname) *
-@(fs.name)::@(field.namespace)::create_element(int idx, const char * name)
+@(fs.name)::@(field.namespace)::create_element(int idx, FS::symbol_t name)
 {
     return new @(field.type.classname)(self.get_parent(), self.get_path(), idx, name);
 }
@@ -5,7 +5,7 @@
 @[ include "field/array/index.cc" with context ]    
 
 @(fs.name)::@(field.namespace)::@(field.classname)(@(field.object.classname) & s, int idx)
-    : FS::Entity("@(field.type) []", FS::TF_ARRAY, "@(field.name)", idx)
+    : FS::Entity(@(fs.symbol(field.type ~ " []")), FS::TF_ARRAY, @(fs.symbol(field.name)), idx)
     , self(s) 
 {}
 
@@ -27,6 +27,21 @@ int @(fs.name)::@(field.namespace)::accept_pointers(FS::Visitor & visitor)
     return ret;
 }
 
+int @(fs.name)::@(field.namespace)::accept_by_type(const std::vector<int> & types,
+    FS::Visitor & visitor)
+{
+    std::vector<Element>::iterator it = element.begin();
+    int ret = 0;
+    
+    for ( ; it != element.end(); ++it )
+    {
+        if ( (ret = it->accept_by_type(types, visitor)) != 0 )
+            break;
+    }
+    
+    return ret;
+}
+
 @[ include "field/array/resolve.cc" with context ]
 
 @[ include "entity/entity_compare.cc" with context ]
@@ -1,8 +1,8 @@
 @[ from "macro/bytearray.cc" import bytearray_parse, bytearray_serialize ]
 
 @(fs.name)::@(field.namespace)::Element::Element(
-    @(field.object.classname) & s, int idx, const char * n) 
-    : FS::Buffer("@(field.type) [" stringify(@(field.size[1])) "]", 
+    @(field.object.classname) & s, int idx, FS::symbol_t n) 
+    : FS::Buffer(@(fs.symbol(field.type ~ ' [" stringify(' ~ field.size[1] ~ ') "]')), 
       FS::TF_CSTRING | FS::TF_ELEMENT, n, idx)
 {
     (void)s;
@@ -24,8 +24,8 @@ int
 
 @(fs.name)::@(field.namespace)::@(field.classname)(
     @(field.object.classname) & s, int index) : 
-    FS::Entity("@(field.type) [][" stringify(@(field.size[1])) "]", FS::TF_ARRAY
-    , "@(field.name)", index), self(s)   
+    FS::Entity(@(fs.symbol(field.type ~ ' [][" stringify(' ~ field.size[1] ~ ') "]')), FS::TF_ARRAY
+    , @(fs.symbol(field.name)), index), self(s)   
 {
     /* TODO: array elements should be filled here IF size is known */
 }
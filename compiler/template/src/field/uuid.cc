@@ -2,7 +2,7 @@
 
 @(fs.name)::@(field.namespace)::@(field.classname)(
     @(field.object.classname) & s, int index) : 
-    Buffer("@(field.type) []", FS::TF_UUID, "@(field.name)", index), self(s)
+    Buffer(@(fs.symbol(field.type ~ " []")), FS::TF_UUID, @(fs.symbol(field.name)), index), self(s)
 {
 }
 
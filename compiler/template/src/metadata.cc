@@ -1,3 +1,4 @@
+@[ from "macro/alloc.h" import alloc_define ]
 @[ if obj.is_vector_type() ]
     @[ include "vector.cc" with context ]
 @[ else ]
@@ -15,4 +16,14 @@
     @[ endfor ]
 @[ endif ]
 @[ include "entity/factory.cc" with context ]
+@[ if not obj.is_vector_type() and obj.is_container() ]
+@[ include "entity/validate.cc" with context ]
+@[ endif ]
 
+@[ if obj.is_vector_type() or not obj.is_extent() ]
+@( alloc_define(fs, obj.classname) )
+@[ endif ]
+@[ if obj.is_vector_type() and obj.element.is_integral() and 
+      obj.element.type not in ("bitmap", "data") and not obj.is_extent() ]
+@( alloc_define(fs, obj.element.classname) )
+@[ endif ]
@@ -54,6 +54,41 @@ FS::Container * @(fs.name)::parse_by_type(int type, FS::Location & loc,
     return ret;
 }
 
+int @(fs.name)::validate_by_type(int type, const FS::Location & loc, 
+    const FS::Path * path, const char * buf, unsigned len, const char ** why) const
+{
+    int ret = FS::ERR_UNIMP;
+    FS::Container * tmp = nullptr;
+    
+    switch ( type )
+    {
+@[ for obj in fs.object_table ]
+@[ if obj.is_vector_type() and not obj.container.is_extent() ]
+    case @( obj.typeid ):
+        if (buf == nullptr) { ret = 0; break; }
+        /* vectors have no checks of their own, but their elements might */
+        tmp = @(obj.container.classname)::factory(loc, path, buf, len);
+        ret = (tmp == nullptr) ? FS::ERR_CORRUPT : 0;
+        if (tmp != nullptr)
+            tmp->destroy();
+        else if (why != nullptr)
+            *why = "parse failed";
+        break;
+@[ elif not obj.is_vector_type() and obj.rank == "container" ]
+    case @( obj.typeid ):
+        if (buf == nullptr) { ret = 0; break; }
+        ret = @(obj.container.classname)::validate(loc, path, buf, len, why);
+        break;
+@[ endif ]
+@[ endfor ]
+    default:
+        break;
+    }
+    
+    (void)tmp;
+    return ret;
+}
+
 const char * @(fs.name)::type_to_name(unsigned type) const
 {
     const char * ret = FS::FileSystem::type_to_name(type);
@@ -98,6 +133,84 @@ const char * @(fs.name)::address_space_to_name(int aspc) const
     return ret;
 }
 
+/* scope, field name and the scope that the field leads to (-1 if none). 
+ * scopes are type ids, or numbered after them for nested structs and unions */
+static const struct {
+    int scope;
+    const char * name;
+    int next;
+} field_table[] = {
+@[ for scope, name, next in fs.field_table ]
+    { @(scope), "@(name)", @(next) },
+@[ endfor ]
+};
+
+int @(fs.name)::lookup_field(int scope, const char * name, 
+    std::vector<int> & next) const
+{
+    const unsigned num_rows = sizeof(field_table)/sizeof(field_table[0]);
+    int ret = -ENOENT;
+
+    for ( unsigned i = 0; i < num_rows; i++ ) {
+        if ( field_table[i].scope != scope || 
+             strcmp(field_table[i].name, name) != 0 )
+            continue;
+        if ( field_table[i].next >= 0 )
+            next.push_back(field_table[i].next);
+        ret = 0;
+    }
+
+    return ret;
+}
+
+int @(fs.name)::name_to_type(const char * name) const
+{
+@[ for obj in fs.object_table ]
+    if ( strcmp(name, "@( obj.typeid )") == 0 )
+        return @( obj.typeid );
+@[ endfor ]
+
+    return -ENOENT;
+}
+
+int @(fs.name)::name_to_constant(const char * name, long & value) const
+{
+@[ for obj in fs.enums ]
+@[ for enu in obj.elements ]
+    if ( strcmp(name, "@(enu.name)") == 0 ) {
+        value = (long)(@(enu.name));
+        return 0;
+    }
+@[ endfor ]
+@[ endfor ]
+    
+    (void)value;
+    return -ENOENT;
+}
+
+/* row is the 'from' type, bit is the 'to' type, both offset by the first
+ * metadata id. computed by jdc as the closure over pointers, inclusion and
+ * derived types (regardless of 'when' guards) */
+static const u64 reachability[][@(fs.reachability_words)] = {
+@[ for obj, words in fs.reachability ]
+    { @(words|join(", ")) }, // @(obj.typeid)
+@[ endfor ]
+};
+
+bool @(fs.name)::is_reachable(int from, int to) const
+{
+    const int bits = (int)sizeof(reachability[0][0]) * 8;
+    const int num_types = (int)(sizeof(reachability)/sizeof(reachability[0]));
+
+    from -= FS::NUM_GENERIC_IDS;
+    to -= FS::NUM_GENERIC_IDS;
+
+    if ( from < 0 || from >= num_types || to < 0 || to >= num_types )
+        return false;
+
+    return (reachability[from][to / bits] >> (to % bits)) & 1;
+}
+
 @[ with super = fs.root ]
 
 FS::Container * 
@@ -221,4 +334,14 @@ const char * @(fs.name)::@(obj.classname)::enum_to_name(unsigned long val)
     @[ endfor ]    
 }
 
+/* must come last, since every template before it may add a symbol */
+const char * const @(fs.name)::symbols[] = {
+@[ for text in fs.symbols ]
+    "@(text)",
+@[ endfor ]
+};
+
+const unsigned @(fs.name)::num_symbols = sizeof(symbols) / sizeof(symbols[0]);
 
+static_assert(sizeof(@(fs.name)::symbols) / sizeof(@(fs.name)::symbols[0]) 
+    <= FS::MAX_SYMBOLS, "too many symbols for one table");
@@ -1,7 +1,7 @@
 @(fs.name)::@(obj.classname)::@(obj.classname)(const FS::Location & lc, 
-    const FS::Path * p, int idx, const char * name) : FS::Bitmap<FS::Container>(
-    lc, nullptr, "@(obj.typename)", FS::TF_ARRAY, name, idx) { (void)p; }
+    const FS::Path * p, int idx, FS::symbol_t name) : FS::Bitmap<FS::Container>(
+    lc, nullptr, @(fs.symbol(obj.typename)), FS::TF_ARRAY, name, idx) { (void)p; }
 
 @(fs.name)::@(obj.classname)::@(obj.classname)() : FS::Bitmap<FS::Container>(
-    nullptr, "@(obj.typename)", FS::TF_ARRAY) {}
+    nullptr, @(fs.symbol(obj.typename)), FS::TF_ARRAY) {}
 	
@@ -1,12 +1,12 @@
 @[ from "macro/vector.h" import vector_class ]
 
 @(fs.name)::@(obj.classname)::@(obj.classname)(const FS::Location & lc, 
-    const FS::Path * xr, int idx, const char * name) 
-    : @(vector_class(obj))(lc, const_cast<FS::Path*>(xr), "@(obj.typename)",
+    const FS::Path * xr, int idx, FS::symbol_t name) 
+    : @(vector_class(obj))(lc, const_cast<FS::Path*>(xr), @(fs.symbol(obj.typename)),
         FS::TF_ARRAY, name, idx) {}
 
 @(fs.name)::@(obj.classname)::@(obj.classname)() 
-    : @(vector_class(obj))(nullptr, "@(obj.typename)", FS::TF_ARRAY) {}
+    : @(vector_class(obj))(nullptr, @(fs.symbol(obj.typename)), FS::TF_ARRAY) {}
 
 @[ if obj.sentinel ]
 bool @(fs.name)::@(obj.classname)::is_sentinel(@(obj.element.classname) & self) const
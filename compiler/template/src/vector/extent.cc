@@ -1,6 +1,6 @@
 @(fs.name)::@(obj.classname)::@(obj.classname)(const FS::Location & lc, 
-    const FS::Path * xr, int idx, const char * name) 
-    : FS::Extent<@(obj.element.classname)>(lc, &camino, "@(obj.typename)", 
+    const FS::Path * xr, int idx, FS::symbol_t name) 
+    : FS::Extent<@(obj.element.classname)>(lc, &camino, @(fs.symbol(obj.typename)), 
         FS::TF_ARRAY, name, idx), camino(xr)
 {}        
 
@@ -23,8 +23,7 @@ int @(fs.name)::@(obj.classname)::initialize(void)
     
     for (int i = 0; i < count; i++) {
         element.emplace_back(nullptr);
-        element_loc.emplace_back(location.aspc, element_size, offset,
-            location.addr);
+        element_loc.emplace_back(location, element_size, offset);
         offset += element_size;
     }
     
@@ -46,6 +45,12 @@ int @(fs.name)::@(obj.classname)::initialize(void)
 @[ if obj.is_nested() ]
     return @(obj.element.classname)::factory(lc, &camino, idx);
 @[ else ]
+    FS::FileSystem * filsys = camino.get_file_system();
+    const char * bytes;
+    
+    if (filsys != nullptr && (bytes = read_window(filsys, lc)) != nullptr)
+        return @(obj.element.classname)::factory(lc, &camino, bytes, lc.size, idx);
+
     @( container_fetch(fs, obj.element.classname, "lc", "&camino", "idx") );
 @[ endif ]    
 }
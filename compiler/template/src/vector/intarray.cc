@@ -1,7 +1,7 @@
 @[ from "macro/vector.h" import vector_class ]
 
 @(fs.name)::@(obj.classname)::@(obj.classname)(
-    const FS::Location & lc, const FS::Path * xr, int idx, const char * name)
-	: @(vector_class(obj))(lc, nullptr, "@(obj.typename)", FS::TF_ARRAY, 
+    const FS::Location & lc, const FS::Path * xr, int idx, FS::symbol_t name)
+	: @(vector_class(obj))(lc, nullptr, @(fs.symbol(obj.typename)), FS::TF_ARRAY, 
 	                       name, idx) { (void)xr; }
 
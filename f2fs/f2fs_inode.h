@@ -46,6 +46,9 @@ FSCONST(type=flag) f2fs_inline_flag {
     F2FS_INLINE_DOTS   = 0x10,	/* file having implicit dot dentries */
 };
 
+/* mask of the file type bits of i_mode, whose values are not single bits */
+#define F2FS_S_IFMT 0xF000
+
 /* this type should be shared between VFS file systems */
 FSCONST(type=flag) f2fs_inode_mode {
     F2FS_S_IFSOCK = 0xC000,	/* socket */
@@ -150,21 +153,20 @@ FSSTRUCT(/* name=in */) f2fs_inode {
 	struct f2fs_extent i_ext;	/* caching a largest extent */
 
     /* Context Sensitive Pointers to Data vs. Directory Blocks*/
-    POINTER(repr=block, type=f2fs_data_block, when=self.i_mode & F2FS_S_IFREG)
-    POINTER(repr=block, type=struct f2fs_dentry_block, when=self.i_mode & F2FS_S_IFDIR)
+    POINTER(repr=block, type=f2fs_data_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFREG)
+    POINTER(repr=block, type=struct f2fs_dentry_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFDIR)
 	__le32 i_addr[DEF_ADDRS_PER_INODE];	/* Pointers to data blocks */
 
-    /* (jsun) (jchu) TODO: restore once nid address space is working again */ 
-    //POINTER(repr=nid, type=data_direct_node_block, when=((self.i_mode & S_IFMT) == S_IFREG))
-    //POINTER(repr=nid, type=dentry_direct_node_block, when=(self.i_mode & S_IFMT) == S_IFDIR)
+    POINTER(repr=nid, type=data_direct_node_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFREG)
+    POINTER(repr=nid, type=dentry_direct_node_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFDIR)
 	__le32 nid_direct[2];
 
-    //POINTER(repr=nid, type=data_indirect_node_block, when=(self.i_mode & S_IFMT) == S_IFREG)
-    //POINTER(repr=nid, type=dentry_indirect_node_block, when=(self.i_mode & S_IFMT) == S_IFDIR)
+    POINTER(repr=nid, type=data_indirect_node_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFREG)
+    POINTER(repr=nid, type=dentry_indirect_node_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFDIR)
 	__le32 nid_indirect[2];
 
-    //POINTER(repr=nid, type=data_dindirect_node_block, when=(self.i_mode & S_IFMT) == S_IFREG)
-    //POINTER(repr=nid, type=dentry_dindirect_node_block, when=(self.i_mode & S_IFMT) == S_IFDIR)
+    POINTER(repr=nid, type=data_dindirect_node_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFREG)
+    POINTER(repr=nid, type=dentry_dindirect_node_block, when=(self.i_mode & F2FS_S_IFMT) == F2FS_S_IFDIR)
 	__le32 nid_dindirect;
 
 } __attribute__((packed));
@@ -220,7 +222,6 @@ typedef FSSTRUCT(base=f2fs_block, when=(self.footer.ino == self.footer.nid) && (
  * of the NAT table.
  */
 
-/*
 typedef FSSTRUCT(rank=container, size=BLOCK_SIZE) {
     POINTER(repr=block, type=f2fs_data_block)
 	__le32 addr[ADDRS_PER_BLOCK];	
@@ -242,6 +243,7 @@ typedef FSSTRUCT(rank=container, size=BLOCK_SIZE) {
 typedef FSSTRUCT(rank=container, size=BLOCK_SIZE) {
     POINTER(repr=nid, type=dentry_direct_node_block)
 	__le32 nid[NIDS_PER_BLOCK];	
+    struct node_footer footer;
 } dentry_indirect_node_block;
 
 typedef FSSTRUCT(rank=container, size=BLOCK_SIZE) {
@@ -255,6 +257,5 @@ typedef FSSTRUCT(rank=container, size=BLOCK_SIZE) {
 	__le32 nid[NIDS_PER_BLOCK];
     struct node_footer footer;
 } dentry_dindirect_node_block;
-*/
 
 #endif /* F2FS_INODE_H */
@@ -25,7 +25,7 @@
 
 ADDRSPACE(name=block, null=0);
 //ADDRSPACE(name=logical, size=1 << sb.log_blocksize, null=-1);
-//ADDRSPACE(name=nid, size=1 << sb.log_blocksize, null=-1);
+ADDRSPACE(name=nid, size=1 << sb.log_blocksize, null=0);
 
 /* (jsun): this expression uses "self", which is only usable within the
  * superblock itself */
@@ -20,6 +20,11 @@
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #endif
 
@@ -74,8 +79,47 @@ namespace FS
         virtual ~Serializer() {}
     };
     
+    /* pool of small blocks in size classes, kept in per-thread free lists.
+     * used for short-lived buffers such as dynamic addresses. kernel builds
+     * simply use kmalloc, which already does the same */
+    void * pool_alloc(size_t size);
+    void pool_free(void * ptr, size_t size);
+
+    /* backs operator new/delete of a generated metadata class. in kernel
+     * builds each class gets its own slab cache, created on first use, and
+     * all of them are released by destroy_all() (e.g. on module exit, after
+     * every container is destroyed). in userspace it is the size-class pool
+     */
+    class TypeCache
+    {
+        const char *        name;
+        size_t              size;
+        struct kmem_cache * cache;      /* or a marker once creation failed */
+        TypeCache *         next;
+
+        static TypeCache *  all;
+        
+        struct kmem_cache * get_cache();
+    
+    public:
+        constexpr TypeCache(const char * n, size_t sz) : name(n), size(sz),
+            cache(nullptr), next(nullptr) {}
+            
+        void * alloc(size_t sz);
+        void free(void * ptr, size_t sz);
+        
+        static void destroy_all();
+    };
+    
+    /* a number (e.g. a block number) is kept in addr. an address that is 
+     * not one (e.g. a btrfs key) is kept as bytes, inline if it fits or in
+     * the pool if not, and dynamic is non-zero. copies are deep, and moves 
+     * take over the pool buffer, so a location never shares its bytes */
     struct Location
     {
+        enum { ADDR_NUMBER, ADDR_INLINE, ADDR_POOL };
+        enum { INLINE_ADDR_SIZE = 24 };
+        
         int aspc;
         unsigned size;
         unsigned offset;
@@ -84,6 +128,7 @@ namespace FS
         union {
             unsigned long addr;
             char * addrptr;
+            char addrbuf[INLINE_ADDR_SIZE];
         };
         
         template<typename T>
@@ -91,12 +136,9 @@ namespace FS
        
         template<typename T>
         void set_address(T val, unsigned len=sizeof(T)) {
-            if (dynamic)
-                delete this->addrptr;
-        
+            release_address();
             this->len = len;
             this->addr = (unsigned long)val;
-            this->dynamic = 0;
         }
         
         Location() : aspc(0), size(0), offset(0), dynamic(0), len(0), 
@@ -104,10 +146,58 @@ namespace FS
         Location(int as, unsigned s, unsigned o, unsigned long ad) :
             aspc(as), size(s), offset(o), dynamic(0), len(sizeof(char *)), 
             addr(ad) {}
+        /* same address as base, e.g. for an element of an extent */
+        Location(const Location & base, unsigned s, unsigned o) :
+            aspc(base.aspc), size(s), offset(o), dynamic(0), len(0), addr(0)
+            { copy_address(base); }
+        Location(const Location & rhs) : aspc(rhs.aspc), size(rhs.size),
+            offset(rhs.offset), dynamic(0), len(0), addr(0)
+            { copy_address(rhs); }
+        Location(Location && rhs) noexcept : aspc(rhs.aspc), size(rhs.size), 
+            offset(rhs.offset), dynamic(0), len(0), addr(0)
+            { move_address(rhs); }
+        
+        Location & operator=(const Location & rhs) {
+            if (this != &rhs) {
+                aspc = rhs.aspc;
+                size = rhs.size;
+                offset = rhs.offset;
+                copy_address(rhs);
+            }
+            return *this;
+        }
+        
+        Location & operator=(Location && rhs) noexcept {
+            if (this != &rhs) {
+                aspc = rhs.aspc;
+                size = rhs.size;
+                offset = rhs.offset;
+                move_address(rhs);
+            }
+            return *this;
+        }
+        
+        ~Location() { release_address(); }
+        
+    private:
+        void release_address() {
+            if (this->dynamic == ADDR_POOL)
+                pool_free(this->addrptr, this->len);
+            this->dynamic = ADDR_NUMBER;
+        }
+        
+        void copy_address(const Location & rhs);
         
-        ~Location() {
-            if (this->dynamic)
-                delete this->addrptr;
+        void move_address(Location & rhs) {
+            release_address();
+            this->dynamic = rhs.dynamic;
+            this->len = rhs.len;
+            if (rhs.dynamic == ADDR_INLINE)
+                memcpy(this->addrbuf, rhs.addrbuf, rhs.len);
+            else
+                this->addr = rhs.addr;
+            rhs.dynamic = ADDR_NUMBER;
+            rhs.addr = 0;
         }
     };
     
@@ -156,6 +246,7 @@ namespace FS
     class Container;
     class Object;
     class Pointer;
+    class WriteBatch;
     
     class Nominal {
         const char * name;
@@ -168,29 +259,58 @@ namespace FS
         const char * get_name() const { return this->name; }   
     };
     
+    /* names and types of entities are kept as 16-bit symbols instead of 
+     * strings. the upper bits of a symbol select a string table and the lower
+     * bits index into it. table 0 holds the core symbols of libfs, and each 
+     * file system registers the table generated for it by jdc when it is 
+     * constructed, which gives it a base to add to its symbol numbers */
+    typedef unsigned short symbol_t;
+    
+    enum { SYMBOL_BITS = 12, MAX_SYMBOLS = 1 << SYMBOL_BITS };
+    
+    enum CoreSymbol
+    {
+        SYM_EMPTY,      /* "" */
+        SYM_UNKNOWN,    /* "unknown" */
+        SYM_NULL,       /* "null" */
+        SYM_BIT,        /* "bit" */
+        SYM_DATA,       /* "data" */
+        NUM_CORE_SYMBOLS
+    };
+    
+    /* returns the base of the table, which is the same for every call with 
+     * the same table, or 0 if there is no more room for tables */
+    symbol_t register_symbols(const char * const * table, unsigned num);
+    const char * symbol_to_name(symbol_t sym);
+    
     static const int INVALID_ENTITY = -1;
     
-    class Entity : public Nominal
+    class Entity
     {  
-        const char * type;
+        symbol_t name;
+        symbol_t type;
         int index;
         int flags;
         
     protected:
-        void set_type(const char * type) { this->type = type; }
+        void set_name(symbol_t name) { this->name = name; } 
+        void set_type(symbol_t type) { this->type = type; }
         void set_index(int idx) { this->index = idx; }
         
         void set_flags(int flags) { this->flags |= flags; }
         void clear_flags(int flags) { this->flags &= ~flags; }
         
     public:
-        Entity(const char * t, int f, const char * n="unknown", int i=INVALID_ENTITY) 
-            : Nominal(n), type(t), index(i), flags(f) {}
-        Entity() : Nominal("unknown"), type("null"), index(INVALID_ENTITY), 
+        Entity(symbol_t t, int f, symbol_t n=SYM_UNKNOWN, int i=INVALID_ENTITY) 
+            : name(n), type(t), index(i), flags(f) {}
+        Entity() : name(SYM_UNKNOWN), type(SYM_NULL), index(INVALID_ENTITY), 
             flags(0) {}
         virtual ~Entity() {}
         
-        const char * get_type() const { return this->type; }
+        const char * get_name() const { return symbol_to_name(name); }
+        const char * get_type() const { return symbol_to_name(type); }
+        symbol_t get_name_symbol() const { return this->name; }
+        symbol_t get_type_symbol() const { return this->type; }
         int get_index() const { return this->index; }
         
         /* use these to perform type-safe casting */
@@ -243,8 +363,11 @@ namespace FS
             return 0; 
         }
         
-        virtual int accept_by_type(int type, Visitor & visitor) { 
-            (void)visitor;
+        /* same as accept_pointers, but skips the pointers that cannot lead 
+         * to a container or object of any of the given types */
+        virtual int accept_by_type(const std::vector<int> & types, 
+            Visitor & visitor) { 
+            (void)types; (void)visitor;
             return 0; 
         }
         
@@ -259,6 +382,7 @@ namespace FS
     enum SaveOptions
     {
         SO_NO_ALLOC = 0x0001,
+        SO_BARRIER  = 0x0002,   /* in a batch, after every save before it */
     };
     
     class Container : public Entity
@@ -272,14 +396,14 @@ namespace FS
         Path * path;
            
     protected:
-        Container(const Location & loc, Path * p, const char * t, int f, 
-            const char * n="", int i=0)
+        Container(const Location & loc, Path * p, symbol_t t, int f, 
+            symbol_t n=SYM_EMPTY, int i=0)
             : Entity(t, f, n, i), location(loc), refcount(1), path(p) {}         
         void set_size(unsigned sz) { location.size = sz; }
             
     public:
         Container(Container & rhs) = delete;
-        Container(Path * p, const char * t="null", int f=0) 
+        Container(Path * p, symbol_t t=SYM_NULL, int f=0) 
             : Entity(t, f), refcount(1), path(p) {}   
         virtual ~Container() override {}
     
@@ -305,7 +429,7 @@ namespace FS
     class Field : public Entity
     {
     public:
-        Field(const char * t, int f, const char * n="", int i=0) :
+        Field(symbol_t t, int f, symbol_t n=SYM_EMPTY, int i=0) :
             Entity(t, f, n, i) {} 
         virtual ~Field() {}
         
@@ -326,13 +450,13 @@ namespace FS
     protected:
         Container & parent;
 
-        Object(Container & pt, Path * p, const char * type, int flags,
-            const char * name="", int index=0)
+        Object(Container & pt, Path * p, symbol_t type, int flags,
+            symbol_t name=SYM_EMPTY, int index=0)
             : Entity(type, flags, name, index), path(p), parent(pt) {}
         void set_size(unsigned sz) { this->size = sz; }
             
     public:
-        Object(Path * p, const char * t, int f) : Entity(t, f), path(p), parent(nullpt) {}
+        Object(Path * p, symbol_t t, int f) : Entity(t, f), path(p), parent(nullpt) {}
          
         virtual ~Object() override {}   
         
@@ -353,10 +477,10 @@ namespace FS
         unsigned char bit;
 
     public:
-        Bit() : Field("bit", TF_INTEGRAL), bit(0) {}
-        Bit(bool bit, int idx) : Field("bit", TF_INTEGRAL, "", idx),
+        Bit() : Field(SYM_BIT, TF_INTEGRAL), bit(0) {}
+        Bit(bool bit, int idx) : Field(SYM_BIT, TF_INTEGRAL, SYM_EMPTY, idx),
             bit((bit) ? 1 : 0) {}
-        Bit(bool bit, const char * name) : Field("bit", TF_INTEGRAL, name),
+        Bit(bool bit, symbol_t name) : Field(SYM_BIT, TF_INTEGRAL, name),
             bit((bit) ? 1 : 0) {}
             
         Bit & operator=(Bit && rhs);
@@ -439,7 +563,7 @@ namespace FS
                 for (j = 0; j < 8; j++)
                 {
                     const unsigned n = i * 8 + j;
-                    Bit bit(buf[i] & (1 << j), n);
+                    Bit bit(buf[i] & (1 << j), (int)n);
                     if ((ret = visitor.visit(bit)) != 0)
                         return ret;
                 }
@@ -472,8 +596,8 @@ namespace FS
 
                     if (bit_this != bit_other) {
 
-                        Bit bit_This(buf[i] & (1 << j), n);
-                        Bit bit_Other(buf_other[i] & (1 << j), n);
+                        Bit bit_This(buf[i] & (1 << j), (int)n);
+                        Bit bit_Other(buf_other[i] & (1 << j), (int)n);
 
                         ret = v.diff(*this, bit_This, bit_Other);
 
@@ -499,7 +623,7 @@ namespace FS
         unsigned size = 0;
     
     public:
-        Buffer(const char * t, int f, const char * n="", int i=0) :
+        Buffer(symbol_t t, int f, symbol_t n=SYM_EMPTY, int i=0) :
             Field(t, f, n, i) {}
         Buffer(Buffer && rhs);    
         Buffer(Buffer & rhs) = delete;
@@ -527,12 +651,25 @@ namespace FS
         operator const char *() { return buf; }
     };
 
+    struct IOVector
+    {
+        const char * buf;
+        unsigned len;
+    };
+    
     class IO : public Nominal
     {
+        unsigned long num_writes = 0;
+        
     public:
         using Nominal::Nominal;
         IO() : Nominal("null") {}
         
+        /* counts the writes made through libfs (saves and write batches),
+         * so that bytes read before one can be told apart as stale */
+        unsigned long get_num_writes() const { return num_writes; }
+        void count_write() { num_writes++; }
+        
         virtual int read(const Location & loc, char * & buf) {
             return ERR_UNIMP;
         }
@@ -544,6 +681,24 @@ namespace FS
         virtual int alloc(Location & loc, int type) {
             return ERR_UNIMP;
         }
+        
+        /* byte position of loc on the device, which write batches are sorted
+         * by. negative if it has none, e.g. a file-relative address */
+        virtual long long get_position(const Location & loc) {
+            return ERR_UNIMP;
+        }
+        
+        /* writes the buffers back to back from byte position pos. returns 
+         * number of bytes written, or negative value on error */
+        virtual int write_vector(long long pos, const IOVector * vec, 
+            unsigned cnt) {
+            return ERR_UNIMP;
+        }
+        
+        /* makes every write so far durable */
+        virtual int sync() {
+            return 0;
+        }
             
         virtual ~IO() {}
     };
@@ -552,15 +707,16 @@ namespace FS
 	{
 	    static IO nio;
 	    Serializer * serializer;
+	    WriteBatch * batch;
 	
 	public:
 	    IO & io;
 	    
 	    FileSystem(const char * n) : Nominal(n), serializer(nullptr), 
-	        io(nio) {}
+	        batch(nullptr), io(nio) {}
 		FileSystem(const char * n, IO & io, Serializer * s=nullptr) 
-		    : Nominal(n), serializer(s), io(io) {}
-        virtual ~FileSystem() {}
+		    : Nominal(n), serializer(s), batch(nullptr), io(io) {}
+        virtual ~FileSystem();
         
         virtual Container * fetch_super() const = 0;
         virtual Container * parse_super(unsigned long start, const char * buf, 
@@ -569,12 +725,82 @@ namespace FS
             const char * buf, unsigned len) const = 0;
         virtual int super_type_id() const = 0;     
         virtual Container * create_container(int type, Path * path) const = 0;
-        
+
+        /* checks the constraints of a container directly on its raw buffer.
+         * returns 0 if valid, negative if not, and optionally sets 'why' to
+         * the failed constraint. a null buffer only queries whether the type
+         * can be validated at all (ERR_UNIMP if not, e.g. extents) */
+        virtual int validate_by_type(int type, const Location & loc,
+            const Path * path, const char * buf, unsigned len,
+            const char ** why=nullptr) const {
+            (void)type; (void)loc; (void)path; (void)buf; (void)len; (void)why;
+            return ERR_UNIMP;
+        }
+
         virtual const char * type_to_name(unsigned type) const;
         virtual const char * address_space_to_name(int aspc) const;
         
+        /* whether a container or object of type 'to' may be found by
+         * following pointers from type 'from'. defaults to true so that
+         * nothing is pruned if the type graph is unknown */
+        virtual bool is_reachable(int from, int to) const {
+            (void)from; (void)to;
+            return true;
+        }
+        
+        /* whether any of the types may be found from type 'from' */
+        bool is_reachable(int from, const std::vector<int> & to) const {
+            for (unsigned i = 0; i < to.size(); i++) {
+                if (is_reachable(from, to[i]))
+                    return true;
+            }
+            return false;
+        }
+        
+        /* looks up a type id by the name type_to_name gives it. returns the
+         * type id if found, negative if not */
+        virtual int name_to_type(const char * name) const {
+            (void)name;
+            return ERR_UNIMP;
+        }
+        
+        /* looks up a field by name in a scope, which is a type id, or a 
+         * nested struct or union of one. adds the scopes that the field may
+         * lead to (its nested struct, the object it embeds, or the types its
+         * pointers may fetch) to next. returns 0 if found, negative if not. 
+         * the super block's scope is super_type_id() */
+        virtual int lookup_field(int scope, const char * name, 
+            std::vector<int> & next) const {
+            (void)scope; (void)name; (void)next;
+            return ERR_UNIMP;
+        }
+        
+        /* looks up an annotated constant (FSCONST) by name. returns 0 if
+         * found, negative if not */
+        virtual int name_to_constant(const char * name, long & value) const {
+            (void)name; (void)value;
+            return ERR_UNIMP;
+        }
+        
         void set_serializer(Serializer * s) { serializer = s; }
         int post_process(Entity & ent, char * buf, unsigned len);
+        
+        /* between begin_batch and flush_batch, Container::save queues its
+         * buffer instead of writing it. a location saved twice is written
+         * once, with the last buffer. flush_batch writes the queue sorted by
+         * position, merging adjacent buffers into one write_vector, then 
+         * syncs once. it returns number of bytes written, or negative value
+         * on the first error, in which case the rest of the queue is dropped.
+         * a barrier (or a save with SO_BARRIER) syncs every save queued
+         * before it ahead of those queued after it, e.g. so that a super 
+         * block reaches the disk after the metadata it refers to. reads are
+         * not served from the queue */
+#ifndef __KERNEL__
+        int begin_batch();
+        int write_barrier();
+        int flush_batch();
+#endif
+        WriteBatch * get_batch() const { return batch; }
 	};
     
     struct ByteSwap {
@@ -599,7 +825,7 @@ namespace FS
         };
     
     public:
-        Integer(const char * type, int flags=0, const char * name="", 
+        Integer(symbol_t type, int flags=0, symbol_t name=SYM_EMPTY, 
             int index=0) : 
             Field(type, flags | TF_INTEGRAL | F, name, index), value(0) {}
         
@@ -695,14 +921,29 @@ namespace FS
         bool     resolved   = false;
 
     public:
-        Pointer(const char * type, int flags, const char * name="", 
+        Pointer(symbol_t type, int flags, symbol_t name=SYM_EMPTY, 
             int index=0) 
             : Field(type, flags | TF_POINTER, name, index) {}
 
       	Container * fetch() const;
       	const Location & pointer_location() const { return location; }
       	unsigned pointer_type() const { return ptr_type; }
+
+      	/* path that the target container would be fetched with */
+      	virtual Path * get_path() const { return nullptr; }
       	
+      	virtual int accept_by_type(const std::vector<int> & types, 
+      	    Visitor & visitor) override {
+      	    Path * path = get_path();
+      	    FileSystem * fs = path ? path->get_file_system() : nullptr;
+      	    
+      	    if (ptr_type == INVALID_TYPE_ID)
+      	        return 0;
+      	    if (fs != nullptr && !fs->is_reachable(ptr_type, types))
+      	        return 0;
+      	    return visitor.visit(*this);
+      	}
+
       	virtual Pointer * to_pointer() final override { return this; }
       	virtual unsigned get_size() const override { return location.len; }
       	
@@ -724,7 +965,7 @@ namespace FS
         };
     
     public:
-        IntPtr(const char * type, int flags=0, const char * name="", 
+        IntPtr(symbol_t type, int flags=0, symbol_t name=SYM_EMPTY, 
             int index=0) : 
             Pointer(type, flags | TF_INTEGRAL | F, name, index) {
             location.len = sizeof(S);
@@ -802,8 +1043,8 @@ namespace FS
         Object * target;
            
     public:
-        Offset(Path * p, const char * type, int flags=0, 
-            const char * name="", int index=0) : 
+        Offset(Path * p, symbol_t type, int flags=0, 
+            symbol_t name=SYM_EMPTY, int index=0) : 
             Integer<S, F>(type, flags | TF_OFFSET, name, index),
             path(p), target(nullptr) {}
             
@@ -870,6 +1111,16 @@ namespace FS
             return ret;    
         }
         
+        virtual int accept_by_type(const std::vector<int> & types, 
+            Visitor & visitor) override {
+            int ret = 0;
+        
+            if (target != nullptr)
+                ret = target->accept_by_type(types, visitor);
+                
+            return ret;    
+        }
+        
         virtual void resolve() override { if (target != nullptr) target->resolve(); }
     };
     
@@ -878,9 +1129,10 @@ namespace FS
         const char * buffer;
     
     public:
-        Data() : Container(nullptr, "data", TF_DATA), buffer(nullptr) {}
-        Data(const Location & lc, const Path * p, int idx=0, const char * name="") 
-            : Container(lc, nullptr, "data", TF_DATA, name, idx)
+        Data() : Container(nullptr, SYM_DATA, TF_DATA), buffer(nullptr) {}
+        Data(const Location & lc, const Path * p, int idx=0, 
+            symbol_t name=SYM_EMPTY) 
+            : Container(lc, nullptr, SYM_DATA, TF_DATA, name, idx)
             , buffer(nullptr) { (void)p; }
         
         const char * get_buffer() const { return buffer; }
@@ -1033,6 +1285,21 @@ namespace FS
             return ret;
         }
 
+        virtual int accept_by_type(const std::vector<int> & types, 
+            FS::Visitor & visitor) override
+        {
+            typename std::vector<T *>::iterator it = element.begin();
+            int ret = 0;
+            
+            for( ; it != element.end(); ++it) {
+                T * ptr = *it;
+                if ((ret = ptr->accept_by_type(types, visitor)) != 0)
+                    return ret;
+            }
+
+            return ret;
+        }
+
         virtual bool is_sentinel(T & self) const 
         { 
             (void)self;
@@ -1069,7 +1336,7 @@ namespace FS
         virtual int get_count() const { return (unsigned)(-1); }
 
     public:
-        Array(const char * t, int f, const char * n="", int i=0) :
+        Array(symbol_t t, int f, symbol_t n=SYM_EMPTY, int i=0) :
             Entity(t, f, n, i) {} 
         virtual ~Array() override {
             typename std::vector<T *>::iterator it = element.begin();
@@ -1084,7 +1351,7 @@ namespace FS
             return *element[idx];
         }
         
-        virtual T * create_element(int idx, const char * name)=0;
+        virtual T * create_element(int idx, symbol_t name)=0;
     
         virtual int parse(const char * buf, unsigned len) override 
         {
@@ -1098,7 +1365,7 @@ namespace FS
             while (remaining >= minimum && idx < max_count)
             {
                 int ret;
-                T * tmp = create_element(idx, this->get_name()); 
+                T * tmp = create_element(idx, this->get_name_symbol()); 
                 if (tmp == nullptr) return -ENOMEM;
                 
                 if ((ret = tmp->parse(buf, remaining)) < 0)
@@ -1174,6 +1441,21 @@ namespace FS
             return ret;
         }
 
+        virtual int accept_by_type(const std::vector<int> & types, 
+            FS::Visitor & visitor) override
+        {
+            typename std::vector<T *>::iterator it = element.begin();
+            int ret = 0;
+            
+            for( ; it != element.end(); ++it) {
+                T * ptr = *it;
+                if ((ret = ptr->accept_by_type(types, visitor)) != 0)
+                    return ret;
+            }
+
+            return ret;
+        }
+
         virtual bool is_sentinel(T & self) const 
         { 
             (void)self;
@@ -1202,8 +1484,61 @@ namespace FS
     template<typename T>
     class Extent : public Container
     {
+        enum { WINDOW_SIZE = 256 * 1024 };
+        
+        /* bytes of the extent that elements were last parsed from, so that
+         * fetching every element does not issue one read per element */
+        mutable char * window = nullptr;
+        mutable Location window_loc;
+        mutable unsigned long window_writes = 0;  /* io writes when read */
+        mutable bool window_failed = false;
+        
     protected:
         std::vector<T *> element;
+        
+        /* returns the bytes of lc, an element of this extent, reading them
+         * along with the elements after it (up to WINDOW_SIZE) if they are
+         * not in the window. returns nullptr if they cannot be read, e.g. 
+         * the extent runs past the end of the image, in which case the 
+         * element should be read by itself */
+        const char * read_window(FileSystem * fs, const Location & lc) const {
+            unsigned start = lc.offset;
+            unsigned end = location.offset + location.size;
+            unsigned len;
+            char * buf = nullptr;
+            int ret;
+            
+            if (window_failed || start < location.offset || 
+                lc.size > end - start)
+                return nullptr;
+            
+            /* any write since may have been to an element in the window */
+            if (window != nullptr && window_writes == fs->io.get_num_writes()
+                && start >= window_loc.offset && 
+                start + lc.size <= window_loc.offset + window_loc.size)
+                return window + (start - window_loc.offset);
+            
+            /* the window is a whole number of elements */
+            len = (lc.size < WINDOW_SIZE) ? 
+                (WINDOW_SIZE / lc.size * lc.size) : lc.size;
+            if (len > end - start)
+                len = end - start;
+            
+            delete [] window;
+            window = nullptr;
+            window_loc = Location(location, len, start);
+            
+            ret = fs->io.read(window_loc, buf);
+            if (buf == nullptr || ret < (int)len) {
+                delete [] buf;
+                window_failed = true;
+                return nullptr;
+            }
+            
+            window = buf;
+            window_writes = fs->io.get_num_writes();
+            return window;
+        }
   
         T * get_or_create(int idx) {
             assert(idx >= 0 && idx < (int)element.size());
@@ -1224,6 +1559,7 @@ namespace FS
         virtual ~Extent() override {
             typename std::vector<T *>::iterator it = element.begin();
             
+            delete [] window;
             for ( ; it != element.end(); ++it) {
                 T * & tmp = *it;
                 if (tmp != nullptr)
@@ -1232,8 +1568,8 @@ namespace FS
         }
         
     public:
-        Extent(const Location & lc, Path * p, const char * t, int f, 
-            const char * n="", int idx=0) : 
+        Extent(const Location & lc, Path * p, symbol_t t, int f, 
+            symbol_t n=SYM_EMPTY, int idx=0) : 
             Container(lc, p, t, f | TF_EXTENT, n, idx) {}   
         
         /*
@@ -1287,6 +1623,23 @@ namespace FS
             return ret;
         }
 
+        virtual int accept_by_type(const std::vector<int> & types, 
+            FS::Visitor & visitor) override
+        {
+            int ret = 0;
+        
+            for (unsigned i = 0; i < this->get_count(); ++i) {
+                T * tmp = get_or_create(i);
+                if (tmp != nullptr) {
+                    if ((ret = tmp->accept_by_type(types, visitor)) != 0)
+                        return ret;
+                }
+                else return ERR_CORRUPT;
+            }
+            
+            return ret;
+        }
+
         int compare(const Extent& other, Visitor& v) const {
 
             typename std::vector<T *>::iterator it_this = element.begin();
@@ -1306,6 +1659,346 @@ namespace FS
         }
 
     };
+
+#ifndef __KERNEL__
+    /* file type of a directory entry, numbered as in ext2, which btrfs and
+     * f2fs also use */
+    enum FileType
+    {
+        FT_UNKNOWN,
+        FT_REG_FILE,
+        FT_DIR,
+        FT_CHRDEV,
+        FT_BLKDEV,
+        FT_FIFO,
+        FT_SOCK,
+        FT_SYMLINK,
+    };
+    
+    struct Dirent
+    {
+        unsigned long ino;
+        int type;
+        std::string name;
+        
+        Dirent() : ino(0), type(FT_UNKNOWN) {}
+        Dirent(unsigned long i, int t, const char * n, unsigned len) 
+            : ino(i), type(t), name(n, len) {}
+    };
+    
+    struct Stat
+    {
+        unsigned long ino;
+        unsigned mode;          /* posix mode, including the file type */
+        unsigned long nlink;
+        unsigned uid;
+        unsigned gid;
+        unsigned long long size;
+        long long mtime;
+        
+        Stat() : ino(0), mode(0), nlink(0), uid(0), gid(0), size(0), 
+            mtime(0) {}
+        bool is_dir() const { return (mode & 0xF000) == 0x4000; }
+    };
+    
+    /* decodes the directories and inodes of one file system for Namespace.
+     * adapters do not need to cache anything */
+    class NameAdapter
+    {
+    public:
+        virtual ~NameAdapter() {}
+        
+        virtual int get_root(unsigned long & ino) = 0;
+        
+        /* every entry of a directory, in on-disk order */
+        virtual int read_dir(unsigned long dir, std::vector<Dirent> & ents) = 0;
+        virtual int read_inode(unsigned long ino, Stat & st) = 0;
+        
+        /* finds one name without reading the whole directory, e.g. through
+         * an index. returns -ENOENT if the name is not there, or ERR_UNIMP 
+         * to have the directory read instead */
+        virtual int lookup(unsigned long dir, const char * name, unsigned len,
+            unsigned long & ino) {
+            (void)dir; (void)name; (void)len; (void)ino;
+            return ERR_UNIMP;
+        }
+    };
+    
+    struct NameVisitor
+    {
+        NameVisitor() {}
+        virtual ~NameVisitor() {}
+        
+        /* path is the full path of the entry. return non-zero to stop */
+        virtual int visit(const std::string & path, const Dirent & ent) = 0;
+    };
+    
+    /* 
+     * path resolution on top of a NameAdapter. names that were looked up, 
+     * including the ones that do not exist, and directories that were read
+     * are cached so that they are never decoded twice, as are inodes. the 
+     * caches are bounded and simply dropped once they are full.
+     * 
+     * symbolic links are not followed, so ".." is resolved on the path
+     * itself rather than through the file system
+     */
+    class Namespace
+    {
+        struct DentryKey
+        {
+            unsigned long dir;
+            std::string name;
+            
+            bool operator==(const DentryKey & rhs) const {
+                return dir == rhs.dir && name == rhs.name;
+            }
+        };
+        
+        struct DentryHash
+        {
+            size_t operator()(const DentryKey & k) const {
+                return std::hash<std::string>()(k.name) ^ 
+                    (k.dir * 0x9E3779B97F4A7C15UL);
+            }
+        };
+    
+        NameAdapter & adapter;
+        unsigned long max_dentries;
+        unsigned long max_inodes;
+        
+        /* inode number of each name, 0 if the name does not exist */
+        std::unordered_map<DentryKey, unsigned long, DentryHash> dentries;
+        
+        /* directories read in full, lookups of names that are not in them 
+         * are negative without asking the adapter */
+        std::unordered_map<unsigned long, std::vector<Dirent>> listings;
+        unsigned long num_listed;
+        
+        std::unordered_map<unsigned long, Stat> inodes;
+        
+        unsigned long hits;
+        unsigned long misses;
+        
+        void add_dentry(unsigned long dir, const char * name, unsigned len, 
+            unsigned long ino);
+        int load_dir(unsigned long dir, const std::vector<Dirent> * & ents);
+        int walk(unsigned long dir, std::string & path, 
+            std::unordered_set<unsigned long> & seen, NameVisitor & visitor);
+        
+    public:
+        Namespace(NameAdapter & a, unsigned long max_dentries=1UL << 20, 
+            unsigned long max_inodes=1UL << 16) : adapter(a), 
+            max_dentries(max_dentries), max_inodes(max_inodes), 
+            num_listed(0), hits(0), misses(0) {}
+        
+        /* finds a name in a directory, -ENOENT if it is not there */
+        int lookup(unsigned long dir, const char * name, unsigned len, 
+            unsigned long & ino);
+        
+        /* resolves an absolute path */
+        int resolve(const char * path, unsigned long & ino);
+        
+        int stat(unsigned long ino, Stat & st);
+        int stat(const char * path, Stat & st);
+        
+        /* entries of a directory, without "." and ".." */
+        int list(unsigned long dir, std::vector<Dirent> & ents);
+        
+        /* visits everything under the directory at path, depth first */
+        int walk(const char * path, NameVisitor & visitor);
+        
+        /* must be called after the file system is modified */
+        void invalidate();
+        
+        unsigned long get_hits() const { return hits; }
+        unsigned long get_misses() const { return misses; }
+    };
+
+    /* a pointer field of an owner container, found during a traversal, that
+     * references the container at (aspc, addr). the target covers 'span'
+     * addresses starting at addr */
+    struct RMapEntry
+    {
+        u64 addr;
+        u64 owner_addr;
+        u32 offset;
+        u32 size;
+        u32 owner_offset;
+        u32 field;          /* offset of the field name in the name table */
+        int index;          /* element index of the field */
+        u32 span;
+        u16 aspc;
+        u16 type;
+        u16 owner_aspc;
+        u16 owner_type;
+    };
+
+    /*
+     * saves queued by FileSystem::begin_batch. the queue is split into 
+     * epochs, whose writes are issued in order of position. a new epoch is
+     * started by a barrier, by a write that overlaps (but is not the same as)
+     * one already queued, and around a write that has no position
+     */
+    class WriteBatch
+    {
+        enum { MAX_RUN = 1024 };    /* IOV_MAX */
+        
+        struct Write
+        {
+            Location loc;
+            long long pos;
+            char * buf;
+            unsigned epoch;
+            
+            Write(const Location & l, long long p, char * b, unsigned e) :
+                loc(l), pos(p), buf(b), epoch(e) {}
+        };
+        
+        struct Extent
+        {
+            long long end;
+            size_t index;   /* into writes */
+        };
+        
+        IO & io;
+        std::vector<Write> writes;
+        std::map<long long, Extent> extents;    /* of the current epoch */
+        std::vector<unsigned> barriers;         /* epochs that follow a sync */
+        unsigned epoch;
+        
+        void next_epoch();
+        int write_run(const Write * run, unsigned cnt);
+        
+    public:
+        WriteBatch(IO & io) : io(io), epoch(0) {}
+        WriteBatch(const WriteBatch & rhs) = delete;
+        ~WriteBatch() { clear(); }
+        
+        /* takes ownership of buf, which holds loc.size bytes. returns 
+         * number of bytes queued */
+        int add(const Location & loc, char * buf);
+        void barrier();
+        int flush();
+        void clear();
+        
+        size_t size() const { return writes.size(); }
+    };
+
+    /*
+     * allocator over on-disk bitmaps, e.g. the block bitmaps of ext3 groups,
+     * in which a set bit means in use. the free runs of every bitmap are kept
+     * in a tree, ordered by address and by length, so that an allocation is 
+     * served without scanning the bitmaps
+     */
+    class BitmapAllocator
+    {
+        enum { GOAL_PROBES = 8 };   /* runs after the goal that are tried */
+        
+        struct Bitmap
+        {
+            Location loc;
+            u64 first;              /* address of bit 0 */
+            u64 count;              /* number of bits */
+            std::vector<char> bits;
+            bool dirty;
+        };
+        
+        typedef std::map<u64, u64>::iterator RunIter;
+        
+        std::vector<Bitmap> bitmaps;                /* sorted by first */
+        std::map<u64, u64> runs;                    /* start -> length */
+        std::set<std::pair<u64, u64>> by_length;    /* (length, start) */
+        u64 num_free;
+        
+        Bitmap * find_bitmap(u64 addr);
+        void insert_run(u64 start, u64 len);
+        void erase_run(RunIter it);
+        void take(RunIter it, u64 start, u64 len);
+        bool mark(u64 start, u64 len, bool used);
+        
+    public:
+        BitmapAllocator() : num_free(0) {}
+        
+        /* the count bits of a bitmap at loc, whose first bit is address
+         * first. bits holds loc.size bytes, which are copied */
+        int add_bitmap(const Location & loc, u64 first, u64 count, 
+            const char * bits);
+        
+        /* allocates len addresses at goal if free, else as close after it
+         * as can be found quickly, else wherever they fit */
+        int alloc(u64 goal, u64 len, u64 & start);
+        int release(u64 start, u64 len);
+        
+        /* queues the bitmaps that changed since the last flush. returns 
+         * number of bitmaps queued, or negative value on error */
+        int flush(WriteBatch & batch);
+        
+        bool empty() const { return bitmaps.empty(); }
+        u64 get_num_free() const { return num_free; }
+    };
+
+    /*
+     * reverse map builder, which is fed every pointer of a traversal and
+     * saves them sorted by target. the file is laid out so that RMap can
+     * use it as is, without parsing or copying it
+     */
+    class RMapBuilder
+    {
+        std::vector<RMapEntry> entries;
+        std::vector<char> names;
+        std::unordered_map<symbol_t, u32> name_ids;
+        std::vector<unsigned> units;
+        unsigned long num_skipped;
+
+    public:
+        /* units[aspc] is the size in bytes of one address of aspc. targets
+         * in an address space without a unit only cover their address */
+        RMapBuilder(const std::vector<unsigned> & units) : units(units),
+            num_skipped(0) {}
+
+        /* records ptr, a field of owner, which was reached as owner_type */
+        void add(const Container & owner, int owner_type, const Pointer & ptr);
+        int save(const char * filename);
+
+        size_t size() const { return entries.size(); }
+        unsigned long get_skipped() const { return num_skipped; }
+    };
+
+    /* read-only view of a reverse map file */
+    class RMap
+    {
+        char * base;
+        size_t length;
+        const RMapEntry * entries;
+        u64 num_entries;
+        const u32 * max_span;
+        unsigned num_aspc;
+        const char * names;
+        u64 names_size;
+
+    public:
+        RMap() : base(nullptr), length(0), entries(nullptr), num_entries(0),
+            max_span(nullptr), num_aspc(0), names(nullptr), names_size(0) {}
+        RMap(const RMap & rhs) = delete;
+        ~RMap() { close(); }
+
+        int open(const char * filename);
+        void close();
+
+        /* every pointer whose target overlaps addresses [start, end) */
+        void referencing(int aspc, u64 start, u64 end,
+            std::vector<const RMapEntry *> & out) const;
+
+        /* every pointer whose target covers the address, i.e. its owners */
+        void owners(int aspc, u64 addr,
+            std::vector<const RMapEntry *> & out) const {
+            referencing(aspc, addr, addr + 1, out);
+        }
+
+        const char * field_name(const RMapEntry & ent) const;
+        u64 size() const { return num_entries; }
+    };
+#endif /* __KERNEL__ */
 } /* namespace FS */
 
 #endif
@@ -66,11 +66,20 @@ extern void free(const void *);
 extern void * malloc(size_t size, gfp_t flags=GFP_NOFS);
 extern void * realloc(const void *, size_t size, gfp_t flags=GFP_NOFS);
 
+// slab caches
+struct kmem_cache;
+extern struct kmem_cache * kmem_cache_create(const char *, size_t, size_t,
+    unsigned long, void (*)(void *));
+extern void kmem_cache_destroy(struct kmem_cache *);
+extern void * kmem_cache_alloc(struct kmem_cache *, gfp_t);
+extern void kmem_cache_free(struct kmem_cache *, void *);
+
 // string functions
 extern char * strcpy(char *,const char *);
 extern char * strncpy(char *,const char *, __kernel_size_t);
 extern int strcmp(const char *, const char *);
 extern void * memcpy(void *, const void *, __kernel_size_t);
+extern void * memmove(void *, const void *, __kernel_size_t);
 extern void * memset(void *,int,__kernel_size_t);
 extern int memcmp(const void *,const void *,__kernel_size_t);
 
@@ -9,228 +9,472 @@
 
 namespace std
 {
+    // finalizer of murmur3, spreads every input bit over the whole word so
+    // that sequential keys (e.g. block numbers) do not cluster when masked
+    inline size_t hash_mix(unsigned long long value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return (size_t)value;
+    }
+
     template<typename K>
     struct hash;
-    
-    template<>
-    struct hash<unsigned>
+
+    template<typename K>
+    struct hash<K *>
     {
-        size_t operator()(unsigned value)
+        size_t operator()(K * value) const
         {
-            // TODO: currently does nothing... (lol)
-            return value;
+            return hash_mix((unsigned long long)(unsigned long)value);
         }
     };
-    
+
+#define STD_INTEGER_HASH(K)                                 \
+    template<>                                              \
+    struct hash<K>                                          \
+    {                                                       \
+        size_t operator()(K value) const                    \
+        {                                                   \
+            return hash_mix((unsigned long long)value);     \
+        }                                                   \
+    }
+
+    STD_INTEGER_HASH(int);
+    STD_INTEGER_HASH(unsigned);
+    STD_INTEGER_HASH(long);
+    STD_INTEGER_HASH(unsigned long);
+    STD_INTEGER_HASH(long long);
+    STD_INTEGER_HASH(unsigned long long);
+
+#undef STD_INTEGER_HASH
+
     template<typename A, typename B>
     struct pair
     {
         A first;
         B second;
-        
-        pair(const A & a, B && b) : first(a), second(move(b)) {}  
+
+        pair(const A & a, B && b) : first(a), second(move(b)) {}
     };
 
+    // open addressing (linear probing) over a power-of-two table. items live
+    // in pooled nodes so that growing the table only moves pointers, and the
+    // move is done a few slots at a time on each insert rather than all at
+    // once. erase leaves a tombstone, so iterators stay valid.
     template<typename K, typename T, class H = hash<K> >
     class unordered_map
     {
-        struct hlist_node
+        typedef pair<K, T> node;
+
+        struct slot
         {
-            pair<K, T>   item;
-            hlist_node * next;
-            
-            hlist_node(const K & k, T && t) : item(k, move(t)), next(nullptr) {}
+            size_t hash;        // 0 if empty, 1 if erased (when item is null)
+            node * item;
         };
-        
-        hlist_node ** bucket;
-        unsigned      num_buckets;
-        size_t        num_elements;        
-        
+
+        struct table
+        {
+            slot *   slots;
+            unsigned mask;      // capacity - 1
+            unsigned used;      // slots that are not empty (incl. tombstones)
+        };
+
+        // nodes are carved out of chunks and recycled through a free list
+        union pool_entry
+        {
+            pool_entry * next;
+            alignas(node) char data[sizeof(node)];
+        };
+
+        struct chunk
+        {
+            chunk *    next;
+            pool_entry entries[64];
+        };
+
+        static const unsigned min_slots = 8;
+        static const unsigned rehash_batch = 16;
+
+        table         curr;
+        table         prev;         // being drained into curr, if slots != 0
+        unsigned      start;        // an empty slot of prev, drained last
+        unsigned      drained;      // number of slots of prev moved over
+        size_t        num_elements;
+        chunk *       chunks;
+        pool_entry *  free_list;
+
+        static bool is_empty(const slot & s)
+        {
+            return s.item == nullptr && s.hash == 0;
+        }
+
+        static size_t hash_of(const K & k)
+        {
+            H hasher;
+            return hasher(k);
+        }
+
+        static bool alloc_table(table & t, unsigned capacity)
+        {
+            t.slots = new slot[capacity];
+            t.mask = 0;
+            t.used = 0;
+
+            if ( t.slots == nullptr )
+                return false;
+
+            memset(t.slots, 0, sizeof(slot)*capacity);
+            t.mask = capacity - 1;
+            return true;
+        }
+
+        static void free_table(table & t)
+        {
+            delete [] t.slots;
+            t.slots = nullptr;
+            t.mask = 0;
+            t.used = 0;
+        }
+
+        static slot * lookup(const table & t, const K & k, size_t h)
+        {
+            unsigned i;
+
+            if ( t.slots == nullptr )
+                return nullptr;
+
+            for ( i = h & t.mask; !is_empty(t.slots[i]); i = (i + 1) & t.mask )
+            {
+                slot & s = t.slots[i];
+                if ( s.item != nullptr && s.hash == h && s.item->first == k )
+                    return &s;
+            }
+
+            return nullptr;
+        }
+
+        // only used on the table being inserted into, which never has
+        // duplicate keys, so the first free (empty or erased) slot will do
+        static void place(table & t, size_t h, node * item)
+        {
+            unsigned i = h & t.mask;
+
+            while ( t.slots[i].item != nullptr )
+                i = (i + 1) & t.mask;
+
+            if ( is_empty(t.slots[i]) )
+                ++t.used;
+
+            t.slots[i].hash = h;
+            t.slots[i].item = item;
+        }
+
+        node * alloc_node(const K & k, T && t)
+        {
+            pool_entry * entry = free_list;
+
+            if ( entry == nullptr )
+            {
+                chunk * c = new chunk;
+
+                if ( c == nullptr )
+                    return nullptr;
+
+                c->next = chunks;
+                chunks = c;
+
+                for ( unsigned i = 0; i < sizeof(c->entries)/sizeof(c->entries[0]); i++ )
+                {
+                    c->entries[i].next = free_list;
+                    free_list = &c->entries[i];
+                }
+
+                entry = free_list;
+            }
+
+            free_list = entry->next;
+            return new (entry->data) node(k, move(t));
+        }
+
+        void free_node(node * item)
+        {
+            pool_entry * entry = reinterpret_cast<pool_entry *>(item);
+
+            item->~node();
+            entry->next = free_list;
+            free_list = entry;
+        }
+
+        // moves at least 'count' slots of prev into curr. slots are moved
+        // one cluster at a time, starting right after an empty slot and
+        // stopping right after one, so that no probe sequence of a key left
+        // in prev runs through a drained slot, which can then be emptied
+        void drain(unsigned count)
+        {
+            bool mid_cluster = false;
+
+            while ( prev.slots != nullptr && (count > 0 || mid_cluster) )
+            {
+                unsigned i = (start + 1 + drained) & prev.mask;
+                slot & s = prev.slots[i];
+
+                mid_cluster = !is_empty(s);
+                if ( s.item != nullptr )
+                    place(curr, s.hash, s.item);
+
+                s.hash = 0;
+                s.item = nullptr;
+
+                if ( count > 0 )
+                    --count;
+
+                if ( ++drained > prev.mask )
+                    free_table(prev);
+            }
+        }
+
+        // called before an insert into curr
+        void reserve_one()
+        {
+            unsigned capacity = curr.mask + 1;
+            table next;
+
+            drain(rehash_batch);
+
+            if ( curr.slots != nullptr && (curr.used + 1) * 4 <= capacity * 3 )
+                return;
+
+            // still draining the last resize, finish it before starting over
+            drain(~0u);
+
+            // if most of the used slots are tombstones, rebuild at same size
+            if ( curr.slots == nullptr )
+                capacity = min_slots;
+            else if ( num_elements * 2 >= capacity )
+                capacity *= 2;
+
+            if ( !alloc_table(next, capacity) )
+                return;
+
+            prev = curr;
+            curr = next;
+            drained = 0;
+
+            // there is always an empty slot, since used is kept below 3/4
+            for ( start = 0; prev.slots != nullptr && 
+                             !is_empty(prev.slots[start]); start++ );
+        }
+
         void clear_internal()
         {
-            for ( unsigned i = 0; i < num_buckets; i++ )
+            table * tables[] = { &prev, &curr };
+
+            for ( table * t : tables )
             {
-                hlist_node * head = bucket[i];
-                
-                while (head != nullptr)
+                if ( t->slots == nullptr )
+                    continue;
+
+                for ( unsigned i = 0; i <= t->mask; i++ )
                 {
-                    hlist_node * temp = head;
-                    head = head->next;
-                    delete temp;
+                    if ( t->slots[i].item != nullptr )
+                        free_node(t->slots[i].item);
                 }
             }
+
+            free_table(prev);
+            start = drained = 0;
+        }
+
+        void init(unsigned nb)
+        {
+            unsigned capacity = min_slots;
+
+            // room for nb elements without growing
+            while ( capacity * 3 < nb * 4 )
+                capacity *= 2;
+
+            prev.slots = nullptr;
+            prev.mask = prev.used = 0;
+
+            if ( !alloc_table(curr, capacity) )
+                printk("ERROR: std::unordered_map out of memory!\n");
         }
-        
+
     public:
         class iterator
         {
             friend class unordered_map;
-        
-            struct hlist_node ** bucket;
-            struct hlist_node *  current;
-            unsigned             bucket_number;
-            unsigned             num_buckets;
-            
-            iterator(struct hlist_node ** start, unsigned nb) : bucket(start), 
-                current(nullptr), bucket_number(0), num_buckets(nb)
+
+            const unordered_map * map;
+            const table *         tbl;
+            unsigned              index;
+
+            iterator(const unordered_map * m, const table * t, unsigned i)
+                : map(m), tbl(t), index(i) {}
+
+            // advance to the next occupied slot, starting at index
+            void settle()
             {
-                // used by begin
-                ++(*this);
+                while ( tbl != nullptr )
+                {
+                    for ( ; tbl->slots != nullptr && index <= tbl->mask; ++index )
+                    {
+                        if ( tbl->slots[index].item != nullptr )
+                            return;
+                    }
+
+                    // prev is always walked before curr
+                    tbl = (tbl == &map->prev) ? &map->curr : nullptr;
+                    index = 0;
+                }
             }
-            
-            iterator(struct hlist_node ** start, unsigned nb, 
-                     struct hlist_node * curr, unsigned bnum) 
-                : bucket(start), current(curr), bucket_number(bnum), num_buckets(nb)
+
+            node * current() const
             {
-                // used by find
+                return (tbl != nullptr) ? tbl->slots[index].item : nullptr;
             }
-          
-        public:           
-            iterator() : bucket(nullptr), current(nullptr), bucket_number(0),
-                         num_buckets(0) {}
-            
+
+        public:
+            iterator() : map(nullptr), tbl(nullptr), index(0) {}
+
             iterator & operator++()     // prefix increment operator
             {
-                while ( bucket_number < num_buckets )
-                {
-                    if ( current == nullptr )
-                        current = bucket[bucket_number];
-                    else
-                        current = current->next;
-                
-                    if ( current != nullptr )
-                        return *this;
-                        
-                    ++bucket_number;
-                }
-                    
+                ++index;
+                settle();
                 return *this;
             }
-            
+
             bool operator!=(const iterator & rhs) const
             {
-                return ( current != rhs.current );
+                return ( current() != rhs.current() );
             }
-            
+
             pair<K, T> & operator*()
             {
-                return current->item;
+                return *current();
             }
-            
+
             pair<K, T> * operator->() const
             {
-                return &current->item;
+                return current();
             }
         };
-    
-        unordered_map(unsigned nb)
-            : bucket(new hlist_node *[nb])
-            , num_buckets(nb)
-            , num_elements(0)  
+
+        unordered_map() : start(0), drained(0), num_elements(0), chunks(nullptr),
+            free_list(nullptr)
         {
-            memset(bucket, 0, sizeof(hlist_node *)*nb);
+            init(0);
         }
-        
+
+        unordered_map(unsigned nb) : start(0), drained(0), num_elements(0),
+            chunks(nullptr), free_list(nullptr)
+        {
+            init(nb);
+        }
+
         ~unordered_map()
         {
             clear_internal();
-            delete [] bucket;
+            free_table(curr);
+
+            while ( chunks != nullptr )
+            {
+                chunk * c = chunks;
+                chunks = chunks->next;
+                delete c;
+            }
         }
-        
+
+        // keeps the table and node pool for reuse
         void clear()
         {
             clear_internal();
             num_elements = 0;
-            memset(bucket, 0, sizeof(hlist_node *)*num_buckets);
+
+            if ( curr.slots != nullptr )
+            {
+                memset(curr.slots, 0, sizeof(slot)*(curr.mask + 1));
+                curr.used = 0;
+            }
         }
-        
+
         size_t size() const
         {
             return num_elements;
         }
-    
+
         iterator begin() const
         {
-            return iterator(bucket, num_buckets);
-        }    
-    
+            iterator it(this, &prev, 0);
+            it.settle();
+            return it;
+        }
+
         iterator end() const
         {
             return iterator();
         }
-        
+
         iterator find(K k) const
         {
-            H hasher;
-            unsigned bucket_number = hasher(k) % num_buckets;
-            hlist_node * head = bucket[bucket_number];
-            
-            while ( head != nullptr )
-            {
-                if ( head->item.first == k )
-                {
-                    return iterator(bucket, num_buckets, head, bucket_number);
-                }
-                
-                head = head->next;
-            }
-            
+            size_t h = hash_of(k);
+            slot * s;
+
+            if ( (s = lookup(curr, k, h)) != nullptr )
+                return iterator(this, &curr, s - curr.slots);
+
+            if ( (s = lookup(prev, k, h)) != nullptr )
+                return iterator(this, &prev, s - prev.slots);
+
             return iterator();
         }
-        
+
         iterator erase(const iterator & it)
         {
-            hlist_node * victim = bucket[it.bucket_number];
+            slot & s = it.tbl->slots[it.index];
             iterator ret = it;
-            
-            // advance the return value first before we modify it
-            ++ret;
-        
-            if ( bucket[it.bucket_number] == it.current )
-            {
-                bucket[it.bucket_number] = bucket[it.bucket_number]->next;
-            }
-            else
+
+            if ( s.item == nullptr )
             {
-                hlist_node * prev;
-                
-                do {
-                    prev = victim;
-                    victim = victim->next;
-                } while ( victim != it.current );
-                
-                if ( victim == nullptr )
-                {
-                    printk("ERROR: std::unordered_map::erase failed!\n");
-                    return it;
-                }
-                
-                // re-link linked list, excluding victim
-                prev->next = victim->next;
+                printk("ERROR: std::unordered_map::erase failed!\n");
+                return it;
             }
-            
-            delete victim;
+
+            // advance the return value first before we modify it
+            ++ret;
+
+            free_node(s.item);
+            s.item = nullptr;
+            s.hash = 1;     // tombstone, keeps probe chains intact
             --num_elements;
             return ret;
         }
-        
+
         // TODO: non-standard return value
         void emplace(const K & k, T && t)
         {
-            H hasher;
-            unsigned bucket_number = hasher(k) % num_buckets;
-            hlist_node * node = new hlist_node(k, move(t));
-            
-            if ( bucket[bucket_number] == nullptr )
-            {
-                bucket[bucket_number] = node;
-            }
-            else
+            size_t h = hash_of(k);
+            node * item;
+
+            // same as std, an existing key is left untouched
+            if ( lookup(curr, k, h) != nullptr || lookup(prev, k, h) != nullptr )
+                return;
+
+            reserve_one();
+
+            // at least one slot must stay empty for probing to terminate
+            if ( curr.slots == nullptr || curr.used >= curr.mask ||
+                 (item = alloc_node(k, move(t))) == nullptr )
             {
-                node->next = bucket[bucket_number];  
-                bucket[bucket_number] = node;
+                printk("ERROR: std::unordered_map::emplace out of memory!\n");
+                return;
             }
-            
+
+            place(curr, h, item);
             ++num_elements;
         }
     };
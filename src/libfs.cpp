@@ -16,22 +16,293 @@
 
 #ifndef __KERNEL__
 #include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
  
 using namespace FS;
 
 template<> const char * 
-Location::get_address<const char *>() const { return this->addrptr; }
+Location::get_address<const char *>() const { 
+    return (dynamic == ADDR_POOL) ? this->addrptr : this->addrbuf;
+}
 
+/* val may point into this location's own bytes, which are only released 
+ * after they have been copied */
 template<> void 
 Location::set_address(const char * val, unsigned len) {
-    if (dynamic)
-        delete this->addrptr;
+    char * old = (dynamic == ADDR_POOL) ? this->addrptr : nullptr;
+    unsigned short oldlen = this->len;
+    
+    if (len > INLINE_ADDR_SIZE) {
+        char * buf = (char *)pool_alloc(len);
+        memcpy(buf, val, len);
+        this->addrptr = buf;
+        this->dynamic = ADDR_POOL;
+    }
+    else {
+        memmove(this->addrbuf, val, len);
+        this->dynamic = ADDR_INLINE;
+    }
     
     this->len = (unsigned short)len;
-    this->addrptr = new char[len];
-    memcpy(this->addrptr, val, len);
-    this->dynamic = 1;
+    if (old != nullptr)
+        pool_free(old, oldlen);
+}
+
+void Location::copy_address(const Location & rhs)
+{
+    if (rhs.dynamic != ADDR_NUMBER) {
+        set_address(rhs.get_address<const char *>(), rhs.len);
+        return;
+    }
+    
+    release_address();
+    this->len = rhs.len;
+    this->addr = rhs.addr;
+}
+
+#ifdef __KERNEL__
+
+void * FS::pool_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+void FS::pool_free(void * ptr, size_t size)
+{
+    (void)size;
+    free(ptr);
+}
+
+#else /* USERSPACE */
+
+namespace {
+    const size_t pool_granule = 16;
+    const size_t pool_max = 1024;       /* larger goes straight to malloc */
+    const size_t pool_chunk = 64*1024;
+    const unsigned pool_classes = pool_max / pool_granule;
+
+    struct PoolBlock { PoolBlock * next; };
+    struct PoolChunk { PoolChunk * next; };
+    
+    /* per-thread, so no locking is needed. blocks may be freed by a thread 
+     * other than the one that allocated them, which is fine since chunks 
+     * are never returned to the system */
+    struct PoolCache
+    {
+        PoolBlock * free_list[pool_classes];
+        char *      bump;
+        size_t      left;
+    };
+    
+    thread_local PoolCache pool_cache;
+    
+    /* keeps every chunk reachable (e.g. after its thread exits) */
+    PoolChunk * pool_chunks = nullptr;
+}
+
+void * FS::pool_alloc(size_t size)
+{
+    PoolCache & pc = pool_cache;
+    unsigned cls;
+    PoolBlock * blk;
+    
+    if (size == 0)
+        size = 1;
+    if (size > pool_max)
+        return malloc(size);
+    
+    cls = (unsigned)((size - 1) / pool_granule);
+    size = (cls + 1) * pool_granule;
+    
+    if ((blk = pc.free_list[cls]) != nullptr) {
+        pc.free_list[cls] = blk->next;
+        return blk;
+    }
+    
+    if (pc.left < size) {
+        PoolChunk * chunk = (PoolChunk *)malloc(pool_chunk);
+        if (chunk == nullptr)
+            return nullptr;
+            
+        do {
+            chunk->next = pool_chunks;
+        } while (!__sync_bool_compare_and_swap(&pool_chunks, chunk->next, 
+            chunk));
+        
+        /* first granule holds the chunk header */
+        pc.bump = (char *)chunk + pool_granule;
+        pc.left = pool_chunk - pool_granule;
+    }
+    
+    pc.left -= size;
+    pc.bump += size;
+    return pc.bump - size;
+}
+
+void FS::pool_free(void * ptr, size_t size)
+{
+    PoolCache & pc = pool_cache;
+    PoolBlock * blk = (PoolBlock *)ptr;
+    unsigned cls;
+    
+    if (ptr == nullptr)
+        return;
+    if (size == 0)
+        size = 1;
+    if (size > pool_max) {
+        free(ptr);
+        return;
+    }
+        
+    cls = (unsigned)((size - 1) / pool_granule);
+    blk->next = pc.free_list[cls];
+    pc.free_list[cls] = blk;
+}
+
+#endif /* __KERNEL__ */
+
+TypeCache * TypeCache::all = nullptr;
+
+#ifdef __KERNEL__
+
+/* stored in cache once creating it failed. the cache is never retried, 
+ * since objects already handed out came from malloc */
+static struct kmem_cache * const failed_cache = (struct kmem_cache *)-1;
+
+/* returns nullptr if objects of this type must come from malloc. the 
+ * answer never changes once given, so alloc and free always agree */
+struct kmem_cache * TypeCache::get_cache()
+{
+    struct kmem_cache * c = __atomic_load_n(&cache, __ATOMIC_ACQUIRE);
+    struct kmem_cache * old;
+    
+    if (c == nullptr) {
+        /* may sleep, but so would kmalloc with GFP_NOFS */
+        if ((c = kmem_cache_create(name, size, 0, 0, nullptr)) == nullptr)
+            c = failed_cache;
+        
+        /* lost the race to another thread, which either installed its 
+         * cache or failed to create one */
+        if ((old = __sync_val_compare_and_swap(&cache, nullptr, c)) != 
+            nullptr) {
+            if (c != failed_cache)
+                kmem_cache_destroy(c);
+            c = old;
+        }
+        else if (c != failed_cache) {
+            do {
+                next = all;
+            } while (!__sync_bool_compare_and_swap(&all, next, this));
+        }
+    }
+    
+    return (c == failed_cache) ? nullptr : c;
+}
+
+void * TypeCache::alloc(size_t sz)
+{
+    struct kmem_cache * c;
+    
+    /* derived classes without their own cache end up here too */
+    if (sz == size && (c = get_cache()) != nullptr)
+        return kmem_cache_alloc(c, GFP_NOFS);
+    
+    return malloc(sz);
+}
+
+/* an object of this size was allocated after get_cache() settled, so the 
+ * state it finds here is the one alloc() used */
+void TypeCache::free(void * ptr, size_t sz)
+{
+    struct kmem_cache * c = __atomic_load_n(&cache, __ATOMIC_ACQUIRE);
+    
+    if (ptr == nullptr)
+        return;
+    
+    if (sz == size && c != nullptr && c != failed_cache)
+        kmem_cache_free(c, ptr);
+    else
+        ::free(ptr);
+}
+
+void TypeCache::destroy_all()
+{
+    TypeCache * tc = __sync_lock_test_and_set(&all, nullptr);
+    
+    while (tc != nullptr) {
+        TypeCache * next = tc->next;
+        kmem_cache_destroy(tc->cache);
+        tc->cache = nullptr;
+        tc->next = nullptr;
+        tc = next;
+    }
+}
+
+#else /* USERSPACE */
+
+struct kmem_cache * TypeCache::get_cache()
+{
+    return nullptr;
+}
+
+void * TypeCache::alloc(size_t sz)
+{
+    return pool_alloc(sz);
+}
+
+void TypeCache::free(void * ptr, size_t sz)
+{
+    pool_free(ptr, sz);
+}
+
+void TypeCache::destroy_all() {}
+
+#endif /* __KERNEL__ */
+
+namespace {
+    const unsigned max_symbol_tables = 1 << (16 - SYMBOL_BITS);
+
+    const char * const core_symbols[NUM_CORE_SYMBOLS] = {
+        "", "unknown", "null", "bit", "data",
+    };
+
+    /* slots are only ever filled, so a symbol stays valid until exit */
+    const char * const * symbol_tables[max_symbol_tables] = { core_symbols };
+}
+
+symbol_t FS::register_symbols(const char * const * table, unsigned num)
+{
+    const char * const * cur;
+    unsigned slot = 1;
+
+    assert(num <= MAX_SYMBOLS);
+    while (slot < max_symbol_tables) {
+        cur = __atomic_load_n(&symbol_tables[slot], __ATOMIC_ACQUIRE);
+        if (cur == table)
+            return (symbol_t)(slot << SYMBOL_BITS);
+        
+        /* on a lost race, the slot is checked again for the same table */
+        if (cur == nullptr && !__sync_bool_compare_and_swap(
+            &symbol_tables[slot], nullptr, table))
+            continue;
+        
+        if (cur == nullptr)
+            return (symbol_t)(slot << SYMBOL_BITS);
+        slot++;
+    }
+    
+    return 0;
+}
+
+const char * FS::symbol_to_name(symbol_t sym)
+{
+    const char * const * table = symbol_tables[sym >> SYMBOL_BITS];
+    return (table != nullptr) ? table[sym & (MAX_SYMBOLS - 1)] : "";
 }
 
 const char * FileSystem::type_to_name(unsigned type) const
@@ -76,8 +347,16 @@ int FileSystem::post_process(Entity & ent, char * buf, unsigned len)
     return ret;
 }
 
+FileSystem::~FileSystem()
+{
+#ifndef __KERNEL__
+    /* an unflushed batch is dropped */
+    delete batch;
+#endif
+}
+
 /* null parent for default ctor */
-Container Object::nullpt(nullptr, "null", 0);
+Container Object::nullpt(nullptr, SYM_NULL, 0);
 
 /* default null io object */
 IO FileSystem::nio;
@@ -86,7 +365,7 @@ Bit & Bit::operator=(Bit && rhs)
 {
     this->bit = rhs.bit; 
     set_index(rhs.get_index());
-    set_name(rhs.get_name());
+    set_name(rhs.get_name_symbol());
     return *this;
 }
 
@@ -150,12 +429,22 @@ int Container::save(int options)
     path->buffer = nullptr;
     path->length = 0;
     
-    if (!(options | SO_NO_ALLOC)) {
+    if (!(options & SO_NO_ALLOC)) {
         if ((ret = filsys->io.alloc(location, this->type_id)) < 0)
             goto fail;
     }
     
+#ifndef __KERNEL__
+    if (filsys->get_batch() != nullptr) {
+        if (options & SO_BARRIER)
+            filsys->get_batch()->barrier();
+        /* the batch frees the buffer once it is written */
+        return filsys->get_batch()->add(location, buf);
+    }
+#endif
+
     ret = filsys->io.write(location, buf);
+    filsys->io.count_write();
 fail:
     delete [] buf;
     return ret;    
@@ -179,3 +468,872 @@ void Container::decref() const
     //}
 }
 
+
+#ifndef __KERNEL__
+
+void Namespace::invalidate()
+{
+    dentries.clear();
+    listings.clear();
+    inodes.clear();
+    num_listed = 0;
+}
+
+void Namespace::add_dentry(unsigned long dir, const char * name, 
+    unsigned len, unsigned long ino)
+{
+    if (dentries.size() + num_listed >= max_dentries) {
+        dentries.clear();
+        listings.clear();
+        num_listed = 0;
+    }
+
+    DentryKey key = { dir, std::string(name, len) };
+    dentries[key] = ino;
+}
+
+int Namespace::load_dir(unsigned long dir, const std::vector<Dirent> * & ents)
+{
+    std::vector<Dirent> all;
+    int ret;
+
+    auto it = listings.find(dir);
+    if (it != listings.end()) {
+        hits++;
+        ents = &it->second;
+        return 0;
+    }
+
+    misses++;
+    if ((ret = adapter.read_dir(dir, all)) < 0)
+        return ret;
+
+    if (dentries.size() + num_listed + all.size() >= max_dentries) {
+        dentries.clear();
+        listings.clear();
+        num_listed = 0;
+    }
+
+    std::vector<Dirent> & list = listings[dir];
+    list.reserve(all.size());
+
+    for (Dirent & ent : all) {
+        /* these are resolved on the path */
+        if (ent.name == "." || ent.name == "..")
+            continue;
+
+        list.push_back(std::move(ent));
+    }
+
+    num_listed += list.size();
+    ents = &list;
+    return 0;
+}
+
+int Namespace::lookup(unsigned long dir, const char * name, unsigned len, 
+    unsigned long & ino)
+{
+    const std::vector<Dirent> * ents;
+    DentryKey key = { dir, std::string(name, len) };
+    int ret;
+
+    auto dit = dentries.find(key);
+    if (dit != dentries.end()) {
+        hits++;
+        ino = dit->second;
+        return (ino == 0) ? -ENOENT : 0;
+    }
+
+    /* a directory that was read in full has every name */
+    auto lit = listings.find(dir);
+    if (lit != listings.end()) {
+        hits++;
+        for (const Dirent & ent : lit->second) {
+            if (ent.name == key.name) {
+                ino = ent.ino;
+                add_dentry(dir, name, len, ino);
+                return 0;
+            }
+        }
+
+        add_dentry(dir, name, len, 0);
+        return -ENOENT;
+    }
+
+    misses++;
+    ret = adapter.lookup(dir, name, len, ino);
+
+    if (ret == ERR_UNIMP) {
+        if ((ret = load_dir(dir, ents)) < 0)
+            return ret;
+
+        ret = -ENOENT;
+        for (const Dirent & ent : *ents) {
+            if (ent.name == key.name) {
+                ino = ent.ino;
+                ret = 0;
+                break;
+            }
+        }
+    }
+
+    if (ret == 0)
+        add_dentry(dir, name, len, ino);
+    else if (ret == -ENOENT)
+        add_dentry(dir, name, len, 0);
+
+    return ret;
+}
+
+int Namespace::resolve(const char * path, unsigned long & ino)
+{
+    std::vector<unsigned long> stack;
+    unsigned long cur;
+    const char * end;
+    int ret;
+
+    if (path[0] != '/')
+        return -EINVAL;
+
+    if ((ret = adapter.get_root(cur)) < 0)
+        return ret;
+
+    for (;;) {
+        while (*path == '/')
+            path++;
+
+        if (*path == '\0')
+            break;
+
+        if ((end = strchr(path, '/')) == nullptr)
+            end = path + strlen(path);
+
+        if (end - path == 1 && path[0] == '.') {
+            /* stays in the same directory */
+        }
+        else if (end - path == 2 && path[0] == '.' && path[1] == '.') {
+            if (!stack.empty()) {
+                cur = stack.back();
+                stack.pop_back();
+            }
+        }
+        else {
+            stack.push_back(cur);
+            if ((ret = lookup(cur, path, end - path, cur)) < 0)
+                return ret;
+        }
+
+        path = end;
+    }
+
+    ino = cur;
+    return 0;
+}
+
+int Namespace::stat(unsigned long ino, Stat & st)
+{
+    int ret;
+
+    auto it = inodes.find(ino);
+    if (it != inodes.end()) {
+        hits++;
+        st = it->second;
+        return 0;
+    }
+
+    misses++;
+    if ((ret = adapter.read_inode(ino, st)) < 0)
+        return ret;
+
+    if (inodes.size() >= max_inodes)
+        inodes.clear();
+
+    st.ino = ino;
+    inodes[ino] = st;
+    return 0;
+}
+
+int Namespace::stat(const char * path, Stat & st)
+{
+    unsigned long ino;
+    int ret;
+
+    if ((ret = resolve(path, ino)) < 0)
+        return ret;
+
+    return stat(ino, st);
+}
+
+int Namespace::list(unsigned long dir, std::vector<Dirent> & ents)
+{
+    const std::vector<Dirent> * cached;
+    int ret;
+
+    if ((ret = load_dir(dir, cached)) < 0)
+        return ret;
+
+    ents = *cached;
+    return 0;
+}
+
+int Namespace::walk(unsigned long dir, std::string & path, 
+    std::unordered_set<unsigned long> & seen, NameVisitor & visitor)
+{
+    std::vector<Dirent> ents;
+    size_t len = path.size();
+    int ret;
+
+    /* a corrupted file system could link a directory into itself */
+    if (!seen.insert(dir).second)
+        return ERR_CORRUPT;
+
+    /* copied, since walking a subdirectory may drop the cached listing */
+    if ((ret = list(dir, ents)) < 0)
+        return ret;
+
+    for (Dirent & ent : ents) {
+        if (ent.type == FT_UNKNOWN) {
+            Stat st;
+            if ((ret = stat(ent.ino, st)) < 0)
+                return ret;
+            if (st.is_dir())
+                ent.type = FT_DIR;
+        }
+
+        path.resize(len);
+        path += '/';
+        path += ent.name;
+
+        if ((ret = visitor.visit(path, ent)) != 0)
+            return ret;
+
+        if (ent.type == FT_DIR && 
+            (ret = walk(ent.ino, path, seen, visitor)) != 0)
+            return ret;
+    }
+
+    path.resize(len);
+    return 0;
+}
+
+int Namespace::walk(const char * path, NameVisitor & visitor)
+{
+    std::unordered_set<unsigned long> seen;
+    std::string prefix(path);
+    unsigned long dir;
+    int ret;
+
+    if ((ret = resolve(path, dir)) < 0)
+        return ret;
+
+    while (!prefix.empty() && prefix.back() == '/')
+        prefix.pop_back();
+
+    return walk(dir, prefix, seen, visitor);
+}
+
+#define RMAP_MAGIC "SPFYRMAP"
+#define RMAP_VERSION 1
+
+/* followed by the largest span of each address space (padded to 8 bytes),
+ * then the entries sorted by target, then the field names */
+struct RMapHeader
+{
+    char magic[8];
+    u32 version;
+    u32 num_aspc;
+    u64 num_entries;
+    u64 names_size;
+};
+
+static size_t rmap_spans_size(unsigned num_aspc)
+{
+    return (num_aspc * sizeof(u32) + 7) & ~(size_t)7;
+}
+
+void RMapBuilder::add(const Container & owner, int owner_type, 
+    const Pointer & ptr)
+{
+    const Location & loc = ptr.pointer_location();
+    const Location & own = owner.get_location();
+    symbol_t name = ptr.get_name_symbol();
+    RMapEntry ent;
+    u64 bytes;
+
+    /* pointer does not point to anything valid */
+    if (ptr.pointer_type() == INVALID_TYPE_ID || loc.aspc == AS_NONE)
+        return;
+
+    /* addresses that are not numbers (e.g. names) cannot be ordered */
+    if (loc.dynamic || own.dynamic) {
+        num_skipped++;
+        return;
+    }
+    
+    auto it = name_ids.find(name);
+    if (it == name_ids.end()) {
+        const char * str = symbol_to_name(name);
+        it = name_ids.emplace(name, names.size()).first;
+        names.insert(names.end(), str, str + strlen(str) + 1);
+    }
+    
+    ent.addr = loc.addr;
+    ent.owner_addr = own.addr;
+    ent.offset = loc.offset;
+    ent.size = loc.size;
+    ent.owner_offset = own.offset;
+    ent.field = it->second;
+    ent.index = ptr.get_index();
+    ent.aspc = loc.aspc;
+    ent.type = ptr.pointer_type();
+    ent.owner_aspc = own.aspc;
+    ent.owner_type = owner_type;
+    
+    ent.span = 1;
+    if ((unsigned)loc.aspc < units.size() && units[loc.aspc] > 0) {
+        bytes = (u64)loc.offset + loc.size;
+        ent.span = std::max<u64>(1, (bytes + units[loc.aspc] - 1) / 
+            units[loc.aspc]);
+    }
+    
+    entries.push_back(ent);
+}
+
+int RMapBuilder::save(const char * filename)
+{
+    std::vector<u32> max_span;
+    std::vector<char> spans;
+    RMapHeader hdr;
+    FILE * file;
+    bool ok;
+    
+    std::sort(entries.begin(), entries.end(), 
+        [](const RMapEntry & a, const RMapEntry & b) {
+            if (a.aspc != b.aspc)
+                return a.aspc < b.aspc;
+            if (a.addr != b.addr)
+                return a.addr < b.addr;
+            return a.offset < b.offset;
+        });
+    
+    for (const RMapEntry & ent : entries) {
+        if (ent.aspc >= max_span.size())
+            max_span.resize(ent.aspc + 1, 0);
+        max_span[ent.aspc] = std::max(max_span[ent.aspc], ent.span);
+    }
+    
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, RMAP_MAGIC, sizeof(hdr.magic));
+    hdr.version = RMAP_VERSION;
+    hdr.num_aspc = max_span.size();
+    hdr.num_entries = entries.size();
+    hdr.names_size = names.size();
+    
+    spans.resize(rmap_spans_size(hdr.num_aspc), 0);
+    if (!max_span.empty())
+        memcpy(spans.data(), max_span.data(), max_span.size() * sizeof(u32));
+    
+    if ((file = fopen(filename, "wb")) == nullptr)
+        return -errno;
+    
+    ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1 &&
+        fwrite(spans.data(), 1, spans.size(), file) == spans.size() &&
+        fwrite(entries.data(), sizeof(RMapEntry), entries.size(), file) == 
+            entries.size() &&
+        fwrite(names.data(), 1, names.size(), file) == names.size();
+    
+    if (fclose(file) != 0 || !ok)
+        return -EIO;
+    
+    return 0;
+}
+
+int RMap::open(const char * filename)
+{
+    const RMapHeader * hdr;
+    struct stat st;
+    size_t need;
+    void * addr;
+    int fd, ret;
+    
+    close();
+    
+    if ((fd = ::open(filename, O_RDONLY)) < 0)
+        return -errno;
+    
+    if (fstat(fd, &st) < 0) {
+        ret = -errno;
+        ::close(fd);
+        return ret;
+    }
+    
+    if ((size_t)st.st_size < sizeof(*hdr)) {
+        ::close(fd);
+        return ERR_CORRUPT;
+    }
+    
+    addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return -errno;
+    
+    base = (char *)addr;
+    length = st.st_size;
+    hdr = (const RMapHeader *)base;
+    
+    if (memcmp(hdr->magic, RMAP_MAGIC, sizeof(hdr->magic)) != 0 || 
+        hdr->version != RMAP_VERSION || hdr->num_aspc > 0xFFFF ||
+        hdr->num_entries > length / sizeof(RMapEntry) ||
+        hdr->names_size > length) {
+        close();
+        return ERR_CORRUPT;
+    }
+    
+    need = sizeof(*hdr) + rmap_spans_size(hdr->num_aspc) + 
+        hdr->num_entries * sizeof(RMapEntry) + hdr->names_size;
+    if (need != length) {
+        close();
+        return ERR_CORRUPT;
+    }
+    
+    num_aspc = hdr->num_aspc;
+    max_span = (const u32 *)(base + sizeof(*hdr));
+    entries = (const RMapEntry *)(base + sizeof(*hdr) + 
+        rmap_spans_size(num_aspc));
+    num_entries = hdr->num_entries;
+    names = (const char *)(entries + num_entries);
+    names_size = hdr->names_size;
+    return 0;
+}
+
+void RMap::close()
+{
+    if (base != nullptr)
+        munmap(base, length);
+    
+    base = nullptr;
+    length = 0;
+    entries = nullptr;
+    num_entries = 0;
+    max_span = nullptr;
+    num_aspc = 0;
+    names = nullptr;
+    names_size = 0;
+}
+
+void RMap::referencing(int aspc, u64 start, u64 end, 
+    std::vector<const RMapEntry *> & out) const
+{
+    const RMapEntry * it;
+    u64 from;
+    
+    if (aspc < 0 || (unsigned)aspc >= num_aspc || start >= end)
+        return;
+    
+    /* a target that starts this far back may still reach start */
+    from = (start >= max_span[aspc]) ? start - max_span[aspc] + 1 : 0;
+    
+    it = std::lower_bound(entries, entries + num_entries, 
+        std::make_pair(aspc, from), 
+        [](const RMapEntry & ent, const std::pair<int, u64> & key) {
+            if (ent.aspc != key.first)
+                return ent.aspc < key.first;
+            return ent.addr < key.second;
+        });
+    
+    for (; it != entries + num_entries && it->aspc == aspc && 
+           it->addr < end; it++) {
+        if (it->addr + it->span > start)
+            out.push_back(it);
+    }
+}
+
+const char * RMap::field_name(const RMapEntry & ent) const
+{
+    /* names are nul terminated, and so is the table */
+    if (ent.field >= names_size || names[names_size - 1] != '\0')
+        return "";
+    
+    return names + ent.field;
+}
+
+void WriteBatch::next_epoch()
+{
+    if (extents.empty())
+        return;
+    
+    extents.clear();
+    epoch++;
+}
+
+void WriteBatch::barrier()
+{
+    if (writes.empty())
+        return;
+    
+    next_epoch();
+    if (barriers.empty() || barriers.back() != epoch)
+        barriers.push_back(epoch);
+}
+
+int WriteBatch::add(const Location & loc, char * buf)
+{
+    long long pos = io.get_position(loc);
+    long long end = pos + loc.size;
+    std::map<long long, Extent>::iterator it;
+    
+    /* written in order of the saves around it */
+    if (pos < 0) {
+        next_epoch();
+        writes.emplace_back(loc, pos, buf, epoch);
+        extents[pos] = Extent{ pos, writes.size() - 1 };
+        next_epoch();
+        return loc.size;
+    }
+    
+    it = extents.lower_bound(pos);
+    if (it != extents.end() && it->first == pos && it->second.end == end) {
+        /* saved again, only the last one is written */
+        delete [] writes[it->second.index].buf;
+        writes[it->second.index].buf = buf;
+        return loc.size;
+    }
+    
+    if ((it != extents.end() && it->first < end) || 
+        (it != extents.begin() && (--it)->second.end > pos))
+        next_epoch();
+    
+    writes.emplace_back(loc, pos, buf, epoch);
+    extents[pos] = Extent{ end, writes.size() - 1 };
+    return loc.size;
+}
+
+int WriteBatch::write_run(const Write * run, unsigned cnt)
+{
+    int ret, total = 0;
+    
+    io.count_write();
+    if (cnt > 1) {
+        std::vector<IOVector> vec(cnt);
+        
+        for (unsigned i = 0; i < cnt; i++) {
+            vec[i].buf = run[i].buf;
+            vec[i].len = run[i].loc.size;
+        }
+        
+        if ((ret = io.write_vector(run->pos, vec.data(), cnt)) != ERR_UNIMP)
+            return ret;
+    }
+    
+    /* io cannot write a run at once */
+    for (unsigned i = 0; i < cnt; i++) {
+        if ((ret = io.write(run[i].loc, run[i].buf)) < 0)
+            return ret;
+        total += ret;
+    }
+    
+    return total;
+}
+
+int WriteBatch::flush()
+{
+    size_t i, j, next_barrier = 0;
+    int ret = 0, total = 0;
+    
+    std::stable_sort(writes.begin(), writes.end(), 
+        [](const Write & a, const Write & b) {
+            if (a.epoch != b.epoch)
+                return a.epoch < b.epoch;
+            return a.pos < b.pos;
+        });
+    
+    for (i = 0; i < writes.size(); i = j) {
+        /* adjacent writes of an epoch become one run */
+        for (j = i + 1; j < writes.size() && j - i < MAX_RUN; j++) {
+            if (writes[j].epoch != writes[i].epoch || writes[j].pos < 0 ||
+                writes[j].pos != writes[j - 1].pos + writes[j - 1].loc.size)
+                break;
+        }
+        
+        if (next_barrier < barriers.size() && 
+            barriers[next_barrier] <= writes[i].epoch) {
+            if ((ret = io.sync()) < 0)
+                break;
+            while (next_barrier < barriers.size() && 
+                   barriers[next_barrier] <= writes[i].epoch)
+                next_barrier++;
+        }
+        
+        if ((ret = write_run(&writes[i], j - i)) < 0)
+            break;
+        total += ret;
+    }
+    
+    if (ret >= 0)
+        ret = io.sync();
+    
+    clear();
+    return (ret < 0) ? ret : total;
+}
+
+void WriteBatch::clear()
+{
+    for (Write & w : writes)
+        delete [] w.buf;
+    
+    writes.clear();
+    extents.clear();
+    barriers.clear();
+    epoch = 0;
+}
+
+BitmapAllocator::Bitmap * BitmapAllocator::find_bitmap(u64 addr)
+{
+    std::vector<Bitmap>::iterator it = std::upper_bound(bitmaps.begin(), 
+        bitmaps.end(), addr, [](u64 a, const Bitmap & bm) {
+            return a < bm.first;
+        });
+    
+    if (it == bitmaps.begin() || addr >= (--it)->first + it->count)
+        return nullptr;
+    
+    return &*it;
+}
+
+/* merges with the runs on either side */
+void BitmapAllocator::insert_run(u64 start, u64 len)
+{
+    RunIter next = runs.lower_bound(start);
+    RunIter prev;
+    
+    if (next != runs.begin()) {
+        prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            start = prev->first;
+            len += prev->second;
+            erase_run(prev);
+        }
+    }
+    
+    if (next != runs.end() && start + len == next->first) {
+        len += next->second;
+        erase_run(next);
+    }
+    
+    runs[start] = len;
+    by_length.insert(std::make_pair(len, start));
+}
+
+void BitmapAllocator::erase_run(RunIter it)
+{
+    by_length.erase(std::make_pair(it->second, it->first));
+    runs.erase(it);
+}
+
+/* [start, start + len) must be within the run */
+void BitmapAllocator::take(RunIter it, u64 start, u64 len)
+{
+    u64 first = it->first;
+    u64 end = it->first + it->second;
+    
+    erase_run(it);
+    if (start > first) {
+        runs[first] = start - first;
+        by_length.insert(std::make_pair(start - first, first));
+    }
+    
+    if (start + len < end) {
+        runs[start + len] = end - start - len;
+        by_length.insert(std::make_pair(end - start - len, start + len));
+    }
+    
+    mark(start, len, true);
+    num_free -= len;
+}
+
+/* returns false if an address is not covered by a bitmap */
+bool BitmapAllocator::mark(u64 start, u64 len, bool used)
+{
+    Bitmap * bm = nullptr;
+    
+    for (u64 addr = start; addr < start + len; addr++) {
+        if (bm == nullptr || addr >= bm->first + bm->count) {
+            if ((bm = find_bitmap(addr)) == nullptr)
+                return false;
+            bm->dirty = true;
+        }
+        
+        u64 bit = addr - bm->first;
+        if (used)
+            bm->bits[bit / 8] |= (1 << (bit % 8));
+        else
+            bm->bits[bit / 8] &= ~(1 << (bit % 8));
+    }
+    
+    return true;
+}
+
+int BitmapAllocator::add_bitmap(const Location & loc, u64 first, u64 count,
+    const char * bits)
+{
+    std::vector<Bitmap>::iterator it;
+    u64 bit, run;
+    
+    if (count == 0 || count > (u64)loc.size * 8)
+        return -EINVAL;
+    
+    /* bitmaps may not overlap */
+    it = std::upper_bound(bitmaps.begin(), bitmaps.end(), first, 
+        [](u64 a, const Bitmap & bm) {
+            return a < bm.first;
+        });
+    
+    if ((it != bitmaps.end() && first + count > it->first) ||
+        (it != bitmaps.begin() && std::prev(it)->first + 
+         std::prev(it)->count > first))
+        return -EEXIST;
+    
+    it = bitmaps.insert(it, Bitmap{ loc, first, count, 
+        std::vector<char>(bits, bits + loc.size), false });
+    
+    for (bit = 0; bit < count; bit += run) {
+        /* skips over bytes that are fully in use */
+        if (bit % 8 == 0 && (unsigned char)bits[bit / 8] == 0xff) {
+            run = 8;
+            continue;
+        }
+        
+        for (run = 0; bit + run < count && 
+             !(bits[(bit + run) / 8] & (1 << ((bit + run) % 8))); run++);
+        
+        if (run > 0) {
+            insert_run(first + bit, run);
+            num_free += run;
+        }
+        else {
+            run = 1;
+        }
+    }
+    
+    return 0;
+}
+
+int BitmapAllocator::alloc(u64 goal, u64 len, u64 & start)
+{
+    std::set<std::pair<u64, u64>>::iterator best;
+    RunIter it = runs.upper_bound(goal);
+    
+    if (len == 0)
+        return -EINVAL;
+    
+    /* the run that the goal is in */
+    if (it != runs.begin()) {
+        RunIter prev = std::prev(it);
+        if (prev->first + prev->second >= goal + len) {
+            take(prev, goal, len);
+            start = goal;
+            return 0;
+        }
+    }
+    
+    for (unsigned n = 0; it != runs.end() && n < GOAL_PROBES; it++, n++) {
+        if (it->second >= len) {
+            start = it->first;
+            take(it, start, len);
+            return 0;
+        }
+    }
+    
+    /* the shortest run that fits, which keeps long runs for long requests */
+    best = by_length.lower_bound(std::make_pair(len, (u64)0));
+    if (best == by_length.end())
+        return -ENOSPC;
+    
+    start = best->second;
+    take(runs.find(start), start, len);
+    return 0;
+}
+
+int BitmapAllocator::release(u64 start, u64 len)
+{
+    RunIter it = runs.lower_bound(start + len);
+    Bitmap * bm;
+    
+    if (len == 0)
+        return -EINVAL;
+    
+    /* every address must be covered, and none of them already free */
+    for (u64 addr = start; addr < start + len; addr = bm->first + bm->count) {
+        if ((bm = find_bitmap(addr)) == nullptr)
+            return -EINVAL;
+    }
+    
+    if (it != runs.begin() && 
+        std::prev(it)->first + std::prev(it)->second > start)
+        return -EINVAL;
+    
+    mark(start, len, false);
+    insert_run(start, len);
+    num_free += len;
+    return 0;
+}
+
+int BitmapAllocator::flush(WriteBatch & batch)
+{
+    char * buf;
+    int ret, num_queued = 0;
+    
+    for (Bitmap & bm : bitmaps) {
+        if (!bm.dirty)
+            continue;
+        
+        if ((buf = new char[bm.loc.size]) == nullptr)
+            return -ENOMEM;
+        
+        memcpy(buf, bm.bits.data(), bm.loc.size);
+        if ((ret = batch.add(bm.loc, buf)) < 0)
+            return ret;
+        
+        bm.dirty = false;
+        num_queued++;
+    }
+    
+    return num_queued;
+}
+
+int FileSystem::begin_batch()
+{
+    if (batch != nullptr)
+        return -EBUSY;
+    
+    if ((batch = new WriteBatch(io)) == nullptr)
+        return -ENOMEM;
+    
+    return 0;
+}
+
+int FileSystem::write_barrier()
+{
+    if (batch == nullptr)
+        return ERR_UNINIT;
+    
+    batch->barrier();
+    return 0;
+}
+
+int FileSystem::flush_batch()
+{
+    WriteBatch * wb = batch;
+    int ret;
+    
+    if (wb == nullptr)
+        return ERR_UNINIT;
+    
+    /* saves from here on are written directly */
+    batch = nullptr;
+    ret = wb->flush();
+    delete wb;
+    return ret;
+}
+
+#endif /* __KERNEL__ */
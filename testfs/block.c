@@ -5,9 +5,16 @@
  *
  */
 
+#define _GNU_SOURCE
 #include "common.h"
 #include "block.h"
 #include "testfs.h"
+#include "list.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #ifdef __SNOOP__
 #include <snoop.h>
 #include "snoop.h"
@@ -15,63 +22,316 @@
 
 static char zero[BLOCK_SIZE] = {0};
 
+/* 
+ * write-back buffer cache. writes only update the cached copy, and dirty
+ * buffers are written out in runs of contiguous blocks, with one pwritev
+ * per run, when a dirty buffer is evicted or the file system is closed.
+ */
+#define BUFFER_HASH_SHIFT 10
+#define NR_BUFFERS        4096
+
+#define buffer_hashfn(nr)	\
+	hash_int((unsigned int)nr, BUFFER_HASH_SHIFT)
+
+struct buffer {
+        off_t b_nr;
+        int b_dirty;
+        struct hlist_node hnode;
+        struct list_head lru;   /* most recently used first */
+        char b_data[BLOCK_SIZE];
+};
+
+struct buffer_cache {
+        struct hlist_head hash[1 << BUFFER_HASH_SHIFT];
+        struct list_head lru;
+        int nr_buffers;
+        int nr_dirty;
+};
+
+static struct buffer_cache *
+buffer_cache_get(struct super_block *sb)
+{
+        struct buffer_cache *bc = sb->bcache;
+        int i;
+
+        if (bc) {
+                return bc;
+        }
+        if ((bc = malloc(sizeof(struct buffer_cache))) == NULL) {
+                EXIT("malloc");
+        }
+        for (i = 0; i < (1 << BUFFER_HASH_SHIFT); i++) {
+                INIT_HLIST_HEAD(&bc->hash[i]);
+        }
+        INIT_LIST_HEAD(&bc->lru);
+        bc->nr_buffers = 0;
+        bc->nr_dirty = 0;
+        sb->bcache = bc;
+        return bc;
+}
+
+static struct buffer *
+buffer_find(struct buffer_cache *bc, off_t nr)
+{
+        struct hlist_node *elem;
+        struct buffer *b;
+
+        hlist_for_each_entry(b, elem, &bc->hash[buffer_hashfn(nr)], hnode) {
+                if (b->b_nr == nr) {
+                        list_del(&b->lru);
+                        list_add(&b->lru, &bc->lru);
+                        return b;
+                }
+        }
+        return NULL;
+}
+
+static void
+buffer_remove(struct buffer_cache *bc, struct buffer *b)
+{
+        if (b->b_dirty) {
+                bc->nr_dirty--;
+        }
+        hlist_del(&b->hnode);
+        list_del(&b->lru);
+}
+
+static int
+buffer_compare(const void *a, const void *b)
+{
+        const struct buffer *x = *(const struct buffer * const *)a;
+        const struct buffer *y = *(const struct buffer * const *)b;
+
+        return (x->b_nr > y->b_nr) - (x->b_nr < y->b_nr);
+}
+
+/* writes all of iov at offset, resuming after short writes */
+static void
+pwritev_full(int fd, struct iovec *iov, int cnt, off_t offset)
+{
+        while (cnt > 0) {
+                ssize_t ret = pwritev(fd, iov, cnt, offset);
+
+                if (ret < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        EXIT("pwritev");
+                }
+                offset += ret;
+                while (cnt > 0 && (size_t)ret >= iov->iov_len) {
+                        ret -= iov->iov_len;
+                        iov++;
+                        cnt--;
+                }
+                if (cnt > 0) {
+                        iov->iov_base = (char *)iov->iov_base + ret;
+                        iov->iov_len -= ret;
+                }
+        }
+}
+
 void
-write_blocks(struct super_block *sb, const char *blocks, off_t start, size_t nr)
+flush_blocks(struct super_block *sb)
 {
-        long pos;
-       
-        if ((pos = ftell(sb->dev)) < 0) {
-                EXIT("ftell");
+        struct buffer_cache *bc = sb->bcache;
+        struct buffer **dirty;
+        struct iovec iov[IOV_MAX];
+        struct buffer *b;
+        int i, j, nr = 0;
+
+        if (!bc || bc->nr_dirty == 0) {
+                return;
         }
-        
-        if (fseek(sb->dev, start * BLOCK_SIZE, SEEK_SET) < 0) {
-                EXIT("fseek");
+        if ((dirty = malloc(bc->nr_dirty * sizeof(struct buffer *))) == NULL) {
+                EXIT("malloc");
         }
+        list_for_each_entry(b, &bc->lru, lru) {
+                if (b->b_dirty) {
+                        dirty[nr++] = b;
+                }
+        }
+        assert(nr == bc->nr_dirty);
+        qsort(dirty, nr, sizeof(struct buffer *), buffer_compare);
+
+        for (i = 0; i < nr; i = j) {
+                for (j = i; j < nr && j - i < IOV_MAX && 
+                            dirty[j]->b_nr == dirty[i]->b_nr + (j - i); j++) {
+                        iov[j - i].iov_base = dirty[j]->b_data;
+                        iov[j - i].iov_len = BLOCK_SIZE;
+                        dirty[j]->b_dirty = 0;
+                }
+                pwritev_full(sb->dev, iov, j - i, dirty[i]->b_nr * BLOCK_SIZE);
+        }
+
+        bc->nr_dirty = 0;
+        free(dirty);
+}
 
-        if (fwrite(blocks, BLOCK_SIZE, nr, sb->dev) != nr) {
-                EXIT("fwrite");
+/* returns the buffer of block nr, which is not read in if newly cached */
+static struct buffer *
+buffer_get(struct super_block *sb, off_t nr)
+{
+        struct buffer_cache *bc = buffer_cache_get(sb);
+        struct buffer *b;
+
+        if ((b = buffer_find(bc, nr)) != NULL) {
+                return b;
+        }
+        if (bc->nr_buffers < NR_BUFFERS) {
+                if ((b = malloc(sizeof(struct buffer))) == NULL) {
+                        EXIT("malloc");
+                }
+                bc->nr_buffers++;
+        } else {
+                /* reuse the least recently used buffer */
+                b = list_entry(bc->lru.prev, struct buffer, lru);
+                if (b->b_dirty) {
+                        flush_blocks(sb);
+                }
+                buffer_remove(bc, b);
+        }
+
+        b->b_nr = nr;
+        b->b_dirty = 0;
+        INIT_HLIST_NODE(&b->hnode);
+        hlist_add_head(&b->hnode, &bc->hash[buffer_hashfn(nr)]);
+        list_add(&b->lru, &bc->lru);
+        return b;
+}
+
+void
+close_blocks(struct super_block *sb)
+{
+        struct buffer_cache *bc = sb->bcache;
+        struct buffer *b, *n;
+
+        if (!bc) {
+                return;
+        }
+        flush_blocks(sb);
+        list_for_each_entry_safe(b, n, &bc->lru, lru) {
+                buffer_remove(bc, b);
+                free(b);
+        }
+        free(bc);
+        sb->bcache = NULL;
+}
+
+void
+write_blocks(struct super_block *sb, const char *blocks, off_t start, size_t nr)
+{
+        struct buffer_cache *bc = buffer_cache_get(sb);
+        size_t i;
+
+        for (i = 0; i < nr; i++) {
+                struct buffer *b = buffer_get(sb, start + i);
+
+                memcpy(b->b_data, blocks + i * BLOCK_SIZE, BLOCK_SIZE);
+                if (!b->b_dirty) {
+                        b->b_dirty = 1;
+                        bc->nr_dirty++;
+                }
         }
         
 #ifdef __SNOOP__      
-        for ( unsigned i = 0; i < nr; i++ )
         {
-            int ret = snoop_write(snp, start * BLOCK_SIZE, blocks, BLOCK_SIZE);
+            int ret = snoop_testfs_write(start, blocks, nr);
             assert(ret == 0);
-            start  += 1;
-            blocks += BLOCK_SIZE;
         }
 #endif
-        
-        if (fseek(sb->dev, pos, SEEK_SET) < 0) {
-                EXIT("fseek");
+}
+
+/* returns 0 if the blocks now read back as zeros, or negative value if the
+ * device cannot punch holes */
+static int
+punch_blocks(struct super_block *sb, off_t start, size_t nr)
+{
+        off_t offset = start * BLOCK_SIZE;
+        off_t end = offset + (off_t)nr * BLOCK_SIZE;
+        struct stat st;
+
+        if (fstat(sb->dev, &st) < 0) {
+                return -errno;
         }
+        if (offset < st.st_size && fallocate(sb->dev, 
+                FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, 
+                MIN(end, st.st_size) - offset) < 0) {
+                return -errno;
+        }
+        /* anything past the end of the file already reads as zeros */
+        if (end > st.st_size && ftruncate(sb->dev, end) < 0) {
+                return -errno;
+        }
+        return 0;
 }
 
 void
 zero_blocks(struct super_block *sb, off_t start, size_t nr)
 {
+        struct buffer_cache *bc = buffer_cache_get(sb);
         size_t i;
 
+        /* cached copies would overwrite the hole when flushed */
         for (i = 0; i < nr; i++) {
-                write_blocks(sb, zero, start + i, 1);
+                struct buffer *b = buffer_find(bc, start + i);
+                
+                if (b) {
+                        buffer_remove(bc, b);
+                        bc->nr_buffers--;
+                        free(b);
+                }
         }
+        
+        if (punch_blocks(sb, start, nr) < 0) {
+                for (i = 0; i < nr; i++) {
+                        write_blocks(sb, zero, start + i, 1);
+                }
+                return;
+        }
+
+#ifdef __SNOOP__
+        for (i = 0; i < nr; i++) {
+            int ret = snoop_testfs_write(start + i, zero, 1);
+            assert(ret == 0);
+        }
+#endif
 }
 
 void
 read_blocks(struct super_block *sb, char *blocks, off_t start, size_t nr)
 {
-        long pos;
+        struct buffer_cache *bc = buffer_cache_get(sb);
+        size_t i = 0, j, k;
 
-        if ((pos = ftell(sb->dev)) < 0) {
-                EXIT("ftell");
-        }
-        
-        if (fseek(sb->dev, start * BLOCK_SIZE, SEEK_SET) < 0) {
-                EXIT("fseek");
-        }
-        
-        if (fread(blocks, BLOCK_SIZE, nr, sb->dev) != nr) {
-                EXIT("freed");
+        while (i < nr) {
+                struct buffer *b = buffer_find(bc, start + i);
+                ssize_t ret;
+
+                if (b) {
+                        memcpy(blocks + i * BLOCK_SIZE, b->b_data, BLOCK_SIZE);
+                        i++;
+                        continue;
+                }
+
+                /* read the whole run of uncached blocks at once */
+                for (j = i + 1; j < nr && !buffer_find(bc, start + j); j++);
+                
+                do {
+                        ret = pread(sb->dev, blocks + i * BLOCK_SIZE, 
+                                    (j - i) * BLOCK_SIZE, 
+                                    (start + i) * BLOCK_SIZE);
+                } while (ret < 0 && errno == EINTR);
+                
+                if (ret != (ssize_t)((j - i) * BLOCK_SIZE)) {
+                        EXIT("pread");
+                }
+                
+                for (k = i; k < j; k++) {
+                        b = buffer_get(sb, start + k);
+                        memcpy(b->b_data, blocks + k * BLOCK_SIZE, BLOCK_SIZE);
+                }
+                i = j;
         }
         
 #ifdef __SNOOP__      
@@ -83,9 +343,4 @@ read_blocks(struct super_block *sb, char *blocks, off_t start, size_t nr)
             blocks += BLOCK_SIZE;
         }
 #endif
-        
-        if (fseek(sb->dev, pos, SEEK_SET) < 0) {
-                EXIT("fseek");
-        }       
 }
-
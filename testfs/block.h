@@ -9,5 +9,10 @@ void write_blocks(struct super_block *sb, const char *blocks, off_t start,
 void zero_blocks(struct super_block *sb, off_t start, size_t nr);
 void read_blocks(struct super_block *sb, char *blocks, off_t start, size_t nr);
 
+/* writes out all dirty cached blocks */
+void flush_blocks(struct super_block *sb);
+/* flushes and frees the buffer cache */
+void close_blocks(struct super_block *sb);
+
 #endif /* _BLOCK_H */
 
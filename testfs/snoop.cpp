@@ -3,9 +3,75 @@
 #include <assert.h>
 #include "snoop.h"      // the local .h header file
 #include "testfs.h"
+#include "bitmap.h"
 
 struct snoop * snp = nullptr;
 
+/* type of every block, as far as the writes seen so far tell. testfs has a 
+ * fixed layout and maximum size, so this is simply indexed by block number.
+ * statically typed blocks are filled in up front, and the types of the 
+ * dynamic ones are taken from the pointers of the inode and indirect blocks
+ * as they are written. entries are single words, so readers never lock and
+ * writers never wait on them */
+class BlockTypeTable
+{
+    int * types;
+    unsigned long nr_blocks;
+    
+public:
+    BlockTypeTable(unsigned long nr) : types(new int[nr]), nr_blocks(nr)
+    {
+        for ( unsigned long i = 0; i < nr_blocks; i++ )
+            types[i] = FS::UNKNOWN_TYPE_ID;
+    }
+    
+    ~BlockTypeTable() { delete [] types; }
+    
+    int lookup(unsigned long block_nr) const
+    {
+        if ( block_nr >= nr_blocks )
+            return FS::UNKNOWN_TYPE_ID;
+        return __atomic_load_n(&types[block_nr], __ATOMIC_ACQUIRE);
+    }
+    
+    void update(unsigned long block_nr, int type)
+    {
+        if ( block_nr < nr_blocks )
+            __atomic_store_n(&types[block_nr], type, __ATOMIC_RELEASE);
+    }
+    
+    void update(unsigned long start, unsigned long nr, int type)
+    {
+        for ( unsigned long i = 0; i < nr; i++ )
+            update(start + i, type);
+    }
+};
+
+static const unsigned long max_blocks = SUPER_BLOCK_SIZE + INODE_FREEMAP_SIZE
+    + BLOCK_FREEMAP_SIZE + NR_INODE_BLOCKS 
+    + BLOCK_SIZE * BLOCK_FREEMAP_SIZE * BITS_PER_WORD;
+
+static BlockTypeTable * block_types = nullptr;
+
+/* records the type of the block that each pointer it visits points to */
+struct BlockTypeRecorder : public FS::Visitor
+{
+    virtual int visit(FS::Entity & ent) override
+    {
+        FS::Pointer * ptr = ent.to_pointer();
+        
+        if ( ptr == nullptr )
+            return 0;
+        
+        const FS::Location & loc = ptr->pointer_location();
+        
+        /* block 0 is the null block */
+        if ( loc.aspc == TestFS::AS_BLOCK && loc.addr != 0 )
+            block_types->update(loc.addr, ptr->pointer_type());
+        return 0;
+    }
+};
+
 struct TestFSInfo : public SnoopInfo
 {
     virtual int is_block_dynamic(unsigned type) const override
@@ -59,22 +125,100 @@ struct TestFSInfo : public SnoopInfo
     {
         return 0;
     }
+    
+    /* only inode and indirect blocks point to other blocks */
+    void record_pointers(off_t block_nr, const char * buf) const
+    {
+        int type = block_types->lookup(block_nr);
+        
+        switch (type)
+        {
+        case TestFS::INODE_BLOCK:
+        case TestFS::DIR_INDIRECT_BLOCK:
+        case TestFS::DATA_INDIRECT_BLOCK:
+            break;
+        default:
+            return;
+        }
+        
+        if ( super == nullptr )
+            return;
+        
+        FS::Location loc(TestFS::AS_BLOCK, BLOCK_SIZE, 0, block_nr);
+        FS::Container * ctn = filesystem->parse_by_type(type, loc,
+                              super->get_path(), buf, BLOCK_SIZE);
+        
+        if ( ctn != nullptr )
+        {
+            BlockTypeRecorder recorder;
+            ctn->accept_pointers(recorder);
+            ctn->destroy();
+        }
+    }
 
     TestFSInfo(struct snoop * snp, TestFS * fs) : 
         SnoopInfo(TestFS::AS_BLOCK, TestFS::DATA_BLOCK, fs) {}
 };
 
+static TestFS * testfs = nullptr;
+static TestFSInfo * testfs_info = nullptr;
+
 void snoop_testfs_init(void)
 {
     const int num_ht_buckets = 4096;
+    unsigned long start = SUPER_BLOCK_SIZE;
+    
     snp = new snoop(num_ht_buckets);
     assert(snp != nullptr);
-    snp->set_snoop_info(new TestFSInfo(snp, new TestFS()));
+    
+    /* same layout as testfs_make_super_block */
+    block_types = new BlockTypeTable(max_blocks);
+    block_types->update(0, SUPER_BLOCK_SIZE, TestFS::DSUPER_BLOCK);
+    block_types->update(start, INODE_FREEMAP_SIZE, TestFS::INODE_FREEMAP);
+    start += INODE_FREEMAP_SIZE;
+    block_types->update(start, BLOCK_FREEMAP_SIZE, TestFS::BLOCK_FREEMAP);
+    start += BLOCK_FREEMAP_SIZE;
+    block_types->update(start, NR_INODE_BLOCKS, TestFS::INODE_BLOCK);
+    
+    testfs = new TestFS();
+    testfs_info = new TestFSInfo(snp, testfs);
+    snp->set_snoop_info(testfs_info);
 }
 
 void snoop_testfs_shutdown(void)
 {
     snoop_shutdown(snp);     
+    delete block_types;
+    block_types = nullptr;
+    testfs_info = nullptr;
+    testfs = nullptr;
+}
+
+int snoop_testfs_write(off_t start, const char * blocks, size_t nr)
+{
+    /* blocks are contiguous on disk, so snoop can take them all at once
+     * rather than one call (and one lookup of its tables) per block */
+    int ret = snoop_write(snp, start * BLOCK_SIZE, blocks, nr * BLOCK_SIZE);
+    
+    if ( ret < 0 )
+        return ret;
+    
+    for ( size_t i = 0; i < nr; i++ )
+        testfs_info->record_pointers(start + i, blocks + i * BLOCK_SIZE);
+    return 0;
+}
+
+void snoop_testfs_free(off_t block_nr)
+{
+    block_types->update(block_nr, FS::UNKNOWN_TYPE_ID);
+}
+
+int snoop_testfs_block_type(off_t block_nr)
+{
+    if ( block_types == nullptr || block_nr < 0 )
+        return FS::UNKNOWN_TYPE_ID;
+        
+    return block_types->lookup((unsigned long)block_nr);
 }
 
 int cmd_snoop(struct super_block *sb, struct context *c)
@@ -95,3 +239,23 @@ int cmd_snoop(struct super_block *sb, struct context *c)
         return 0;
 }
 
+int cmd_btype(struct super_block *sb, struct context *c)
+{
+        char * end;
+        long block_nr;
+        int type;
+
+        if ( c->nargs != 2 ) {
+                return -EINVAL;
+        }
+        
+        block_nr = strtol(c->cmd[1], &end, 10);
+        if ( *end != '\0' || block_nr < 0 ) {
+                return -EINVAL;
+        }
+        
+        type = snoop_testfs_block_type(block_nr);
+        printf("%ld: %s\n", block_nr, testfs->type_to_name(type));
+        return 0;
+}
+
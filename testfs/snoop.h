@@ -1,6 +1,8 @@
 #ifndef _TESTFS_SNOOP_H_
 #define _TESTFS_SNOOP_H_
 
+#include <sys/types.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,10 +15,22 @@ extern struct snoop * snp;
 void snoop_testfs_init(void);
 void snoop_testfs_shutdown(void);
 
+// hands a run of nr contiguous blocks that were just written to snoop in a
+// single call. returns 0 on success, negative value on failure
+int snoop_testfs_write(off_t start, const char * blocks, size_t nr);
+
+// forgets the type of a block that was just freed
+void snoop_testfs_free(off_t block_nr);
+
+// type of the block as tracked from the writes seen so far, or
+// UNKNOWN_TYPE_ID. never blocks, so it may be called from any thread
+int snoop_testfs_block_type(off_t block_nr);
+
 struct super_block;
 struct context;
 
 int cmd_snoop(struct super_block *sb, struct context *c);
+int cmd_btype(struct super_block *sb, struct context *c);
 
 #ifdef __cplusplus
 }
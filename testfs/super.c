@@ -14,6 +14,7 @@
 #include "bitmap.h"
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #ifdef __SNOOP__
 #include <snoop.h>
 #include "snoop.h"
@@ -27,7 +28,7 @@ testfs_make_super_block(char *file)
         if (!sb) {
                 EXIT("malloc");
         }
-        if ((sb->dev = fopen(file, "w")) == NULL) {
+        if ((sb->dev = open(file, O_RDWR | O_CREAT | O_TRUNC, 0666)) < 0) {
                 EXIT(file);
         }
         sb->sb.inode_freemap_start = SUPER_BLOCK_SIZE;
@@ -69,7 +70,7 @@ testfs_init_super_block(const char *file, int corrupt, struct super_block **sbp)
 {
         struct super_block *sb = malloc(sizeof(struct super_block));
         char block[BLOCK_SIZE];
-        int ret, sock;
+        int ret;
 
         (void)corrupt;
         
@@ -77,12 +78,10 @@ testfs_init_super_block(const char *file, int corrupt, struct super_block **sbp)
                 return -ENOMEM;
         }
 
-        if ( (sock = open(file, O_RDWR)) < 0 ) {
+        if ( (sb->dev = open(file, O_RDWR)) < 0 ) {
             return errno;
         }
-        else if ((sb->dev = fdopen(sock, "r+")) == NULL) {
-            return errno;
-        }	
+        sb->bcache = NULL;
 
         read_blocks(sb, block, 0, 1);
         memcpy(&sb->sb, block, sizeof(struct dsuper_block));
@@ -133,9 +132,9 @@ testfs_close_super_block(struct super_block *sb)
                 bitmap_destroy(sb->block_freemap);
                 sb->block_freemap = NULL;
         }
-        fflush(sb->dev);
-        fclose(sb->dev);
-        sb->dev = NULL;
+        close_blocks(sb);
+        close(sb->dev);
+        sb->dev = -1;
         free(sb);
 }
 
@@ -245,6 +244,7 @@ testfs_free_block(struct super_block *sb, int block_nr)
         // (jsun): uncomment to test snoop_trim()
         //printf("trimming block %d\n", block_nr);
         //snoop_trim(snp, block_nr * BLOCK_SIZE, BLOCK_SIZE);
+        snoop_testfs_free(block_nr);
 #endif
         block_nr -= sb->sb.data_blocks_start;
         assert(block_nr >= 0);
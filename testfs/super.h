@@ -6,7 +6,8 @@
 
 struct super_block {
         struct dsuper_block sb;
-        FILE *dev;
+        int dev;
+        struct buffer_cache *bcache;    /* see block.c */
         struct bitmap *inode_freemap;
         struct bitmap *block_freemap; 
 };
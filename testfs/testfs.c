@@ -61,6 +61,8 @@ static const struct cmd {
 #ifdef __SNOOP__
         { "snoop",   cmd_snoop,   1, "print all known metadata block types. "
                                      "usage: snoop" },
+        { "btype",   cmd_btype,   2, "print the tracked type of block NR. "
+                                     "usage: btype NR" },
 #endif
         { "quit",    cmd_quit,    1, "quits this program. usage: quit" },
         { NULL, NULL, 0, NULL },